@@ -115,7 +115,9 @@ function(c7222_define_development_interface)
         pico_cyw43_arch_threadsafe_background
         hardware_adc
         hardware_clocks
+        hardware_flash
         hardware_pwm
+        pico_flash
         FreeRTOS-Kernel-Heap4
         ELEC_C7222
     )
@@ -124,6 +126,7 @@ function(c7222_define_development_interface)
         target_link_libraries(c7222_development INTERFACE
             pico_btstack_ble
             pico_btstack_cyw43
+            hardware_resets
         )
     endif()
 
@@ -160,7 +163,8 @@ endfunction()
 #   - Adds linker wrap/map options.
 #   - Enables/disables stdio backends and Pico extra outputs.
 #   - Optionally exports UF2 into ${CMAKE_BINARY_DIR}/images.
-#   - Optionally generates BLE GATT headers from app_lib GATT_FILES.
+#   - Optionally generates BLE GATT headers (and constexpr layout headers)
+#     from app_lib GATT_FILES.
 #   - Adds post-build size reporting when CMAKE_SIZE_UTIL is available.
 #
 # Typical usage (simple):
@@ -226,6 +230,15 @@ function(c7222_configure_app_target target_name app_lib)
         "LINKER:-Map=${CMAKE_BINARY_DIR}/${target_name}.map"
     )
 
+    if(C7222_ENABLE_BLE)
+        # Route BTstack's LE Secure Connections ECC through SecurityManager so
+        # the key pair and DH keys can be computed off the BTstack run loop.
+        target_link_options(${target_name} PRIVATE
+            "LINKER:--wrap=btstack_crypto_ecc_p256_generate_key"
+            "LINKER:--wrap=btstack_crypto_ecc_p256_calculate_dhkey"
+        )
+    endif()
+
     # Standard stdio/output settings for Pico targets.
     pico_enable_stdio_usb(${target_name} 0)
     pico_enable_stdio_uart(${target_name} 1)
@@ -244,11 +257,13 @@ function(c7222_configure_app_target target_name app_lib)
         )
     endif()
 
-    # Optionally compile app GATT profiles into generated headers.
+    # Optionally compile app GATT profiles into generated headers, plus the
+    # constexpr layout tables consumed by AttributeServer::Init(context, layout).
     get_property(_gatt_files TARGET ${app_lib} PROPERTY GATT_FILES)
     if(C7222_ENABLE_BLE AND _gatt_files AND NOT _gatt_files STREQUAL "NOTFOUND")
         foreach(_app_gatt_file IN LISTS _gatt_files)
             pico_btstack_make_gatt_header(${target_name} PRIVATE "${_app_gatt_file}")
+            c7222_make_gatt_layout_header(${target_name} "${_app_gatt_file}")
         endforeach()
     endif()
 
@@ -261,3 +276,58 @@ function(c7222_configure_app_target target_name app_lib)
         message(WARNING "CMAKE_SIZE_UTIL not found; size report disabled.")
     endif()
 endfunction()
+
+# -----------------------------------------------------------------------------
+# c7222_make_gatt_layout_header(target_name gatt_file)
+# Intended use:
+#   Companion of pico_btstack_make_gatt_header(). Turns the BTstack-generated
+#   ATT DB header into constexpr service/characteristic/descriptor tables so
+#   AttributeServer can build its object graph without parsing at startup.
+#
+# Inputs:
+#   target_name (required):
+#     Executable target that already called pico_btstack_make_gatt_header()
+#     for the same gatt_file (from this directory scope).
+#   gatt_file (required):
+#     Path to the .gatt profile.
+#
+# Outputs / side effects:
+#   - Generates ${CMAKE_CURRENT_BINARY_DIR}/generated/<name>_layout.hpp from
+#     ${CMAKE_CURRENT_BINARY_DIR}/generated/<name>.h using
+#     cmake/c7222_gatt_layout.py.
+#   - The header defines c7222::generated::<name>::kLayout.
+#   - Adds a build dependency so the header exists before target sources compile,
+#     and orders the layout target after pico_btstack_make_gatt_header()'s
+#     ${target_name}_gatt_header target.
+#
+# Typical usage:
+#   pico_btstack_make_gatt_header(my_app PRIVATE "${CMAKE_CURRENT_LIST_DIR}/app.gatt")
+#   c7222_make_gatt_layout_header(my_app "${CMAKE_CURRENT_LIST_DIR}/app.gatt")
+#   // in C++: #include "app_layout.hpp"
+#   //         server->Init(profile_data, c7222::generated::app::kLayout);
+function(c7222_make_gatt_layout_header target_name gatt_file)
+    find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+    get_filename_component(_gatt_name "${gatt_file}" NAME_WE)
+    # Must match the output location used by pico_btstack_make_gatt_header().
+    set(_gatt_binary_dir "${CMAKE_CURRENT_BINARY_DIR}/generated")
+    set(_gatt_header "${_gatt_binary_dir}/${_gatt_name}.h")
+    set(_gatt_layout_header "${_gatt_binary_dir}/${_gatt_name}_layout.hpp")
+    set(_gatt_layout_script "${C7222_DEVELOPMENT_CMAKE_DIR}/c7222_gatt_layout.py")
+
+    add_custom_command(
+        OUTPUT "${_gatt_layout_header}"
+        DEPENDS "${_gatt_header}" "${_gatt_layout_script}"
+        COMMAND ${Python3_EXECUTABLE} "${_gatt_layout_script}" "${_gatt_header}" "${_gatt_layout_header}"
+        COMMENT "Generating GATT layout ${_gatt_name}_layout.hpp"
+        VERBATIM
+    )
+
+    set(_gatt_layout_target "${target_name}_${_gatt_name}_gatt_layout")
+    add_custom_target(${_gatt_layout_target} DEPENDS "${_gatt_layout_header}")
+    # Order after the SDK's header target: otherwise the Makefile generators
+    # attach the compile_gatt rule to both targets and run it twice in parallel.
+    add_dependencies(${_gatt_layout_target} ${target_name}_gatt_header)
+    add_dependencies(${target_name} ${_gatt_layout_target})
+    target_include_directories(${target_name} PRIVATE "${_gatt_binary_dir}")
+endfunction()
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+"""Generate a constexpr GATT layout header from a BTstack-generated ATT DB header.
+
+Usage:
+    c7222_gatt_layout.py <input: name.h from compile_gatt.py> <output: name_layout.hpp>
+
+The input header contains the `profile_data[]` ATT DB blob. This tool walks the
+blob once at build time and emits `c7222::GattDatabaseLayout` tables (see
+libs/elec_c7222/ble/gatt/include/gatt_layout.hpp) describing services,
+characteristics, descriptors and handle ranges, so the firmware does not need
+to parse the blob at startup.
+"""
+
+import os
+import re
+import sys
+
+PRIMARY_SERVICE = 0x2800
+SECONDARY_SERVICE = 0x2801
+INCLUDED_SERVICE = 0x2802
+CHARACTERISTIC = 0x2803
+FLAG_UUID128 = 0x0200
+ENTRY_HEADER_SIZE = 6
+
+
+def fail(message):
+    sys.stderr.write("c7222_gatt_layout: error: %s\n" % message)
+    sys.exit(1)
+
+
+def read_profile_bytes(path):
+    with open(path, "r") as f:
+        text = f.read()
+    match = re.search(r"profile_data\s*\[\s*\]\s*=\s*\{(.*?)\};", text, re.S)
+    if match is None:
+        fail("no profile_data[] array found in %s" % path)
+    body = re.sub(r"//[^\n]*", "", match.group(1))
+    body = re.sub(r"/\*.*?\*/", "", body, flags=re.S)
+    data = []
+    for token in body.replace("\n", " ").split(","):
+        token = token.strip()
+        if token:
+            data.append(int(token, 0) & 0xFF)
+    return data
+
+
+def le16(data, offset):
+    return data[offset] | (data[offset + 1] << 8)
+
+
+def parse_entries(data):
+    entries = []
+    offset = 1  # skip ATT DB version byte
+    while True:
+        if offset + 2 > len(data):
+            fail("ATT DB is missing its end marker")
+        size = le16(data, offset)
+        if size == 0:
+            break
+        if size < ENTRY_HEADER_SIZE or offset + size > len(data):
+            fail("malformed ATT DB entry at offset %d" % offset)
+        flags = le16(data, offset + 2)
+        handle = le16(data, offset + 4)
+        uuid16 = None if flags & FLAG_UUID128 else le16(data, offset + 6)
+        value_offset = offset + (22 if flags & FLAG_UUID128 else 8)
+        entries.append({
+            "offset": offset,
+            "size": size,
+            "handle": handle,
+            "uuid16": uuid16,
+            "value": data[value_offset:offset + size],
+        })
+        offset += size
+    return entries, offset + 2
+
+
+def build_layout(entries):
+    def is_service(e):
+        return e["uuid16"] in (PRIMARY_SERVICE, SECONDARY_SERVICE)
+
+    services = []
+    characteristics = []
+    index = 0
+    while index < len(entries) and not is_service(entries[index]):
+        index += 1
+
+    while index < len(entries):
+        decl = index
+        end = index + 1
+        while end < len(entries) and not is_service(entries[end]):
+            end += 1
+
+        included = [i for i in range(decl + 1, end) if entries[i]["uuid16"] == INCLUDED_SERVICE]
+        if included and included != list(range(included[0], included[0] + len(included))):
+            fail("included service declarations of handle 0x%04x are not contiguous"
+                 % entries[decl]["handle"])
+
+        first_characteristic = len(characteristics)
+        i = decl + 1
+        while i < end:
+            if entries[i]["uuid16"] != CHARACTERISTIC:
+                i += 1
+                continue
+            char_end = i + 1
+            while char_end < end and entries[char_end]["uuid16"] != CHARACTERISTIC:
+                char_end += 1
+            value = entries[i]["value"]
+            if len(value) < 3:
+                fail("malformed characteristic declaration at handle 0x%04x" % entries[i]["handle"])
+            value_handle = value[1] | (value[2] << 8)
+            if i + 1 >= char_end or entries[i + 1]["handle"] != value_handle:
+                fail("value attribute of characteristic 0x%04x does not follow its declaration"
+                     % entries[i]["handle"])
+            characteristics.append((i, i + 1, i + 2, char_end - (i + 2)))
+            i = char_end
+
+        services.append((
+            decl,
+            included[0] if included else decl + 1,
+            len(included),
+            first_characteristic,
+            len(characteristics) - first_characteristic,
+            entries[decl]["handle"],
+            entries[end - 1]["handle"],
+        ))
+        index = end
+    return services, characteristics
+
+
+def identifier(name):
+    name = re.sub(r"[^0-9A-Za-z_]", "_", name)
+    if name[:1].isdigit():
+        name = "_" + name
+    return name
+
+
+def emit(out_path, source_name, entries, services, characteristics, db_size):
+    name = identifier(os.path.splitext(source_name)[0])
+    guard = "C7222_GENERATED_%s_LAYOUT_HPP_" % name.upper()
+    lines = [
+        "// Generated by c7222_gatt_layout.py from %s. Do not edit." % source_name,
+        "#ifndef %s" % guard,
+        "#define %s" % guard,
+        "",
+        '#include "gatt_layout.hpp"',
+        "",
+        "namespace c7222 {",
+        "namespace generated {",
+        "namespace %s {" % name,
+        "",
+        "// {handle, offset, size}",
+        "inline constexpr GattAttributeLayout kAttributes[] = {",
+    ]
+    for e in entries:
+        lines.append("\t{0x%04x, %d, %d}," % (e["handle"], e["offset"], e["size"]))
+    if not entries:
+        lines.append("\t{0, 0, 0},")
+    lines += [
+        "};",
+        "",
+        "// {declaration, value, first_descriptor, descriptor_count}",
+        "inline constexpr GattCharacteristicLayout kCharacteristics[] = {",
+    ]
+    for c in characteristics:
+        lines.append("\t{%d, %d, %d, %d}," % c)
+    if not characteristics:
+        lines.append("\t{0, 0, 0, 0},")
+    lines += [
+        "};",
+        "",
+        "// {declaration, first_included, included_count, first_characteristic,",
+        "//  characteristic_count, start_handle, end_handle}",
+        "inline constexpr GattServiceLayout kServices[] = {",
+    ]
+    for s in services:
+        lines.append("\t{%d, %d, %d, %d, %d, 0x%04x, 0x%04x}," % s)
+    if not services:
+        lines.append("\t{0, 0, 0, 0, 0, 0, 0},")
+    lines += [
+        "};",
+        "",
+        "inline constexpr GattDatabaseLayout kLayout{",
+        "\tkAttributes, %d," % len(entries),
+        "\tkServices, %d," % len(services),
+        "\tkCharacteristics, %d," % len(characteristics),
+        "\t%d};" % db_size,
+        "",
+        "}  // namespace %s" % name,
+        "}  // namespace generated",
+        "}  // namespace c7222",
+        "",
+        "#endif  // %s" % guard,
+        "",
+    ]
+    content = "\n".join(lines)
+    # Always rewrite: the build rule compares this file's timestamp against the
+    # input header, so skipping an unchanged write would rerun it every build.
+    with open(out_path, "w") as f:
+        f.write(content)
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write(__doc__)
+        return 2
+    data = read_profile_bytes(argv[1])
+    entries, db_size = parse_entries(data)
+    services, characteristics = build_layout(entries)
+    emit(argv[2], os.path.basename(argv[1]), entries, services, characteristics, db_size)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
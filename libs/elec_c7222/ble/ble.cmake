@@ -39,3 +39,6 @@ target_link_libraries(ELEC_C7222_BLE INTERFACE ELEC_C7222_BLE_GATT)
 
 include(${ELEC_C7222_BLE_DIR}/security_manager/security_manager.cmake)
 target_link_libraries(ELEC_C7222_BLE INTERFACE ELEC_C7222_BLE_SECURITY_MANAGER)
+
+include(${ELEC_C7222_BLE_DIR}/l2cap/l2cap.cmake)
+target_link_libraries(ELEC_C7222_BLE INTERFACE ELEC_C7222_BLE_L2CAP)
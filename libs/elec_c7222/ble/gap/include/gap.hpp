@@ -94,6 +94,14 @@ using ConnectionHandle = uint16_t;
  * if it was previously enabled. This ensures a seamless update without manual
  * intervention.
  *
+ * ### PHY and Data Length
+ *
+ * A new link starts on the LE 1M PHY with 27-octet LL packets, which caps
+ * notification throughput at roughly 100 kb/s. `RequestPhy()` and
+ * `SetDataLength()` negotiate the 2M/Coded PHY and up to 251-octet packets per
+ * connection; `SetLinkPolicy(LinkPolicy::MaxThroughput())` does both on every
+ * new connection. The resulting link is cached and exposed via `GetLinkInfo()`.
+ *
  * ---
  * ### Limitations / Future Work
  *
@@ -209,6 +217,27 @@ using ConnectionHandle = uint16_t;
  */
 class Gap : public NonCopyableNonMovable {
    public:
+	/**
+	 * @brief LL payload size every connection starts with (octets).
+	 */
+	static constexpr uint16_t kDefaultDataLengthOctets = 27;
+	/**
+	 * @brief Largest LL payload allowed by Data Length Extension (octets).
+	 */
+	static constexpr uint16_t kMaxDataLengthOctets = 251;
+	/**
+	 * @brief TX time for a 251-octet packet on the LE 1M PHY (microseconds).
+	 */
+	static constexpr uint16_t kMaxDataLengthTime = 2120;
+	/**
+	 * @brief Smallest TX time accepted by SetDataLength() (microseconds).
+	 */
+	static constexpr uint16_t kMinDataLengthTime = 328;
+	/**
+	 * @brief Largest TX time accepted by SetDataLength() (251 octets, Coded S=8).
+	 */
+	static constexpr uint16_t kMaxDataLengthCodedTime = 17040;
+
 	/**
 	 * @brief Event IDs used by Gap::EventHandler.
 	 */
@@ -1035,6 +1064,119 @@ class Gap : public NonCopyableNonMovable {
 		uint16_t supervision_timeout;
 	};
 
+	/**
+	 * @brief PHY selection bits for the PHY preference APIs.
+	 *
+	 * Values match the HCI TX_PHYS/RX_PHYS bitfields; combine with operator|.
+	 */
+	enum class PhyMask : uint8_t {
+		/**
+		 * LE 1M PHY.
+		 */
+		kLe1M = 0x01,
+		/**
+		 * LE 2M PHY.
+		 */
+		kLe2M = 0x02,
+		/**
+		 * LE Coded PHY.
+		 */
+		kLeCoded = 0x04,
+		/**
+		 * All LE PHYs.
+		 */
+		kAll = 0x07
+	};
+
+	/**
+	 * @brief Preferred coding when transmitting on the LE Coded PHY.
+	 */
+	enum class CodedPhyOptions : uint8_t {
+		/**
+		 * Let the controller choose.
+		 */
+		kNoPreference = 0x00,
+		/**
+		 * Prefer S=2 coding (500 kb/s).
+		 */
+		kS2 = 0x01,
+		/**
+		 * Prefer S=8 coding (125 kb/s, longest range).
+		 */
+		kS8 = 0x02
+	};
+
+	/**
+	 * @brief Current PHY and data length of a connection.
+	 *
+	 * Starts at the LE 1M / 27-octet defaults and follows PHY update and
+	 * data length change events.
+	 */
+	struct LinkInfo {
+		/**
+		 * @brief Transmit PHY.
+		 */
+		Phy tx_phy = Phy::kLe1M;
+		/**
+		 * @brief Receive PHY.
+		 */
+		Phy rx_phy = Phy::kLe1M;
+		/**
+		 * @brief Maximum LL payload sent per packet (octets).
+		 */
+		uint16_t max_tx_octets = kDefaultDataLengthOctets;
+		/**
+		 * @brief Maximum LL payload received per packet (octets).
+		 */
+		uint16_t max_rx_octets = kDefaultDataLengthOctets;
+	};
+
+	/**
+	 * @brief PHY and data length requested automatically on every new connection.
+	 *
+	 * The default policy is disabled; MaxThroughput() asks for the 2M PHY and
+	 * the largest LL payload, which is what high-rate notification streams need.
+	 */
+	struct LinkPolicy {
+		/**
+		 * @brief Apply the policy when a connection completes.
+		 */
+		bool enabled = false;
+		/**
+		 * @brief Preferred transmit PHYs (PhyMask bits, 0 = leave unchanged).
+		 */
+		uint8_t tx_phys = 0;
+		/**
+		 * @brief Preferred receive PHYs (PhyMask bits, 0 = leave unchanged).
+		 */
+		uint8_t rx_phys = 0;
+		/**
+		 * @brief Coding preference when the Coded PHY is selected.
+		 */
+		CodedPhyOptions coded_options = CodedPhyOptions::kNoPreference;
+		/**
+		 * @brief Requested LL TX payload (octets, 0 = leave unchanged).
+		 */
+		uint16_t tx_octets = 0;
+		/**
+		 * @brief Requested LL TX time (microseconds).
+		 */
+		uint16_t tx_time = 0;
+
+		/**
+		 * @brief 2M PHY in both directions and 251-octet LL packets.
+		 */
+		static LinkPolicy MaxThroughput() {
+			LinkPolicy policy;
+			policy.enabled = true;
+			policy.tx_phys = static_cast<uint8_t>(PhyMask::kLe2M);
+			policy.rx_phys = static_cast<uint8_t>(PhyMask::kLe2M);
+			policy.tx_octets = kMaxDataLengthOctets;
+			policy.tx_time = kMaxDataLengthTime;
+			return policy;
+		}
+	};
+
 	/**
 	 * @brief Set a fixed random address for advertising.
 	 */
@@ -1119,6 +1261,81 @@ class Gap : public NonCopyableNonMovable {
 	 */
 	BleError Disconnect(ConnectionHandle con_handle);
 
+	/// \name PHY and Data Length
+	///@{
+	/**
+	 * @brief Set the PHYs the controller prefers for new and updated links.
+	 *
+	 * If the controller cannot take the command yet (e.g. before the stack is
+	 * up) it is kept and sent after the next HCI command completes.
+	 *
+	 * @param tx_phys PhyMask bits allowed for transmit (0 = no preference).
+	 * @param rx_phys PhyMask bits allowed for receive (0 = no preference).
+	 * @return kInvalidHciCommandParameters for unknown bits, otherwise kSuccess
+	 *         or the controller error.
+	 */
+	BleError SetPreferredPhy(uint8_t tx_phys, uint8_t rx_phys);
+
+	/**
+	 * @brief Start the PHY update procedure on a connection.
+	 *
+	 * The outcome is reported through EventHandler::OnPhyUpdateComplete().
+	 *
+	 * @param con_handle Connection handle.
+	 * @param tx_phys PhyMask bits allowed for transmit (0 = no preference).
+	 * @param rx_phys PhyMask bits allowed for receive (0 = no preference).
+	 * @param coded_options Coding preference when the Coded PHY is chosen.
+	 */
+	BleError RequestPhy(ConnectionHandle con_handle,
+						uint8_t tx_phys,
+						uint8_t rx_phys,
+						CodedPhyOptions coded_options = CodedPhyOptions::kNoPreference);
+
+	/**
+	 * @brief Read the current PHYs of a connection.
+	 *
+	 * The result is reported through EventHandler::OnReadPhy().
+	 */
+	BleError ReadPhy(ConnectionHandle con_handle);
+
+	/**
+	 * @brief Request a larger (or smaller) LL payload on a connection.
+	 *
+	 * Busy controllers are handled like SetPreferredPhy(). The negotiated
+	 * values are reported through EventHandler::OnDataLengthChange().
+	 *
+	 * @param con_handle Connection handle.
+	 * @param tx_octets Requested TX payload, 27..251 octets.
+	 * @param tx_time Requested TX time, 328..17040 microseconds.
+	 */
+	BleError SetDataLength(ConnectionHandle con_handle, uint16_t tx_octets, uint16_t tx_time);
+
+	/**
+	 * @brief Set the PHY/data length policy applied to every new connection.
+	 *
+	 * Use LinkPolicy::MaxThroughput() for streaming workloads.
+	 */
+	void SetLinkPolicy(const LinkPolicy& policy) {
+		link_policy_ = policy;
+	}
+
+	/**
+	 * @brief Get the current connection link policy.
+	 */
+	[[nodiscard]] const LinkPolicy& GetLinkPolicy() const {
+		return link_policy_;
+	}
+
+	/**
+	 * @brief Get the cached PHY and data length of a connection.
+	 *
+	 * @param con_handle Connection handle.
+	 * @param out Link info output.
+	 * @return true if the handle is a known connection.
+	 */
+	bool GetLinkInfo(ConnectionHandle con_handle, LinkInfo& out) const;
+	///@}
+
 	/**
 	 * @brief Read the local device address.
 	 */
@@ -1325,6 +1542,53 @@ class Gap : public NonCopyableNonMovable {
 	 */
 	static Gap* instance_;
 
+	/**
+	 * @brief Data length request waiting for the controller.
+	 */
+	struct PendingDataLength {
+		uint16_t tx_octets;
+		uint16_t tx_time;
+	};
+
+	/// \name Link Bookkeeping (common)
+	///@{
+	/**
+	 * @brief Start tracking a new connection and apply the link policy.
+	 */
+	void HandleLinkConnected(ConnectionHandle con_handle);
+	/**
+	 * @brief Drop all link state of a closed connection.
+	 */
+	void HandleLinkDisconnected(ConnectionHandle con_handle);
+	/**
+	 * @brief Record the PHYs reported by a PHY update.
+	 */
+	void HandlePhyUpdate(uint8_t status, ConnectionHandle con_handle, Phy tx_phy, Phy rx_phy);
+	/**
+	 * @brief Record the payload sizes reported by a data length change.
+	 */
+	void HandleDataLengthChange(ConnectionHandle con_handle, uint16_t tx_octets, uint16_t rx_octets);
+	/**
+	 * @brief Retry link commands the controller could not take earlier.
+	 */
+	void ServicePendingLinkCommands();
+	/**
+	 * @brief True if a link command failed only because the controller was busy.
+	 */
+	static bool IsControllerBusy(BleError status);
+	///@}
+
+	/// \name Link Commands (platform)
+	///@{
+	BleError SendDefaultPhy(uint8_t tx_phys, uint8_t rx_phys);
+	BleError SendPhyRequest(ConnectionHandle con_handle,
+							uint8_t tx_phys,
+							uint8_t rx_phys,
+							CodedPhyOptions coded_options);
+	BleError SendReadPhy(ConnectionHandle con_handle);
+	BleError SendDataLength(ConnectionHandle con_handle, uint16_t tx_octets, uint16_t tx_time);
+	///@}
+
 	/**
 	 * @brief True when advertising is enabled by the application.
 	 */
@@ -1379,6 +1643,24 @@ class Gap : public NonCopyableNonMovable {
 	 * @brief Cached connection parameters per handle.
 	 */
 	std::map<ConnectionHandle, ConnectionParameters> connection_parameters_;
+	/**
+	 * @brief Cached PHY and data length per handle.
+	 */
+	std::map<ConnectionHandle, LinkInfo> link_info_;
+	/**
+	 * @brief Policy applied by HandleLinkConnected().
+	 */
+	LinkPolicy link_policy_{};
+	/**
+	 * @brief Default PHY preference not yet accepted by the controller.
+	 */
+	bool default_phy_pending_ = false;
+	uint8_t preferred_tx_phys_ = 0;
+	uint8_t preferred_rx_phys_ = 0;
+	/**
+	 * @brief Data length requests not yet accepted by the controller.
+	 */
+	std::map<ConnectionHandle, PendingDataLength> pending_data_length_;
 	/**
 	 * @brief Registered event handlers.
 	 */
@@ -1398,6 +1680,10 @@ constexpr uint8_t operator|(c7222::Gap::AdvertisingChannelMap lhs,
 							c7222::Gap::AdvertisingChannelMap rhs) {
 	return static_cast<uint8_t>(lhs) | static_cast<uint8_t>(rhs);
 }
+
+constexpr uint8_t operator|(c7222::Gap::PhyMask lhs, c7222::Gap::PhyMask rhs) {
+	return static_cast<uint8_t>(lhs) | static_cast<uint8_t>(rhs);
+}
 constexpr uint8_t operator|(uint8_t lhs, c7222::Gap::AdvertisingChannelMap rhs) {
 	uint8_t ret = lhs | static_cast<uint8_t>(rhs);
 	assert(ret <= static_cast<uint8_t>(c7222::Gap::AdvertisingChannelMap::kAll));
@@ -0,0 +1,252 @@
+#include "gap.hpp"
+#include "ble_utils.hpp"
+
+namespace c7222 {
+
+extern "C" {
+/// Hooks implemented by the simulated controller; each returns a BTstack status
+/// (0 = success, 0x0C = command disallowed / busy). Results are fed back
+/// through Gap::DispatchBleHciPacket() using the HCI event layout.
+uint8_t c7222_grader_gap_set_default_phy(uint8_t all_phys, uint8_t tx_phys, uint8_t rx_phys);
+uint8_t c7222_grader_gap_set_phy(uint16_t con_handle,
+								 uint8_t all_phys,
+								 uint8_t tx_phys,
+								 uint8_t rx_phys,
+								 uint8_t phy_options);
+uint8_t c7222_grader_gap_read_phy(uint16_t con_handle);
+uint8_t c7222_grader_gap_set_data_length(uint16_t con_handle, uint16_t tx_octets, uint16_t tx_time);
+}
+
+namespace {
+
+// HCI event layout used by the simulated controller
+constexpr uint8_t kHciEventPacket = 0x04;
+constexpr uint8_t kEventDisconnectionComplete = 0x05;
+constexpr uint8_t kEventCommandComplete = 0x0E;
+constexpr uint8_t kEventLeMeta = 0x3E;
+constexpr uint8_t kSubeventConnectionComplete = 0x01;
+constexpr uint8_t kSubeventDataLengthChange = 0x07;
+constexpr uint8_t kSubeventEnhancedConnectionComplete = 0x0A;
+constexpr uint8_t kSubeventPhyUpdateComplete = 0x0C;
+constexpr uint16_t kOpcodeLeReadPhy = 0x2030;
+constexpr uint16_t kDisconnectionCompleteSize = 6;
+constexpr uint16_t kCommandCompleteSize = 6;
+constexpr uint16_t kReadPhyCompleteSize = 11;
+constexpr uint16_t kConnectionCompleteSize = 21;
+constexpr uint16_t kEnhancedConnectionCompleteSize = 33;
+constexpr uint16_t kPhyUpdateCompleteSize = 8;
+constexpr uint16_t kDataLengthChangeSize = 13;
+constexpr uint8_t kErrorCommandDisallowed = 0x0C;
+constexpr uint8_t kErrorUnknownConnectionIdentifier = 0x02;
+
+uint16_t ReadLe16(const uint8_t* data) {
+	return static_cast<uint16_t>(data[0] | (static_cast<uint16_t>(data[1]) << 8));
+}
+
+BleError ToBleError(uint8_t status) {
+	switch(status) {
+	case 0:
+		return BleError::kSuccess;
+	case kErrorCommandDisallowed:
+		return BleError::kCommandDisallowed;
+	case kErrorUnknownConnectionIdentifier:
+		return BleError::kUnknownConnectionIdentifier;
+	default:
+		return BleError::kUnspecifiedError;
+	}
+}
+
+Gap::Phy ToPhy(uint8_t value) {
+	return value <= static_cast<uint8_t>(Gap::Phy::kLeCoded) ? static_cast<Gap::Phy>(value)
+															 : Gap::Phy::kNone;
+}
+
+uint8_t AllPhys(uint8_t tx_phys, uint8_t rx_phys) {
+	return static_cast<uint8_t>((tx_phys == 0 ? 0x01 : 0x00) | (rx_phys == 0 ? 0x02 : 0x00));
+}
+
+// Peer address as carried in connection events: type(1) address(6, little endian)
+BleAddress ReadAddress(const uint8_t* data) {
+	uint8_t address[BleAddress::kLength]{};
+	for(size_t i = 0; i < BleAddress::kLength; ++i) {
+		address[i] = data[1 + BleAddress::kLength - 1 - i];
+	}
+	const auto type = data[0] <= static_cast<uint8_t>(BleAddress::AddressType::kLeRandomIdentity)
+						  ? static_cast<BleAddress::AddressType>(data[0])
+						  : BleAddress::AddressType::kUnknown;
+	return BleAddress(type, address);
+}
+
+}  // namespace
+
+BleError Gap::SendDefaultPhy(uint8_t tx_phys, uint8_t rx_phys) {
+	return ToBleError(c7222_grader_gap_set_default_phy(AllPhys(tx_phys, rx_phys), tx_phys, rx_phys));
+}
+
+BleError Gap::SendPhyRequest(ConnectionHandle con_handle,
+							 uint8_t tx_phys,
+							 uint8_t rx_phys,
+							 CodedPhyOptions coded_options) {
+	return ToBleError(c7222_grader_gap_set_phy(con_handle,
+											   AllPhys(tx_phys, rx_phys),
+											   tx_phys,
+											   rx_phys,
+											   static_cast<uint8_t>(coded_options)));
+}
+
+BleError Gap::SendReadPhy(ConnectionHandle con_handle) {
+	return ToBleError(c7222_grader_gap_read_phy(con_handle));
+}
+
+BleError Gap::SendDataLength(ConnectionHandle con_handle, uint16_t tx_octets, uint16_t tx_time) {
+	return ToBleError(c7222_grader_gap_set_data_length(con_handle, tx_octets, tx_time));
+}
+
+BleError Gap::DispatchBleHciPacket(uint8_t packet_type,
+								   const uint8_t* packet_data,
+								   uint16_t packet_data_size) {
+	if(packet_type != kHciEventPacket || packet_data == nullptr || packet_data_size < 3) {
+		return BleError::kSuccess;
+	}
+	// The simulated controller only drives the connection lifecycle and link events.
+	switch(packet_data[0]) {
+	case kEventDisconnectionComplete:
+		return DispatchEvent(EventId::kDisconnectionComplete, packet_data, packet_data_size);
+	case kEventCommandComplete:
+		return DispatchEvent(EventId::kCommandComplete, packet_data, packet_data_size);
+	case kEventLeMeta:
+		switch(packet_data[2]) {
+		case kSubeventConnectionComplete:
+			return DispatchEvent(EventId::kLeConnectionComplete, packet_data, packet_data_size);
+		case kSubeventEnhancedConnectionComplete:
+			return DispatchEvent(EventId::kLeEnhancedConnectionComplete, packet_data, packet_data_size);
+		case kSubeventPhyUpdateComplete:
+			return DispatchEvent(EventId::kLePhyUpdateComplete, packet_data, packet_data_size);
+		case kSubeventDataLengthChange:
+			return DispatchEvent(EventId::kLeDataLengthChange, packet_data, packet_data_size);
+		default:
+			break;
+		}
+		break;
+	default:
+		break;
+	}
+	return BleError::kSuccess;
+}
+
+BleError Gap::DispatchEvent(EventId event_id,
+							const uint8_t* event_data,
+							uint16_t event_data_size) {
+	switch(event_id) {
+	case EventId::kDisconnectionComplete: {
+		// status(1) handle(2) reason(1)
+		if(event_data_size < kDisconnectionCompleteSize) {
+			break;
+		}
+		const uint8_t status = event_data[2];
+		const auto con_handle = static_cast<ConnectionHandle>(ReadLe16(&event_data[3]) & 0x0FFF);
+		const uint8_t reason = event_data[5];
+		connection_parameters_.erase(con_handle);
+		connected_ = !connection_parameters_.empty();
+		HandleLinkDisconnected(con_handle);
+		for(const auto* handler: event_handlers_) {
+			handler->OnDisconnectionComplete(status, con_handle, reason);
+		}
+		break;
+	}
+	case EventId::kCommandComplete: {
+		// num_hci_command_packets(1) opcode(2) return_parameters
+		if(event_data_size < kCommandCompleteSize) {
+			break;
+		}
+		ServicePendingLinkCommands();
+		const uint16_t opcode = ReadLe16(&event_data[3]);
+		if(opcode == kOpcodeLeReadPhy && event_data_size >= kReadPhyCompleteSize) {
+			// status(1) handle(2) tx_phy(1) rx_phy(1)
+			const uint8_t status = event_data[5];
+			const auto con_handle = static_cast<ConnectionHandle>(ReadLe16(&event_data[6]));
+			const Phy tx_phy = ToPhy(event_data[8]);
+			const Phy rx_phy = ToPhy(event_data[9]);
+			HandlePhyUpdate(status, con_handle, tx_phy, rx_phy);
+			for(const auto* handler: event_handlers_) {
+				handler->OnReadPhy(status, con_handle, tx_phy, rx_phy);
+			}
+		}
+		break;
+	}
+	case EventId::kLeConnectionComplete:
+	case EventId::kLeEnhancedConnectionComplete: {
+		// status(1) handle(2) role(1) peer_address_type(1) peer_address(6)
+		// [local_rpa(6) peer_rpa(6)] interval(2) latency(2) supervision_timeout(2)
+		const bool enhanced = event_id == EventId::kLeEnhancedConnectionComplete;
+		if(event_data_size < (enhanced ? kEnhancedConnectionCompleteSize : kConnectionCompleteSize)) {
+			break;
+		}
+		const uint8_t status = event_data[3];
+		const auto con_handle = static_cast<ConnectionHandle>(ReadLe16(&event_data[4]));
+		const BleAddress address = ReadAddress(&event_data[7]);
+		const uint16_t params_offset = enhanced ? 26 : 14;
+		const uint16_t conn_interval = ReadLe16(&event_data[params_offset]);
+		const uint16_t conn_latency = ReadLe16(&event_data[params_offset + 2]);
+		const uint16_t supervision_timeout = ReadLe16(&event_data[params_offset + 4]);
+
+		if(status == 0) {
+			connection_parameters_[con_handle] = {conn_interval, conn_latency, supervision_timeout};
+			connected_ = true;
+			HandleLinkConnected(con_handle);
+			if(advertising_) {
+				advertising_ = false;
+				advertisement_enabled_ = false;
+				for(const auto* handler: event_handlers_) {
+					handler->OnAdvertisingEnd(status, con_handle);
+				}
+			}
+		}
+
+		for(const auto* handler: event_handlers_) {
+			handler->OnConnectionComplete(status,
+										  con_handle,
+										  address,
+										  conn_interval,
+										  conn_latency,
+										  supervision_timeout);
+		}
+		break;
+	}
+	case EventId::kLePhyUpdateComplete: {
+		// status(1) handle(2) tx_phy(1) rx_phy(1)
+		if(event_data_size < kPhyUpdateCompleteSize) {
+			break;
+		}
+		const uint8_t status = event_data[3];
+		const auto con_handle = static_cast<ConnectionHandle>(ReadLe16(&event_data[4]));
+		const Phy tx_phy = ToPhy(event_data[6]);
+		const Phy rx_phy = ToPhy(event_data[7]);
+		HandlePhyUpdate(status, con_handle, tx_phy, rx_phy);
+		for(const auto* handler: event_handlers_) {
+			handler->OnPhyUpdateComplete(status, con_handle, tx_phy, rx_phy);
+		}
+		break;
+	}
+	case EventId::kLeDataLengthChange: {
+		// handle(2) max_tx_octets(2) max_tx_time(2) max_rx_octets(2) max_rx_time(2)
+		if(event_data_size < kDataLengthChangeSize) {
+			break;
+		}
+		const auto con_handle = static_cast<ConnectionHandle>(ReadLe16(&event_data[3]));
+		const uint16_t tx_size = ReadLe16(&event_data[5]);
+		const uint16_t rx_size = ReadLe16(&event_data[9]);
+		HandleDataLengthChange(con_handle, tx_size, rx_size);
+		for(const auto* handler: event_handlers_) {
+			handler->OnDataLengthChange(con_handle, tx_size, rx_size);
+		}
+		break;
+	}
+	default:
+		C7222_BLE_DEBUG_PRINT("[BLE][GAP] Event %u not simulated (grader)\n", static_cast<unsigned>(event_id));
+		break;
+	}
+	return BleError::kSuccess;
+}
+
+}  // namespace c7222
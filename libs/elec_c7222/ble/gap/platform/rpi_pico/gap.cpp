@@ -129,28 +129,40 @@ BleError Gap::Disconnect(ConnectionHandle con_handle) {
 	return map_btstack_status(gap_disconnect(con_handle));
 }
 
-void Gap::SetLocalAddress(BleAddress& address) {
-	uint8_t addr_type = BD_ADDR_TYPE_UNKNOWN;
-	bd_addr_t addr{};
-	gap_le_get_own_address(&addr_type, addr);
-	address = BleAddress(map_address_type(addr_type), addr);
+BleError Gap::SendDefaultPhy(uint8_t tx_phys, uint8_t rx_phys) {
+	// Commands issued before the HCI init sequence finishes would be lost.
+	if(hci_get_state() != HCI_STATE_WORKING) {
+		return BleError::kCommandDisallowed;
+	}
+	const uint8_t all_phys = (tx_phys == 0 ? 0x01 : 0x00) | (rx_phys == 0 ? 0x02 : 0x00);
+	return map_btstack_status(hci_send_cmd(&hci_le_set_default_phy, all_phys, tx_phys, rx_phys));
 }
 
-void Gap::AddEventHandler(const EventHandler& handler) {
-	event_handlers_.push_back(&handler);
+BleError Gap::SendPhyRequest(ConnectionHandle con_handle,
+							 uint8_t tx_phys,
+							 uint8_t rx_phys,
+							 CodedPhyOptions coded_options) {
+	const uint8_t all_phys = (tx_phys == 0 ? 0x01 : 0x00) | (rx_phys == 0 ? 0x02 : 0x00);
+	return map_btstack_status(gap_le_set_phy(con_handle,
+											 all_phys,
+											 tx_phys,
+											 rx_phys,
+											 static_cast<uint8_t>(coded_options)));
 }
 
-bool Gap::RemoveEventHandler(const EventHandler& handler) {
-	auto it = std::find(event_handlers_.begin(), event_handlers_.end(), &handler);
-	if(it != event_handlers_.end()) {
-		event_handlers_.erase(it);
-		return true;
-	}
-	return false;
+BleError Gap::SendReadPhy(ConnectionHandle con_handle) {
+	return map_btstack_status(hci_send_cmd(&hci_le_read_phy, con_handle));
 }
 
-void Gap::ClearEventHandlers() {
-	event_handlers_.clear();
+BleError Gap::SendDataLength(ConnectionHandle con_handle, uint16_t tx_octets, uint16_t tx_time) {
+	return map_btstack_status(hci_send_cmd(&hci_le_set_data_length, con_handle, tx_octets, tx_time));
+}
+
+void Gap::SetLocalAddress(BleAddress& address) {
+	uint8_t addr_type = BD_ADDR_TYPE_UNKNOWN;
+	bd_addr_t addr{};
+	gap_le_get_own_address(&addr_type, addr);
+	address = BleAddress(map_address_type(addr_type), addr);
 }
 
 BleError Gap::DispatchBleHciPacket(uint8_t packet_type,
@@ -338,12 +350,15 @@ BleError Gap::DispatchEvent(EventId event_id,
 		const uint8_t reason = hci_event_disconnection_complete_get_reason(event_data);
 		connection_parameters_.erase(con_handle);
 		connected_ = !connection_parameters_.empty();
+		HandleLinkDisconnected(con_handle);
 		for(const auto* handler: event_handlers_) {
 			handler->OnDisconnectionComplete(status, con_handle, reason);
 		}
 		break;
 	}
 	case EventId::kCommandComplete: {
+		// The controller just freed a command slot.
+		ServicePendingLinkCommands();
 		const uint16_t opcode = hci_event_command_complete_get_command_opcode(event_data);
 		const uint8_t* return_params = hci_event_command_complete_get_return_parameters(event_data);
 		const uint8_t status = return_params != nullptr ? return_params[0]
@@ -377,6 +392,7 @@ BleError Gap::DispatchEvent(EventId event_id,
 					static_cast<ConnectionHandle>(little_endian_read_16(return_params, 1));
 				const Gap::Phy tx_phy = map_phy(return_params[3]);
 				const Gap::Phy rx_phy = map_phy(return_params[4]);
+				HandlePhyUpdate(status, con_handle, tx_phy, rx_phy);
 				for(const auto* handler: event_handlers_) {
 					handler->OnReadPhy(status, con_handle, tx_phy, rx_phy);
 				}
@@ -463,6 +479,7 @@ BleError Gap::DispatchEvent(EventId event_id,
 		if(status == ERROR_CODE_SUCCESS) {
 			connection_parameters_[con_handle] = {conn_interval, conn_latency, supervision_timeout};
 			connected_ = true;
+			HandleLinkConnected(con_handle);
 			if(advertising_) {
 				advertising_ = false;
 				advertisement_enabled_ = false;
@@ -503,6 +520,7 @@ BleError Gap::DispatchEvent(EventId event_id,
 		if(status == ERROR_CODE_SUCCESS) {
 			connection_parameters_[con_handle] = {conn_interval, conn_latency, supervision_timeout};
 			connected_ = true;
+			HandleLinkConnected(con_handle);
 			if(advertising_) {
 				advertising_ = false;
 				advertisement_enabled_ = false;
@@ -574,6 +592,7 @@ BleError Gap::DispatchEvent(EventId event_id,
 		const Gap::Phy tx_phy = map_phy(hci_subevent_le_phy_update_complete_get_tx_phy(event_data));
 		const uint8_t rx_phy_raw = event_data_size > 7 ? event_data[7] : 0x00;
 		const Gap::Phy rx_phy = map_phy(rx_phy_raw);
+		HandlePhyUpdate(status, con_handle, tx_phy, rx_phy);
 		for(const auto* handler: event_handlers_) {
 			handler->OnPhyUpdateComplete(status, con_handle, tx_phy, rx_phy);
 		}
@@ -584,6 +603,7 @@ BleError Gap::DispatchEvent(EventId event_id,
 			hci_subevent_le_data_length_change_get_connection_handle(event_data));
 		const uint16_t tx_size = hci_subevent_le_data_length_change_get_max_tx_octets(event_data);
 		const uint16_t rx_size = hci_subevent_le_data_length_change_get_max_rx_octets(event_data);
+		HandleDataLengthChange(con_handle, tx_size, rx_size);
 		for(const auto* handler: event_handlers_) {
 			handler->OnDataLengthChange(con_handle, tx_size, rx_size);
 		}
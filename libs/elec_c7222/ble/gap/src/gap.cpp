@@ -1,5 +1,9 @@
 #include "gap.hpp"
 
+#include <algorithm>
+
+#include "ble_utils.hpp"
+
 namespace c7222 {
 
 Gap* Gap::instance_ = nullptr;
@@ -24,6 +28,23 @@ void Gap::SetAdvertisingData(const AdvertisementDataBuilder& data_builder) {
 	SetAdvertisingData(advertisement_data_builder_.data());
 }
 
+void Gap::AddEventHandler(const EventHandler& handler) {
+	event_handlers_.push_back(&handler);
+}
+
+bool Gap::RemoveEventHandler(const EventHandler& handler) {
+	auto it = std::find(event_handlers_.begin(), event_handlers_.end(), &handler);
+	if(it != event_handlers_.end()) {
+		event_handlers_.erase(it);
+		return true;
+	}
+	return false;
+}
+
+void Gap::ClearEventHandlers() {
+	event_handlers_.clear();
+}
+
 bool Gap::GetConnectionParameters(ConnectionHandle con_handle, ConnectionParameters& out) const {
 	const auto it = connection_parameters_.find(con_handle);
 	if(it == connection_parameters_.end()) {
@@ -50,5 +71,134 @@ bool Gap::GetRandomAddress(BleAddress& address) const {
 	return true;
 }
 
+BleError Gap::SetPreferredPhy(uint8_t tx_phys, uint8_t rx_phys) {
+	if(((tx_phys | rx_phys) & ~static_cast<uint8_t>(PhyMask::kAll)) != 0) {
+		return BleError::kInvalidHciCommandParameters;
+	}
+	preferred_tx_phys_ = tx_phys;
+	preferred_rx_phys_ = rx_phys;
+	const BleError status = SendDefaultPhy(tx_phys, rx_phys);
+	default_phy_pending_ = IsControllerBusy(status);
+	return default_phy_pending_ ? BleError::kSuccess : status;
+}
+
+BleError Gap::RequestPhy(ConnectionHandle con_handle,
+						 uint8_t tx_phys,
+						 uint8_t rx_phys,
+						 CodedPhyOptions coded_options) {
+	if(((tx_phys | rx_phys) & ~static_cast<uint8_t>(PhyMask::kAll)) != 0) {
+		return BleError::kInvalidHciCommandParameters;
+	}
+	if(link_info_.find(con_handle) == link_info_.end()) {
+		return BleError::kUnknownConnectionIdentifier;
+	}
+	return SendPhyRequest(con_handle, tx_phys, rx_phys, coded_options);
+}
+
+BleError Gap::ReadPhy(ConnectionHandle con_handle) {
+	if(link_info_.find(con_handle) == link_info_.end()) {
+		return BleError::kUnknownConnectionIdentifier;
+	}
+	return SendReadPhy(con_handle);
+}
+
+BleError Gap::SetDataLength(ConnectionHandle con_handle, uint16_t tx_octets, uint16_t tx_time) {
+	if(tx_octets < kDefaultDataLengthOctets || tx_octets > kMaxDataLengthOctets ||
+	   tx_time < kMinDataLengthTime || tx_time > kMaxDataLengthCodedTime) {
+		return BleError::kInvalidHciCommandParameters;
+	}
+	if(link_info_.find(con_handle) == link_info_.end()) {
+		return BleError::kUnknownConnectionIdentifier;
+	}
+	const BleError status = SendDataLength(con_handle, tx_octets, tx_time);
+	if(IsControllerBusy(status)) {
+		pending_data_length_[con_handle] = {tx_octets, tx_time};
+		return BleError::kSuccess;
+	}
+	pending_data_length_.erase(con_handle);
+	return status;
+}
+
+bool Gap::GetLinkInfo(ConnectionHandle con_handle, LinkInfo& out) const {
+	const auto it = link_info_.find(con_handle);
+	if(it == link_info_.end()) {
+		return false;
+	}
+	out = it->second;
+	return true;
+}
+
+void Gap::HandleLinkConnected(ConnectionHandle con_handle) {
+	link_info_[con_handle] = LinkInfo{};
+	// Give a deferred default PHY a chance before the per-link requests.
+	ServicePendingLinkCommands();
+	if(!link_policy_.enabled) {
+		return;
+	}
+	if(link_policy_.tx_phys != 0 || link_policy_.rx_phys != 0) {
+		const BleError status = RequestPhy(con_handle,
+										   link_policy_.tx_phys,
+										   link_policy_.rx_phys,
+										   link_policy_.coded_options);
+		(void)status;
+		C7222_BLE_DEBUG_PRINT("[BLE][GAP] Link policy PHY request on 0x%04x: %u\n",
+			static_cast<unsigned>(con_handle),
+			static_cast<unsigned>(status));
+	}
+	if(link_policy_.tx_octets != 0) {
+		const BleError status = SetDataLength(con_handle, link_policy_.tx_octets, link_policy_.tx_time);
+		(void)status;
+		C7222_BLE_DEBUG_PRINT("[BLE][GAP] Link policy data length on 0x%04x: %u\n",
+			static_cast<unsigned>(con_handle),
+			static_cast<unsigned>(status));
+	}
+}
+
+void Gap::HandleLinkDisconnected(ConnectionHandle con_handle) {
+	link_info_.erase(con_handle);
+	pending_data_length_.erase(con_handle);
+}
+
+void Gap::HandlePhyUpdate(uint8_t status, ConnectionHandle con_handle, Phy tx_phy, Phy rx_phy) {
+	if(status != 0) {
+		return;
+	}
+	const auto it = link_info_.find(con_handle);
+	if(it == link_info_.end()) {
+		return;
+	}
+	it->second.tx_phy = tx_phy;
+	it->second.rx_phy = rx_phy;
+}
+
+void Gap::HandleDataLengthChange(ConnectionHandle con_handle, uint16_t tx_octets, uint16_t rx_octets) {
+	const auto it = link_info_.find(con_handle);
+	if(it == link_info_.end()) {
+		return;
+	}
+	it->second.max_tx_octets = tx_octets;
+	it->second.max_rx_octets = rx_octets;
+}
+
+void Gap::ServicePendingLinkCommands() {
+	// One command per completion keeps us inside the controller's command window.
+	if(default_phy_pending_) {
+		default_phy_pending_ = IsControllerBusy(SendDefaultPhy(preferred_tx_phys_, preferred_rx_phys_));
+		return;
+	}
+	const auto it = pending_data_length_.begin();
+	if(it == pending_data_length_.end()) {
+		return;
+	}
+	const ConnectionHandle con_handle = it->first;
+	const PendingDataLength request = it->second;
+	if(!IsControllerBusy(SendDataLength(con_handle, request.tx_octets, request.tx_time))) {
+		pending_data_length_.erase(con_handle);
+	}
+}
+
+bool Gap::IsControllerBusy(BleError status) {
+	return status == BleError::kBtstackAclBuffersFull || status == BleError::kCommandDisallowed;
+}
 
-}
\ No newline at end of file
+}  // namespace c7222
@@ -7,10 +7,13 @@
 
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "attribute_value.hpp"
 #include "ble_error.hpp"
+#include "compact_uuid.hpp"
 #include "non_copyable.hpp"
 #include "uuid.hpp"
 
@@ -38,13 +41,17 @@ namespace c7222 {
  *     Attribute; use `SetStaticValue()` to own a copy.
  *   - Optional override: `SetStaticValue()` repoints `static_value_ptr_`, allowing
  *     a controlled, owned static value without toggling `kDynamic`.
- * - Dynamic attributes (`kDynamic` set): keep a mutable `std::vector` that
- *   can be updated at runtime. Dynamic attributes rely on callbacks and
- *   writable storage; copying into a vector provides ownership and resize
+ * - Dynamic attributes (`kDynamic` set): keep a mutable `AttributeValue`
+ *   that can be updated at runtime. Dynamic attributes rely on callbacks and
+ *   writable storage; copying into owned storage provides ownership and resize
  *   capability that a DB-backed pointer cannot offer.
- *   - Storage: `dynamic_value_` owns the bytes and can grow/shrink.
+ *   - Storage: `dynamic_value_` owns the bytes. Values up to
+ *     `AttributeValue::kInlineCapacity` bytes are stored inline; larger ones
+ *     use a heap block that is reused by later values that fit.
  *   - Mutability: `SetValue()` and write callbacks may update contents.
- *   - Access: `GetValueData()` returns the vector data pointer; size is
+ *     `SetValue()` from a pointer or trivial type does not allocate for
+ *     values that fit inline.
+ *   - Access: `GetValueData()` returns the storage data pointer; size is
  *     `dynamic_value_.size()`.
  *   - Writes: `InvokeWriteCallback()` stores data even if no write callback
  *     is installed; callbacks are optional for dynamic attributes.
@@ -414,10 +421,11 @@ class Attribute : public MovableOnly {
 
 	/**
 	 * @brief Get the attribute UUID.
-	 * @return Reference to the UUID identifying this attribute type
+	 * @return UUID identifying this attribute type (expanded from the
+	 *         compact representation)
 	 */
-	[[nodiscard]] const Uuid& GetUuid() const {
-		return uuid_;
+	[[nodiscard]] Uuid GetUuid() const {
+		return uuid_.ToUuid();
 	}
 
 	/**
@@ -489,18 +497,18 @@ class Attribute : public MovableOnly {
 	///@{
 
 	/**
-	 * @brief Get value as vector (for compatibility).
+	 * @brief Get a copy of the dynamic value as a vector (for compatibility).
 	 * Note: Returns empty for static attributes because they are DB-backed.
 	 */
-	[[nodiscard]] const std::vector<uint8_t>& GetDynamicValue() const {
-		return dynamic_value_;
+	[[nodiscard]] std::vector<uint8_t> GetDynamicValue() const {
+		return dynamic_value_.ToVector();
 	}
 
 	/**
 	 * @brief Get pointer to attribute value data.
 	 * @return Pointer to value data, or nullptr if no value
 	 * @note Static attributes return the ATT DB pointer; dynamic attributes
-	 * return the owned vector data pointer.
+	 * return the owned storage pointer (valid until the next write).
 	 */
 	[[nodiscard]] const uint8_t* GetValueData() const {
 		if((properties_ & static_cast<uint16_t>(Properties::kDynamic)) != 0) {
@@ -512,7 +520,7 @@ class Attribute : public MovableOnly {
 	/**
 	 * @brief Get size of attribute value.
 	 * @return Size of value in bytes
-	 * @note Mirrors the storage choice: DB size for static, vector size for dynamic.
+	 * @note Mirrors the storage choice: DB size for static, owned size for dynamic.
 	 */
 	[[nodiscard]] size_t GetValueSize() const {
 		if((properties_ & static_cast<uint16_t>(Properties::kDynamic)) != 0) {
@@ -541,9 +549,10 @@ class Attribute : public MovableOnly {
 	bool SetStaticValue(const uint8_t* data, size_t size);
 
 	/**
-	 * @brief Set attribute value from rvalue vector (move semantics).
+	 * @brief Set attribute value from rvalue vector.
 	 * Only allowed for dynamic attributes.
-	 * @param data Rvalue reference to vector (ownership transferred via move)
+	 * @param data Rvalue reference to vector (bytes are copied into the
+	 *        small-buffer storage; kept for API compatibility)
 	 * @return true if value was set, false if rejected (static attribute)
 	 */
 	bool SetValue(std::vector<uint8_t>&& data);
@@ -591,7 +600,10 @@ class Attribute : public MovableOnly {
 	 * @param callback Function to handle reads
 	 */
 	void SetReadCallback(ReadCallback callback) {
-		read_callback_ = std::move(callback);
+		if(!callbacks_ && !callback) {
+			return;
+		}
+		EnsureCallbacks().read = std::move(callback);
 	}
 
 	/**
@@ -599,7 +611,7 @@ class Attribute : public MovableOnly {
 	 * @return true if read callback is set
 	 */
 	[[nodiscard]] bool HasReadCallback() const {
-		return static_cast<bool>(read_callback_);
+		return callbacks_ && static_cast<bool>(callbacks_->read);
 	}
 
 	/**
@@ -618,7 +630,10 @@ class Attribute : public MovableOnly {
 	 * @param callback Function to handle writes
 	 */
 	void SetWriteCallback(WriteCallback callback) {
-		write_callback_ = std::move(callback);
+		if(!callbacks_ && !callback) {
+			return;
+		}
+		EnsureCallbacks().write = std::move(callback);
 	}
 
 	/**
@@ -626,7 +641,7 @@ class Attribute : public MovableOnly {
 	 * @return true if write callback is set
 	 */
 	[[nodiscard]] bool HasWriteCallback() const {
-		return static_cast<bool>(write_callback_);
+		return callbacks_ && static_cast<bool>(callbacks_->write);
 	}
 
 	/**
@@ -644,6 +659,23 @@ class Attribute : public MovableOnly {
 	BleError InvokeWriteCallback(uint16_t offset, const uint8_t* data, uint16_t size);
 	///@}
 
+	/// \name Memory Footprint
+	///@{
+
+	/**
+	 * @brief Bytes used by this attribute (object plus owned heap storage).
+	 *
+	 * Counts `sizeof(Attribute)`, the heap block of a large dynamic value and
+	 * the callback block when application callbacks are installed. Static
+	 * values live in the ATT DB image and are not counted; state captured by
+	 * a callback beyond the `std::function` small buffer is not visible.
+	 */
+	[[nodiscard]] size_t GetMemoryUsage() const {
+		return sizeof(Attribute) + dynamic_value_.GetHeapCapacity() +
+			   (callbacks_ ? sizeof(Callbacks) : 0);
+	}
+	///@}
+
 	/// \name Streaming
 	///@{
 
@@ -681,10 +713,12 @@ class Attribute : public MovableOnly {
 	 *
 	 * Identifies the attribute type per Bluetooth specifications.
 	 * Can be a standard 16-bit UUID (e.g., 0x2A37 for Heart Rate)
-	 * or a custom 128-bit UUID. The kUuid128 property flag is
-	 * automatically synchronized with this field via UpdateUuidProperty().
+	 * or a custom 128-bit UUID. Stored compactly: 16-bit UUIDs as 16 bits,
+	 * 128-bit UUIDs as an index into the shared `CompactUuid` table. The
+	 * kUuid128 property flag is automatically synchronized with this field
+	 * via UpdateUuidProperty().
 	 */
-	Uuid uuid_{};
+	CompactUuid uuid_{};
 
 	/**
 	 * @brief ATT attribute handle (0 when unassigned).
@@ -722,7 +756,7 @@ class Attribute : public MovableOnly {
 	 *
 	 * For dynamic attributes:
 	 * - Always nullptr
-	 * - Value stored in dynamic_value_ vector instead
+	 * - Value stored in dynamic_value_ instead
 	 *
 	 * @note This pointer is not owned by Attribute. The referenced storage must
 	 *       remain valid for the lifetime of the Attribute or until replaced.
@@ -736,8 +770,9 @@ class Attribute : public MovableOnly {
 	 * For dynamic attributes: always 0 (use dynamic_value_.size() instead).
 	 *
 	 * Cached from ATT DB parsing to avoid recomputing size on each access.
+	 * ATT values are at most 512 bytes, so 16 bits are sufficient.
 	 */
-	size_t static_value_size_ = 0;
+	uint16_t static_value_size_ = 0;
 
 	// ========== Dynamic Attribute Value Storage ==========
 
@@ -747,61 +782,63 @@ class Attribute : public MovableOnly {
 	 * For dynamic attributes (Properties::kDynamic set):
 	 * - Owned, mutable storage for attribute value
 	 * - Can be updated via SetValue() methods
-	 * - Automatically resizes to accommodate new data
+	 * - Small values are stored inline (no heap allocation); larger values
+	 *   use a reusable heap block
 	 * - Used when attribute value changes at runtime
 	 *
 	 * For static attributes:
 	 * - Remains empty (size 0)
 	 * - SetValue() operations are rejected
 	 *
-	 * @note Memory overhead only applies to dynamic attributes. Static
-	 *       attributes keep this vector empty to save RAM.
+	 * @note Static attributes keep this storage empty; the inline buffer is
+	 *       sized by `C7222_BLE_ATTRIBUTE_INLINE_VALUE_SIZE`.
 	 */
-	std::vector<uint8_t> dynamic_value_{};
+	AttributeValue dynamic_value_{};
 
 	// ========== Callback Functions ==========
 
 	/**
-	 * @brief Optional read callback for dynamic value retrieval.
-	 *
-	 * Function signature: uint16_t(uint16_t offset, uint8_t* buffer, uint16_t buffer_size)
+	 * @brief Application read/write callbacks (allocated on first use).
 	 *
-	 * Called when a remote BLE client reads this attribute via ATT Read Request.
-	 * The callback must:
+	 * Read callback signature: uint16_t(uint16_t offset, uint8_t* buffer, uint16_t buffer_size)
 	 * - Fill the buffer with attribute data starting at the specified offset
 	 * - Return the number of bytes written to buffer on success
 	 * - Return an ATT error code (>= 0xFE00, typically cast from BleError) on failure
 	 *
-	 * If no callback is set, InvokeReadCallback() returns either the stored
-	 * static/dynamic value or an error code for unauthorized access.
+	 * Write callback signature: BleError(uint16_t offset, const uint8_t* data, uint16_t size)
+	 * - Return BleError::kSuccess if the write is accepted
+	 * - Return an appropriate BleError code on failure (e.g., kAttErrorWriteNotPermitted)
 	 *
-	 * @note Typically used for dynamic attributes where value is computed
-	 *       on-demand rather than stored.
+	 * If no read callback is set, InvokeReadCallback() returns the stored
+	 * static/dynamic value. If no write callback is set for a dynamic
+	 * attribute, InvokeWriteCallback() stores the data and returns
+	 * BleError::kSuccess; static attributes reject the write.
+	 */
+	struct Callbacks {
+		ReadCallback read;
+		WriteCallback write;
+	};
+
+	/**
+	 * @brief Allocate the callback block if needed.
 	 */
-	ReadCallback read_callback_{};
+	Callbacks& EnsureCallbacks() {
+		if(!callbacks_) {
+			callbacks_ = std::make_unique<Callbacks>();
+		}
+		return *callbacks_;
+	}
 
 	/**
-	 * @brief Optional write callback for dynamic value updates.
-	 *
-	 * Function signature: BleError(uint16_t offset, const uint8_t* data, uint16_t size)
-	 *
-	 * Called when a remote BLE client writes to this attribute via ATT Write Request.
-	 * The callback must:
-	 * - Process the write data starting at the specified offset
-	 * - Return BleError::kSuccess if write is accepted
-	 * - Return appropriate BleError code on failure (e.g., kAttErrorWriteNotPermitted)
-	 *
-	 * If no callback is set for a dynamic attribute, InvokeWriteCallback()
-	 * stores the data and returns BleError::kSuccess. For static attributes,
-	 * writes are always rejected as the value is immutable DB data.
-	 *
-	 * Type safety: BleError return type ensures compile-time correctness
-	 * and eliminates manual uint16_t conversions for error codes.
+	 * @brief Application callbacks (nullptr when none are installed).
 	 *
-	 * @note Required for writable dynamic attributes. Without this callback,
-	 *       all write attempts will fail with permission error.
+	 * Most attributes never get a callback: characteristic values and
+	 * descriptors are served by their owning `Characteristic` through the
+	 * `AttributeServer` handle table instead. Keeping the callbacks out of
+	 * line makes those attributes one pointer wide here instead of two
+	 * `std::function` objects.
 	 */
-	WriteCallback write_callback_{};
+	std::unique_ptr<Callbacks> callbacks_;
 };
 
 /**
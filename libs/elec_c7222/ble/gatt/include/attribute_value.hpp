@@ -0,0 +1,108 @@
+/**
+ * @file attribute_value.hpp
+ * @brief Small-buffer byte storage for dynamic attribute values.
+ */
+#ifndef ELEC_C7222_BLE_GATT_ATTRIBUTE_VALUE_HPP_
+#define ELEC_C7222_BLE_GATT_ATTRIBUTE_VALUE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Largest value (in bytes) stored inline in an `AttributeValue`.
+ *
+ * Values up to this size never touch the heap. The default covers CCCDs,
+ * counters, sensor readings and a full default-MTU notification payload
+ * (ATT_MTU 23 - 3). Override with a compile definition to trade RAM per
+ * dynamic attribute against heap use for larger values.
+ */
+#ifndef C7222_BLE_ATTRIBUTE_INLINE_VALUE_SIZE
+#define C7222_BLE_ATTRIBUTE_INLINE_VALUE_SIZE 20
+#endif
+
+namespace c7222 {
+
+/**
+ * @brief Byte container with inline storage for small values.
+ *
+ * Values of at most `kInlineCapacity` bytes are kept inside the object. Larger
+ * values go to a heap block that is kept and reused for later values that fit
+ * in it, so alternating between sizes does not reallocate. `Assign()` with a
+ * value that fits inline or in the current heap block never allocates.
+ *
+ * Used by `Attribute` for dynamic values.
+ */
+class AttributeValue {
+   public:
+	/// @brief Inline capacity in bytes (`C7222_BLE_ATTRIBUTE_INLINE_VALUE_SIZE`).
+	static constexpr size_t kInlineCapacity = C7222_BLE_ATTRIBUTE_INLINE_VALUE_SIZE;
+
+	AttributeValue() = default;
+	/** @brief Move constructor (copies inline bytes, transfers the heap block). */
+	AttributeValue(AttributeValue&& other) noexcept;
+	/** @brief Move assignment (copies inline bytes, transfers the heap block). */
+	AttributeValue& operator=(AttributeValue&& other) noexcept;
+	AttributeValue(const AttributeValue&) = delete;
+	AttributeValue& operator=(const AttributeValue&) = delete;
+	~AttributeValue() = default;
+
+	/**
+	 * @brief Replace the stored bytes.
+	 *
+	 * @param data Source bytes (may be nullptr when @p size is 0)
+	 * @param size Number of bytes
+	 */
+	void Assign(const uint8_t* data, size_t size);
+
+	/**
+	 * @brief Drop the stored bytes (keeps the heap block for reuse).
+	 */
+	void Clear() {
+		size_ = 0;
+	}
+
+	/**
+	 * @brief Release the heap block if the value fits inline.
+	 */
+	void ShrinkToFit();
+
+	/** @brief Pointer to the stored bytes (valid until the next `Assign()`). */
+	[[nodiscard]] const uint8_t* data() const {
+		return size_ > kInlineCapacity ? heap_.get() : inline_;
+	}
+	/** @brief Number of stored bytes. */
+	[[nodiscard]] size_t size() const {
+		return size_;
+	}
+	/** @brief True when no bytes are stored. */
+	[[nodiscard]] bool empty() const {
+		return size_ == 0;
+	}
+	/** @brief True when the value lives in the heap block. */
+	[[nodiscard]] bool IsHeapAllocated() const {
+		return size_ > kInlineCapacity;
+	}
+	/** @brief Size of the heap block in bytes (0 when none is held). */
+	[[nodiscard]] size_t GetHeapCapacity() const {
+		return heap_capacity_;
+	}
+	/** @brief Copy of the stored bytes. */
+	[[nodiscard]] std::vector<uint8_t> ToVector() const {
+		return std::vector<uint8_t>(data(), data() + size_);
+	}
+
+   private:
+	/// @brief Heap block for values larger than `kInlineCapacity`.
+	std::unique_ptr<uint8_t[]> heap_;
+	/// @brief Heap block size and value size (ATT values are at most 512 bytes).
+	uint16_t heap_capacity_ = 0;
+	uint16_t size_ = 0;
+	/// @brief Inline storage for small values.
+	uint8_t inline_[kInlineCapacity] = {};
+};
+
+}  // namespace c7222
+
+#endif	// ELEC_C7222_BLE_GATT_ATTRIBUTE_VALUE_HPP_
@@ -0,0 +1,85 @@
+/**
+ * @file compact_uuid.hpp
+ * @brief 4-byte UUID handle backed by a shared 128-bit UUID table.
+ */
+#ifndef ELEC_C7222_BLE_GATT_COMPACT_UUID_HPP_
+#define ELEC_C7222_BLE_GATT_COMPACT_UUID_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "uuid.hpp"
+
+namespace c7222 {
+
+/**
+ * @brief Compact UUID representation for per-attribute storage.
+ *
+ * A `Uuid` always reserves 16 bytes even though almost every attribute type
+ * in a GATT database is a 16-bit UUID. `CompactUuid` stores 16-bit UUIDs as
+ * their 16-bit value and 128-bit UUIDs as an index into a process-wide table
+ * of interned 128-bit UUIDs, so each instance is 4 bytes.
+ *
+ * The table is append-only: an entry is added the first time a 128-bit UUID
+ * is stored and is shared by every later attribute with the same UUID (a
+ * custom service typically repeats one base UUID across its declaration,
+ * characteristics and value attributes). Entries are never removed.
+ *
+ * Not thread-safe; construct from the BLE stack context like the rest of the
+ * GATT model.
+ */
+class CompactUuid {
+   public:
+	/** @brief Constructs an invalid UUID. */
+	CompactUuid() = default;
+
+	/**
+	 * @brief Construct from a full UUID, interning 128-bit values.
+	 */
+	explicit CompactUuid(const Uuid& uuid);
+
+	/**
+	 * @brief Expand back to a full `Uuid`.
+	 */
+	[[nodiscard]] Uuid ToUuid() const;
+
+	/** @brief Returns true if this UUID is 16-bit. */
+	[[nodiscard]] bool Is16Bit() const {
+		return type_ == Uuid::Type::k16Bit;
+	}
+	/** @brief Returns true if this UUID is 128-bit. */
+	[[nodiscard]] bool Is128Bit() const {
+		return type_ == Uuid::Type::k128Bit;
+	}
+	/** @brief Returns true if the UUID has been initialized. */
+	[[nodiscard]] bool IsValid() const {
+		return type_ != Uuid::Type::Invalid;
+	}
+
+	/**
+	 * @brief Compare against a full UUID (same rules as `Uuid::operator==`).
+	 */
+	[[nodiscard]] bool operator==(const Uuid& uuid) const;
+	[[nodiscard]] bool operator!=(const Uuid& uuid) const {
+		return !(*this == uuid);
+	}
+
+	/**
+	 * @brief Number of distinct 128-bit UUIDs in the shared table.
+	 */
+	[[nodiscard]] static size_t GetTableSize();
+
+	/**
+	 * @brief Heap bytes used by the shared 128-bit UUID table.
+	 */
+	[[nodiscard]] static size_t GetTableMemoryUsage();
+
+   private:
+	/// @brief 16-bit UUID value, or index into the 128-bit table.
+	uint16_t value_ = 0;
+	Uuid::Type type_ = Uuid::Type::Invalid;
+};
+
+}  // namespace c7222
+
+#endif	// ELEC_C7222_BLE_GATT_COMPACT_UUID_HPP_
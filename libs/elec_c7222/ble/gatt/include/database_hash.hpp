@@ -0,0 +1,110 @@
+/**
+ * @file database_hash.hpp
+ * @brief GATT Database Hash (AES-CMAC over the attribute layout).
+ */
+#ifndef ELEC_C7222_BLE_GATT_DATABASE_HASH_HPP_
+#define ELEC_C7222_BLE_GATT_DATABASE_HASH_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "uuid.hpp"
+
+namespace c7222 {
+
+/**
+ * @class DatabaseHash
+ * @brief Incremental builder for the GATT Database Hash (Core Vol 3, Part G, 7.3).
+ *
+ * The hash lets a client with Robust Caching detect a changed database by
+ * reading one characteristic instead of rediscovering every service. It is
+ * `AES-CMAC(key = 0, m)`, where `m` concatenates, in handle order:
+ * - handle, type and value of service, include, characteristic and
+ *   extended-properties declarations;
+ * - handle and type of the User Description, CCCD, SCCD, Presentation Format
+ *   and Aggregate Format descriptors.
+ *
+ * All other attributes (characteristic values, custom descriptors) do not
+ * contribute. Handles and types are little-endian, values are taken as
+ * stored in the database.
+ *
+ * AES-128 is implemented in software, so the hash is available on every
+ * platform without the controller's crypto commands; it runs once per
+ * `AttributeServer::InitServices()`.
+ *
+ * @code
+ * c7222::DatabaseHash hash;
+ * hash.AddAttribute(0x0001, c7222::Uuid(0x2800), service_uuid, 2);
+ * const c7222::DatabaseHash::Value value = hash.Finish();
+ * @endcode
+ */
+class DatabaseHash {
+   public:
+	/// @brief Hash / AES block size in bytes.
+	static constexpr size_t kSize = 16;
+	/// @brief Hash value in the order it is read over ATT (little-endian).
+	using Value = std::array<uint8_t, kSize>;
+	/// @brief AES-128 key or block, most significant byte first.
+	using Block = std::array<uint8_t, kSize>;
+
+	/**
+	 * @brief Check whether an attribute type takes part in the hash.
+	 */
+	[[nodiscard]] static bool IsHashed(const Uuid& type);
+
+	/**
+	 * @brief Check whether an attribute's value takes part in the hash.
+	 *
+	 * True for declarations and extended properties; false for the
+	 * descriptors that only contribute handle and type.
+	 */
+	[[nodiscard]] static bool IsValueHashed(const Uuid& type);
+
+	/**
+	 * @brief Append one attribute to the hashed message.
+	 *
+	 * Attributes must be added in ascending handle order. Types that do not
+	 * take part in the hash (`IsHashed()`) are ignored.
+	 */
+	void AddAttribute(uint16_t handle, const Uuid& type, const uint8_t* value, size_t size);
+
+	/**
+	 * @brief Discard the attributes added so far.
+	 */
+	void Reset() {
+		message_.clear();
+	}
+
+	/**
+	 * @brief Number of message bytes added so far.
+	 */
+	[[nodiscard]] size_t GetMessageSize() const {
+		return message_.size();
+	}
+
+	/**
+	 * @brief Compute the hash of the attributes added so far.
+	 */
+	[[nodiscard]] Value Finish() const;
+
+	/**
+	 * @brief AES-CMAC (RFC 4493) of `message` with `key`.
+	 *
+	 * The result is returned most significant byte first, as in RFC 4493.
+	 */
+	[[nodiscard]] static Block AesCmac(const Block& key, const uint8_t* message, size_t size);
+
+	/**
+	 * @brief Encrypt one block with AES-128 (FIPS-197).
+	 */
+	[[nodiscard]] static Block Aes128Encrypt(const Block& key, const Block& plaintext);
+
+   private:
+	std::vector<uint8_t> message_;
+};
+
+}  // namespace c7222
+
+#endif	// ELEC_C7222_BLE_GATT_DATABASE_HASH_HPP_
@@ -0,0 +1,99 @@
+/**
+ * @file gatt_layout.hpp
+ * @brief Compile-time description of a GATT database layout.
+ */
+#ifndef ELEC_C7222_BLE_GATT_GATT_LAYOUT_HPP_
+#define ELEC_C7222_BLE_GATT_GATT_LAYOUT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace c7222 {
+
+/**
+ * @brief Location of one attribute entry inside the ATT DB blob.
+ *
+ * `offset` is the byte offset of the entry header (size, flags, handle)
+ * from the start of the ATT DB blob, including the leading version byte.
+ */
+struct GattAttributeLayout {
+	/// @brief ATT handle of the attribute.
+	uint16_t handle;
+	/// @brief Byte offset of the entry inside the ATT DB blob.
+	uint16_t offset;
+	/// @brief Entry size in bytes (header + UUID + value).
+	uint16_t size;
+};
+
+/**
+ * @brief Characteristic grouping expressed as indices into the attribute table.
+ */
+struct GattCharacteristicLayout {
+	/// @brief Index of the Characteristic Declaration attribute.
+	uint16_t declaration;
+	/// @brief Index of the Characteristic Value attribute.
+	uint16_t value;
+	/// @brief Index of the first descriptor attribute.
+	uint16_t first_descriptor;
+	/// @brief Number of descriptor attributes (contiguous from `first_descriptor`).
+	uint16_t descriptor_count;
+};
+
+/**
+ * @brief Service grouping expressed as indices into the attribute and
+ *        characteristic tables.
+ */
+struct GattServiceLayout {
+	/// @brief Index of the Service Declaration attribute.
+	uint16_t declaration;
+	/// @brief Index of the first Included Service Declaration attribute.
+	uint16_t first_included;
+	/// @brief Number of Included Service Declaration attributes.
+	uint16_t included_count;
+	/// @brief Index of the first characteristic in the characteristic table.
+	uint16_t first_characteristic;
+	/// @brief Number of characteristics in this service.
+	uint16_t characteristic_count;
+	/// @brief First ATT handle of the service.
+	uint16_t start_handle;
+	/// @brief Last ATT handle of the service.
+	uint16_t end_handle;
+};
+
+/**
+ * @brief Complete compile-time layout of an ATT DB blob.
+ *
+ * Instances are emitted as `constexpr` tables by the build step
+ * (`cmake/c7222_gatt_layout.py`, driven by `c7222_configure_app_target()`)
+ * for every `.gatt` file listed in an app's `GATT_FILES`. The generated
+ * header `<name>_layout.hpp` sits next to the BTstack-generated `<name>.h`
+ * and exposes `c7222::generated::<name>::kLayout`.
+ *
+ * Passing the layout to `AttributeServer::Init(context, layout)` lets the
+ * server materialize its `Service`/`Characteristic` graph directly from
+ * these tables, skipping the runtime ATT DB walk and the intermediate
+ * attribute list.
+ *
+ * The layout only stores offsets; attribute values still point into the
+ * ATT DB blob, which must be the same blob the layout was generated from.
+ */
+struct GattDatabaseLayout {
+	/// @brief Attribute table in ATT DB order.
+	const GattAttributeLayout* attributes;
+	/// @brief Number of entries in `attributes`.
+	size_t attribute_count;
+	/// @brief Service table in discovery order.
+	const GattServiceLayout* services;
+	/// @brief Number of entries in `services`.
+	size_t service_count;
+	/// @brief Characteristic table in discovery order.
+	const GattCharacteristicLayout* characteristics;
+	/// @brief Number of entries in `characteristics`.
+	size_t characteristic_count;
+	/// @brief Total size of the ATT DB blob in bytes (including the end marker).
+	size_t db_size;
+};
+
+}  // namespace c7222
+
+#endif	// ELEC_C7222_BLE_GATT_GATT_LAYOUT_HPP_
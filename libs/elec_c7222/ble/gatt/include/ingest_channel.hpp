@@ -0,0 +1,213 @@
+/**
+ * @file ingest_channel.hpp
+ * @brief Stream-buffer sink for high-rate Write Without Response traffic.
+ */
+#ifndef ELEC_C7222_BLE_GATT_INGEST_CHANNEL_HPP_
+#define ELEC_C7222_BLE_GATT_INGEST_CHANNEL_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "ble_error.hpp"
+#include "freertos_stream_buffer.hpp"
+#include "non_copyable.hpp"
+
+namespace c7222 {
+
+/**
+ * @brief Byte stream fed by client writes and drained by a consumer task.
+ *
+ * Used by `Characteristic::EnableIngest()`. Every client write carries a
+ * one-byte sequence number followed by payload bytes:
+ *
+ *     [seq][payload ...]
+ *
+ * The BLE stack context appends the payload straight into a
+ * `FreeRtosStreamBuffer` (no value copy, no `OnWrite()` fan-out); a consumer
+ * task drains it with `Read()`. Packets are accepted strictly in sequence:
+ *
+ * - a packet whose payload does not fit is dropped (overflow),
+ * - a packet with an unexpected sequence number is dropped (sequence error),
+ *
+ * and in both cases a credit report is sent so the client can resume from the
+ * reported sequence number (go-back-N).
+ *
+ * The stream has one writer: the channel binds to the first connection that
+ * writes to it (or enables notifications on it) and rejects writes from other
+ * connections until that connection closes, which also restarts the sequence.
+ *
+ * Flow control uses byte credits. A credit report is the three bytes
+ *
+ *     [next_seq][free_lo][free_hi]
+ *
+ * notified to the owning connection only (and stored as the readable value). It
+ * grants the client `free` payload bytes starting with packet `next_seq`. A
+ * new report is sent whenever the consumer has freed at least
+ * `GetReportThreshold()` bytes since the previous one.
+ *
+ * Threading: `Write()`, `Bind()`, `Release()` and `BuildCreditReport()` run
+ * on the BLE stack context; `Read()` runs on a single consumer task.
+ */
+class IngestChannel : public NonCopyableNonMovable {
+   public:
+	/// Size of the sequence header at the start of each write.
+	static constexpr size_t kHeaderSize = 1;
+	/// Size of a credit report.
+	static constexpr size_t kCreditReportSize = 3;
+
+	/**
+	 * @brief Allocate the stream buffer.
+	 *
+	 * @param buffer_size Stream buffer capacity in bytes (at least 1)
+	 * @param report_threshold Freed bytes that trigger a credit report
+	 *        (0 selects a quarter of `buffer_size`)
+	 */
+	IngestChannel(size_t buffer_size, size_t report_threshold);
+
+	/// \name Consumer Side
+	///@{
+	/**
+	 * @brief Receive up to `max_size` payload bytes.
+	 *
+	 * Blocks for at most `ticks_to_wait` until data is available. Freed
+	 * space is returned to the client as credit once it reaches the report
+	 * threshold.
+	 *
+	 * @return Number of bytes copied into `out`
+	 */
+	size_t Read(void* out, size_t max_size, uint32_t ticks_to_wait = 0);
+
+	/** @brief Payload bytes waiting for the consumer. */
+	[[nodiscard]] size_t GetAvailable() const {
+		return stream_.BytesAvailable();
+	}
+	/** @brief True if the stream buffer was allocated. */
+	[[nodiscard]] bool IsValid() const {
+		return stream_.IsValid();
+	}
+	///@}
+
+	/// \name Stack Side (Internal)
+	///@{
+	/**
+	 * @brief Append one client write to the stream.
+	 *
+	 * Binds the channel to `connection_handle` if it has no owner yet.
+	 * Dropped packets are counted and request a credit report; they still
+	 * return success because write commands carry no response.
+	 *
+	 * @return BleError::kAttErrorWriteNotPermitted if another connection owns
+	 *         the channel, BleError::kAttErrorInvalidAttrValueLength if the
+	 *         sequence header is missing, otherwise BleError::kSuccess
+	 * @note Internal use only (Characteristic write dispatch).
+	 */
+	BleError Write(uint16_t connection_handle, const uint8_t* data, size_t size);
+
+	/**
+	 * @brief Bind the channel to `connection_handle` if it has no owner yet.
+	 *
+	 * @return True if `connection_handle` owns the channel
+	 * @note Internal use only.
+	 */
+	bool Bind(uint16_t connection_handle);
+
+	/**
+	 * @brief Unbind and restart the sequence at 0 if `connection_handle` owns
+	 *        the channel; buffered data is kept.
+	 * @note Internal use only (connection closed).
+	 */
+	void Release(uint16_t connection_handle);
+
+	/**
+	 * @brief Clear and return the "credit report due" flag.
+	 * @note Internal use only.
+	 */
+	bool TakeReportDue() {
+		return report_due_.exchange(false);
+	}
+
+	/**
+	 * @brief Fill `out` with the current credit report and restart the freed-byte count.
+	 * @note Internal use only.
+	 */
+	void BuildCreditReport(uint8_t (&out)[kCreditReportSize]);
+
+	///@}
+
+	/// \name State and Counters
+	///@{
+	/** @brief Stream buffer capacity in bytes. */
+	[[nodiscard]] size_t GetBufferSize() const {
+		return buffer_size_;
+	}
+	/** @brief Freed bytes that trigger a credit report. */
+	[[nodiscard]] size_t GetReportThreshold() const {
+		return report_threshold_;
+	}
+	/** @brief Connection the channel is bound to (0 = none). */
+	[[nodiscard]] uint16_t GetOwnerConnection() const {
+		return owner_connection_;
+	}
+	/** @brief Sequence number expected in the next write. */
+	[[nodiscard]] uint8_t GetNextSequence() const {
+		return next_seq_;
+	}
+	/** @brief Writes appended to the stream. */
+	[[nodiscard]] uint32_t GetPacketCount() const {
+		return packets_;
+	}
+	/** @brief Payload bytes appended to the stream. */
+	[[nodiscard]] uint32_t GetByteCount() const {
+		return bytes_;
+	}
+	/** @brief Writes dropped because the stream buffer was full. */
+	[[nodiscard]] uint32_t GetOverflowCount() const {
+		return overflows_;
+	}
+	/** @brief Writes dropped because of an unexpected sequence number. */
+	[[nodiscard]] uint32_t GetSequenceErrorCount() const {
+		return sequence_errors_;
+	}
+	/** @brief Writes rejected because another connection owns the channel. */
+	[[nodiscard]] uint32_t GetForeignWriteCount() const {
+		return foreign_writes_;
+	}
+	/** @brief Credit reports built. */
+	[[nodiscard]] uint32_t GetCreditReportCount() const {
+		return credit_reports_;
+	}
+	/**
+	 * @brief Reset packet, byte, drop and report counters.
+	 */
+	void ResetCounters();
+	///@}
+
+   private:
+	/// @brief Drop the current write and ask for a report (once per resync).
+	void Reject();
+
+	FreeRtosStreamBuffer stream_;
+	size_t buffer_size_;
+	size_t report_threshold_;
+	/// @brief Connection whose writes feed the stream (0 = unbound; stack context).
+	uint16_t owner_connection_ = 0;
+	/// @brief Sequence number of the next accepted write (stack context).
+	uint8_t next_seq_ = 0;
+	/// @brief True after a drop until the expected sequence number arrives.
+	bool resync_pending_ = false;
+	/// @brief Bytes drained by the consumer since the last report.
+	std::atomic<size_t> freed_since_report_{0};
+	/// @brief Set when a credit report should be sent from the stack context.
+	std::atomic<bool> report_due_{false};
+	uint32_t packets_ = 0;
+	uint32_t bytes_ = 0;
+	uint32_t overflows_ = 0;
+	uint32_t sequence_errors_ = 0;
+	uint32_t foreign_writes_ = 0;
+	uint32_t credit_reports_ = 0;
+};
+
+}  // namespace c7222
+
+#endif	// ELEC_C7222_BLE_GATT_INGEST_CHANNEL_HPP_
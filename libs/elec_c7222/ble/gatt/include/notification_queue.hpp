@@ -0,0 +1,138 @@
+/**
+ * @file notification_queue.hpp
+ * @brief Fixed-capacity ring of pending notification payloads.
+ */
+#ifndef ELEC_C7222_BLE_GATT_NOTIFICATION_QUEUE_HPP_
+#define ELEC_C7222_BLE_GATT_NOTIFICATION_QUEUE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "non_copyable.hpp"
+
+namespace c7222 {
+
+/**
+ * @brief Bounded FIFO of notification payloads with fixed-size slots.
+ *
+ * All storage is allocated once by the constructor (`capacity` slots of
+ * `max_payload_size` bytes each); `Push()` and `Pop()` never allocate.
+ * Payloads that do not fit (queue full or payload too large) are rejected and
+ * counted in `GetDroppedCount()`.
+ *
+ * Used by `Characteristic::EnableNotificationQueue()` to keep every sample of a
+ * streaming characteristic while the controller ACL buffers are full. The
+ * queue is drained from the BLE stack context on ATT_EVENT_CAN_SEND_NOW.
+ */
+class NotificationQueue : public NonCopyableNonMovable {
+   public:
+	/**
+	 * @brief Allocate the ring.
+	 *
+	 * @param capacity Number of payload slots (at least 1)
+	 * @param max_payload_size Maximum payload size in bytes (at least 1)
+	 * @param high_watermark Depth at which backpressure is asserted
+	 *        (0 or larger than `capacity` selects `capacity`)
+	 */
+	NotificationQueue(size_t capacity, size_t max_payload_size, size_t high_watermark);
+
+	/// \name Queue Operations
+	///@{
+	/**
+	 * @brief Copy a payload into the next free slot.
+	 *
+	 * @return false (and counts a drop) if the queue is full or the payload is
+	 *         larger than `GetMaxPayloadSize()`
+	 */
+	bool Push(const uint8_t* data, size_t size);
+
+	/**
+	 * @brief Oldest payload bytes (nullptr when empty).
+	 */
+	[[nodiscard]] const uint8_t* FrontData() const;
+
+	/**
+	 * @brief Size of the oldest payload (0 when empty).
+	 */
+	[[nodiscard]] uint16_t FrontSize() const;
+
+	/**
+	 * @brief Remove the oldest payload and count it as sent.
+	 */
+	void Pop();
+
+	/**
+	 * @brief Drop all queued payloads (counted as dropped).
+	 */
+	void Clear();
+	///@}
+
+	/// \name State and Counters
+	///@{
+	/** @brief Number of queued payloads. */
+	[[nodiscard]] size_t GetSize() const {
+		return count_;
+	}
+	/** @brief True when no payload is queued. */
+	[[nodiscard]] bool IsEmpty() const {
+		return count_ == 0;
+	}
+	/** @brief True when every slot is in use. */
+	[[nodiscard]] bool IsFull() const {
+		return count_ == capacity_;
+	}
+	/** @brief Number of payload slots. */
+	[[nodiscard]] size_t GetCapacity() const {
+		return capacity_;
+	}
+	/** @brief Maximum payload size in bytes. */
+	[[nodiscard]] size_t GetMaxPayloadSize() const {
+		return slot_size_;
+	}
+	/** @brief Depth at which backpressure is asserted. */
+	[[nodiscard]] size_t GetHighWatermark() const {
+		return high_watermark_;
+	}
+	/** @brief Depth at or below which backpressure is released (half the high watermark). */
+	[[nodiscard]] size_t GetLowWatermark() const {
+		return high_watermark_ / 2;
+	}
+	/** @brief Largest depth observed since construction or `ResetCounters()`. */
+	[[nodiscard]] size_t GetPeakSize() const {
+		return peak_;
+	}
+	/** @brief Payloads removed by `Pop()` (i.e. handed to the stack). */
+	[[nodiscard]] uint32_t GetSentCount() const {
+		return sent_;
+	}
+	/** @brief Payloads rejected by `Push()` or discarded by `Clear()`. */
+	[[nodiscard]] uint32_t GetDroppedCount() const {
+		return dropped_;
+	}
+	/**
+	 * @brief Reset peak, sent and dropped counters.
+	 */
+	void ResetCounters();
+	///@}
+
+   private:
+	/// @brief Payload bytes, `capacity_` slots of `slot_size_` bytes.
+	std::vector<uint8_t> storage_;
+	/// @brief Payload size per slot.
+	std::vector<uint16_t> sizes_;
+	size_t capacity_;
+	size_t slot_size_;
+	size_t high_watermark_;
+	/// @brief Slot index of the oldest payload.
+	size_t head_ = 0;
+	/// @brief Number of queued payloads.
+	size_t count_ = 0;
+	size_t peak_ = 0;
+	uint32_t sent_ = 0;
+	uint32_t dropped_ = 0;
+};
+
+}  // namespace c7222
+
+#endif	// ELEC_C7222_BLE_GATT_NOTIFICATION_QUEUE_HPP_
@@ -4,6 +4,7 @@
 #include "characteristic.hpp"
 #include "uuid.hpp"
 
+#include <cassert>
 #include <iosfwd>
 #include <list>
 #include <vector>
@@ -37,6 +38,16 @@ namespace c7222 {
  *    Callbacks are not copied; register callbacks after parsing.
  *
  * ---
+ * ### Storage Model
+ *
+ * Characteristics and included services are stored contiguously in
+ * `std::vector` containers, so indexed access is O(1) and iteration is cache
+ * friendly. When parsed from the ATT DB, each container is reserved to its
+ * exact size up front, so element addresses stay stable for the lifetime of
+ * the parsed graph. Adding or removing characteristics afterwards may
+ * relocate them and invalidates previously obtained pointers/references.
+ *
+ * ---
  * ### Included Service Model
  *
  * Included services are represented by:
@@ -161,7 +172,7 @@ class Service : public MovableOnly {
 	 */
 	explicit Service(Attribute&& declaration_attr,
 					 std::vector<Attribute>&& included_service_declarations,
-					 std::list<Characteristic>&& characteristics);
+					 std::vector<Characteristic>&& characteristics);
 
 	/**
 	 * @brief Move constructor.
@@ -198,8 +209,10 @@ class Service : public MovableOnly {
 	 *
 	 * @note Parsed attributes are moved into each Service instance
 	 * @note Expects a well-formed, ordered ATT DB; characteristic parsing is asserted
+	 * @note The returned vector and each service's characteristic vector are
+	 *       reserved to their exact sizes, so no reallocation occurs while parsing
 	 */
-	static std::list<Service> ParseFromAttributes(std::list<Attribute>& attributes);
+	static std::vector<Service> ParseFromAttributes(std::list<Attribute>& attributes);
 	///@}
 
 	/// \name Accessors and Lookup
@@ -223,6 +236,18 @@ class Service : public MovableOnly {
 	 */
 	[[nodiscard]] uint16_t GetDeclarationHandle() const { return declaration_attr_.GetHandle(); }
 
+	/**
+	 * @brief Get the Declaration attribute.
+	 * @return Reference to the service Declaration attribute
+	 */
+	Attribute& GetDeclarationAttribute() { return declaration_attr_; }
+
+	/**
+	 * @brief Get the Declaration attribute (const version).
+	 * @return Const reference to the service Declaration attribute
+	 */
+	[[nodiscard]] const Attribute& GetDeclarationAttribute() const { return declaration_attr_; }
+
 	/**
 	 * @brief Get the number of characteristics in this service.
 	 * @return Count of characteristics
@@ -230,18 +255,18 @@ class Service : public MovableOnly {
 	[[nodiscard]] size_t GetCharacteristicCount() const { return characteristics_.size(); }
 
 	/**
-	 * @brief Get the list of characteristics in this service.
-	 * @return Reference to the characteristic list
+	 * @brief Get the characteristics in this service.
+	 * @return Const reference to the contiguous characteristic storage
 	 */
-	[[nodiscard]] const std::list<Characteristic>& GetCharacteristics() const {
+	[[nodiscard]] const std::vector<Characteristic>& GetCharacteristics() const {
 		return characteristics_;
 	}
 	/**
 	 * \brief Get the Characteristics object
 	 * 
-	 * \return std::list<Characteristic>& 
+	 * \return std::vector<Characteristic>& 
 	 */
-	std::list<Characteristic>& GetCharacteristics() {
+	std::vector<Characteristic>& GetCharacteristics() {
 		return characteristics_;
 	}
 
@@ -404,6 +429,16 @@ class Service : public MovableOnly {
 	 */
 	[[nodiscard]] size_t GetIncludedServiceDeclarationCount() const { return included_service_declarations_.size(); }
 
+	/**
+	 * @brief Get an included service declaration attribute by index.
+	 * @param index Index of the included service declaration
+	 * @return Reference to the included service declaration attribute
+	 */
+	Attribute& GetIncludedServiceDeclaration(size_t index) {
+		assert(index < included_service_declarations_.size() && "Included service declaration index out of range");
+		return included_service_declarations_[index];
+	}
+
 	/**
 	 * @brief Check if this service is valid.
 	 * @return true if UUID is valid, handles are non-zero, and has at least one characteristic
@@ -441,6 +476,7 @@ class Service : public MovableOnly {
 	 * 
 	 * @param characteristic The characteristic to add (will be moved)
 	 * @return Reference to the added characteristic
+	 * @note May relocate existing characteristics (see Storage Model).
 	 */
 	Characteristic& AddCharacteristic(Characteristic&& characteristic);
 
@@ -456,6 +492,7 @@ class Service : public MovableOnly {
 	 * @param declaration_handle Handle of the Declaration attribute
 	 * @param value_handle Handle of the Value attribute
 	 * @return Reference to the newly added characteristic
+	 * @note May relocate existing characteristics (see Storage Model).
 	 */
 	Characteristic& CreateCharacteristic(const Uuid& uuid,
 										 uint8_t properties,
@@ -547,6 +584,19 @@ class Service : public MovableOnly {
 	[[nodiscard]] auto cend() const { return characteristics_.cend(); }
 	///@}
 
+	/// \name Memory Footprint
+	///@{
+
+	/**
+	 * @brief Bytes used by this service.
+	 *
+	 * Sums the object itself, its declaration attributes, every contained
+	 * characteristic (`Characteristic::GetMemoryUsage()`) and included
+	 * services, plus unused vector capacity.
+	 */
+	[[nodiscard]] size_t GetMemoryUsage() const;
+	///@}
+
 	/// \name Stream Output
 	///@{
 
@@ -602,10 +652,10 @@ private:
 	/**
 	 * @brief Collection of characteristics in this service.
 	 *
-	 * The list preserves discovery order without requiring contiguous storage.
-	 * Characteristics are move-only and owned by the service.
+	 * Contiguous storage in discovery order. Characteristics are move-only and
+	 * owned by the service; their internal callbacks are rebound on relocation.
 	 */
-	std::list<Characteristic> characteristics_;
+	std::vector<Characteristic> characteristics_;
 
 	/**
 	 * @brief Collection of included services.
@@ -613,7 +663,7 @@ private:
 	 * These are full Service objects for higher-level access and handle propagation.
 	 * They are independent of the Included Service Declaration attributes.
 	 */
-	std::list<Service> included_services_;
+	std::vector<Service> included_services_;
 
 	/**
 	 * @brief Included Service Declaration attributes.
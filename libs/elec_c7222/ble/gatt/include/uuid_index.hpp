@@ -0,0 +1,210 @@
+/**
+ * @file uuid_index.hpp
+ * @brief Sorted flat UUID index and non-allocating result view.
+ */
+#ifndef ELEC_C7222_BLE_GATT_UUID_INDEX_HPP_
+#define ELEC_C7222_BLE_GATT_UUID_INDEX_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "uuid.hpp"
+
+namespace c7222 {
+
+/**
+ * @brief Non-owning view over a contiguous run of object pointers.
+ *
+ * Returned by UUID lookups. The view points into the index storage, so it is
+ * valid until the index is rebuilt (e.g. the next `AttributeServer::Init()`).
+ * Iteration yields `T*` in discovery order, so range-for works as with a
+ * container of pointers:
+ *
+ * @code
+ * for(auto* ch : server->FindCharacteristicByUuid(c7222::Uuid(0x2A6E))) {
+ *     ch->AddEventHandler(handler);
+ * }
+ * @endcode
+ *
+ * @tparam T Pointee type (e.g. `Characteristic` or `const Characteristic`).
+ */
+template <typename T>
+class UuidRange {
+   public:
+	/// @brief Iterator type (pointer to the stored object pointers).
+	using iterator = T* const*;
+
+	/** @brief Constructs an empty view. */
+	UuidRange() = default;
+
+	/**
+	 * @brief Constructs a view over `[first, last)`.
+	 */
+	UuidRange(iterator first, iterator last) : first_(first), last_(last) {}
+
+	/**
+	 * @brief Converting constructor (e.g. `UuidRange<X>` to `UuidRange<const X>`).
+	 */
+	template <typename U>
+	UuidRange(const UuidRange<U>& other)  // NOLINT(google-explicit-constructor)
+		: first_(other.begin()), last_(other.end()) {}
+
+	/** @brief Iterator to the first match. */
+	[[nodiscard]] iterator begin() const {
+		return first_;
+	}
+
+	/** @brief Iterator past the last match. */
+	[[nodiscard]] iterator end() const {
+		return last_;
+	}
+
+	/** @brief Number of matches. */
+	[[nodiscard]] size_t size() const {
+		return static_cast<size_t>(last_ - first_);
+	}
+
+	/** @brief True when there are no matches. */
+	[[nodiscard]] bool empty() const {
+		return first_ == last_;
+	}
+
+	/** @brief First match, or nullptr when empty. */
+	[[nodiscard]] T* front() const {
+		return empty() ? nullptr : *first_;
+	}
+
+	/** @brief Match by position (discovery order). */
+	[[nodiscard]] T* operator[](size_t index) const {
+		assert(index < size() && "UuidRange index out of range");
+		return first_[index];
+	}
+
+   private:
+	iterator first_ = nullptr;
+	iterator last_ = nullptr;
+};
+
+/**
+ * @brief Sorted flat index from UUID to objects exposing `GetUuid()`.
+ *
+ * 16-bit UUIDs are kept in a separate, densely packed key array so the common
+ * case is a binary search over `uint16_t` values. 128-bit UUIDs are sorted by
+ * their raw bytes. Objects sharing a UUID are stored adjacently in discovery
+ * order, so a lookup returns a contiguous `UuidRange` without allocating.
+ *
+ * Populate with `Add()` in discovery order, then call `Finalize()` once the
+ * object graph is final. The index stores raw pointers and must be rebuilt if
+ * the indexed objects move.
+ *
+ * @tparam T Indexed type; must provide `const Uuid& GetUuid() const`.
+ */
+template <typename T>
+class UuidIndex {
+   public:
+	/**
+	 * @brief Remove all entries.
+	 */
+	void Clear() {
+		pending16_.clear();
+		keys16_.clear();
+		items16_.clear();
+		items128_.clear();
+	}
+
+	/**
+	 * @brief Add an object to the index.
+	 *
+	 * Objects must be added in discovery order. Call `Finalize()` once all
+	 * objects were added and before any lookup.
+	 */
+	void Add(T* item) {
+		const Uuid& uuid = item->GetUuid();
+		if(uuid.Is16Bit()) {
+			pending16_.emplace_back(uuid.Get16Bit(), item);
+		} else if(uuid.Is128Bit()) {
+			items128_.push_back(item);
+		}
+	}
+
+	/**
+	 * @brief Sort the added entries and release temporary storage.
+	 */
+	void Finalize() {
+		std::stable_sort(pending16_.begin(),
+						 pending16_.end(),
+						 [](const auto& a, const auto& b) { return a.first < b.first; });
+		keys16_.clear();
+		items16_.clear();
+		keys16_.reserve(pending16_.size());
+		items16_.reserve(pending16_.size());
+		for(const auto& entry: pending16_) {
+			keys16_.push_back(entry.first);
+			items16_.push_back(entry.second);
+		}
+		pending16_.clear();
+		pending16_.shrink_to_fit();
+		std::stable_sort(items128_.begin(), items128_.end(), [](const T* a, const T* b) {
+			return Less128(a->GetUuid(), b->GetUuid());
+		});
+		items128_.shrink_to_fit();
+	}
+
+	/**
+	 * @brief Find all objects with the given UUID.
+	 *
+	 * @return View over the matches in discovery order (may be empty).
+	 */
+	[[nodiscard]] UuidRange<T> Find(const Uuid& uuid) const {
+		if(uuid.Is16Bit()) {
+			const auto bounds = std::equal_range(keys16_.begin(), keys16_.end(), uuid.Get16Bit());
+			const auto first = static_cast<size_t>(bounds.first - keys16_.begin());
+			const auto last = static_cast<size_t>(bounds.second - keys16_.begin());
+			return UuidRange<T>(items16_.data() + first, items16_.data() + last);
+		}
+		if(uuid.Is128Bit()) {
+			const auto lower = std::lower_bound(
+				items128_.begin(), items128_.end(), uuid, [](const T* item, const Uuid& key) {
+					return Less128(item->GetUuid(), key);
+				});
+			const auto upper = std::upper_bound(
+				lower, items128_.end(), uuid, [](const Uuid& key, const T* item) {
+					return Less128(key, item->GetUuid());
+				});
+			return UuidRange<T>(items128_.data() + (lower - items128_.begin()),
+								items128_.data() + (upper - items128_.begin()));
+		}
+		return UuidRange<T>();
+	}
+
+	/**
+	 * @brief Heap bytes used by the index vectors.
+	 */
+	[[nodiscard]] size_t GetMemoryUsage() const {
+		return pending16_.capacity() * sizeof(std::pair<uint16_t, T*>) +
+			   keys16_.capacity() * sizeof(uint16_t) +
+			   (items16_.capacity() + items128_.capacity()) * sizeof(T*);
+	}
+
+   private:
+	static bool Less128(const Uuid& a, const Uuid& b) {
+		return std::lexicographical_compare(a.data(), a.data() + 16, b.data(), b.data() + 16);
+	}
+
+	/// @brief 16-bit entries collected by Add() until Finalize().
+	std::vector<std::pair<uint16_t, T*>> pending16_;
+	/// @brief Sorted 16-bit keys (parallel to `items16_`).
+	std::vector<uint16_t> keys16_;
+	/// @brief Objects with 16-bit UUIDs, sorted by key then discovery order.
+	std::vector<T*> items16_;
+	/// @brief Objects with 128-bit UUIDs, sorted by UUID bytes then discovery order.
+	std::vector<T*> items128_;
+};
+
+}  // namespace c7222
+
+#endif	// ELEC_C7222_BLE_GATT_UUID_INDEX_HPP_
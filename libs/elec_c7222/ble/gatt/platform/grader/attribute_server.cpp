@@ -1,17 +1,184 @@
 #include "attribute_server.hpp"
 
+#include <functional>
+#include <thread>
+
 namespace c7222 {
 
+extern "C" {
+void c7222_grader_att_server_request_can_send_now_event(uint16_t connection_handle);
+/// The harness calls AttributeServer::ProcessDeferredUpdates() when the timer expires.
+void c7222_grader_att_server_set_timer(uint32_t delay_ms);
+void c7222_grader_att_server_cancel_timer(void);
+/// The harness calls AttributeServer::ProcessStackWork() from its stack loop.
+void c7222_grader_att_server_schedule_stack_work(void);
+/// The harness replays the pending ATT request (as att_server_response_ready()).
+void c7222_grader_att_server_response_ready(uint16_t connection_handle);
+/// MTU the simulated server answers an Exchange MTU Request with; the harness
+/// reports the result as ATT_EVENT_MTU_EXCHANGE_COMPLETE.
+void c7222_grader_att_server_set_max_mtu(uint16_t mtu);
+}
+
+namespace {
+
+// BTstack event layout used by the simulated stack
+constexpr uint8_t kHciEventPacket = 0x04;
+constexpr uint8_t kAttEventConnected = 0xB3;
+constexpr uint8_t kAttEventDisconnected = 0xB4;
+constexpr uint8_t kAttEventHandleValueIndicationComplete = 0xB6;
+constexpr uint8_t kAttEventMtuExchangeComplete = 0xB5;
+constexpr uint8_t kAttEventCanSendNow = 0xB7;
+constexpr uint16_t kCanSendNowEventSize = 4;
+constexpr uint16_t kConnectedEventSize = 11;
+constexpr uint16_t kDisconnectedEventSize = 4;
+constexpr uint16_t kMtuExchangeCompleteEventSize = 6;
+constexpr uint16_t kIndicationCompleteEventSize = 7;
+constexpr uint8_t kAttHandleValueIndicationTimeout = 0x91;
+constexpr uint8_t kAttHandleValueIndicationDisconnect = 0x92;
+// Same ACL payload as the Pico W configuration: HCI_ACL_PAYLOAD_SIZE (255 + 4)
+// minus the 4-byte L2CAP header.
+constexpr uint16_t kMaxSupportedMtu = 255;
+
+uint16_t ReadLe16(const uint8_t* data) {
+	return static_cast<uint16_t>(data[0] | (static_cast<uint16_t>(data[1]) << 8));
+}
+
+}  // namespace
+
 BleError AttributeServer::Init(const void* context) {
+	return InitPlatform(context, nullptr);
+}
+
+BleError AttributeServer::Init(const void* context, const GattDatabaseLayout& layout) {
+	return InitPlatform(context, &layout);
+}
+
+BleError AttributeServer::InitPlatform(const void* context, const GattDatabaseLayout* layout) {
 	services_.clear();
+	handle_table_.clear();
+	service_index_.Clear();
+	characteristic_index_.Clear();
+	ClearPendingNotifications();
+	ClearDeferredUpdates();
+	ClearDeferredResponse();
+	CancelAllPreparedWrites();
+	deferred_waiters_.clear();
+	connections_.clear();
+	indication_channels_.clear();
 	connection_handle_ = 0;
+	request_connection_handle_ = 0;
 	initialized_ = false;
 
+	if(context == nullptr) {
+		return BleError::kUnspecifiedError;
+	}
 	if(context_ == nullptr) {
 		context_ = context;
 	}
-	(void) context_;
-	return BleError::kUnsupportedFeatureOrParameterValue;
+
+	// The harness hands in the same compile_gatt.py blob as the Pico build and
+	// drives ReadAttribute()/WriteAttribute() directly, so only the service
+	// graph needs building here.
+	InitServicesFromDb(static_cast<const uint8_t*>(context_), layout);
+	ApplyPreferredMtu(preferred_mtu_);
+	initialized_ = true;
+	return BleError::kSuccess;
+}
+
+AttributeServer::AttEvent AttributeServer::DecodeAttEvent(uint8_t packet_type,
+														  const uint8_t* packet_data,
+														  uint16_t packet_data_size) {
+	AttEvent event{};
+	if(packet_type != kHciEventPacket || packet_data == nullptr || packet_data_size == 0) {
+		return event;
+	}
+	switch(packet_data[0]) {
+	case kAttEventCanSendNow:
+		if(packet_data_size >= kCanSendNowEventSize) {
+			event.type = AttEvent::Type::kCanSendNow;
+			event.connection_handle = ReadLe16(&packet_data[2]);
+		}
+		break;
+	case kAttEventHandleValueIndicationComplete:
+		if(packet_data_size >= kIndicationCompleteEventSize) {
+			event.type = AttEvent::Type::kIndicationComplete;
+			event.connection_handle = ReadLe16(&packet_data[3]);
+			event.attribute_handle = ReadLe16(&packet_data[5]);
+			switch(packet_data[2]) {
+			case 0:
+				event.status = BleError::kSuccess;
+				break;
+			case kAttHandleValueIndicationTimeout:
+				event.status = BleError::kAttHandleValueIndicationTimeout;
+				break;
+			case kAttHandleValueIndicationDisconnect:
+				event.status = BleError::kAttHandleValueIndicationDisconnect;
+				break;
+			default:
+				event.status = BleError::kUnspecifiedError;
+				break;
+			}
+		}
+		break;
+	case kAttEventConnected:
+		// address_type(1) address(6) handle(2)
+		if(packet_data_size >= kConnectedEventSize) {
+			event.type = AttEvent::Type::kConnected;
+			event.connection_handle = ReadLe16(&packet_data[9]);
+		}
+		break;
+	case kAttEventDisconnected:
+		// handle(2)
+		if(packet_data_size >= kDisconnectedEventSize) {
+			event.type = AttEvent::Type::kDisconnected;
+			event.connection_handle = ReadLe16(&packet_data[2]);
+		}
+		break;
+	case kAttEventMtuExchangeComplete:
+		// handle(2) mtu(2)
+		if(packet_data_size >= kMtuExchangeCompleteEventSize) {
+			event.type = AttEvent::Type::kMtuExchangeComplete;
+			event.connection_handle = ReadLe16(&packet_data[2]);
+			event.mtu = ReadLe16(&packet_data[4]);
+		}
+		break;
+	default:
+		break;
+	}
+	return event;
+}
+
+void AttributeServer::RequestCanSendNowEvent(uint16_t connection_handle) {
+	c7222_grader_att_server_request_can_send_now_event(connection_handle);
+}
+
+void AttributeServer::ArmUpdateTimer(uint32_t delay_ms) {
+	c7222_grader_att_server_set_timer(delay_ms);
+}
+
+void AttributeServer::CancelUpdateTimer() {
+	c7222_grader_att_server_cancel_timer();
+}
+
+void AttributeServer::ScheduleStackWork() {
+	c7222_grader_att_server_schedule_stack_work();
+}
+
+uint32_t AttributeServer::GetContextId() {
+	// Top bit clear: never kNoStackContext.
+	return static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()) & 0x7FFFFFFFu);
+}
+
+void AttributeServer::SignalResponseReady(uint16_t connection_handle) {
+	c7222_grader_att_server_response_ready(connection_handle);
+}
+
+uint16_t AttributeServer::GetMaxSupportedMtu() {
+	return kMaxSupportedMtu;
+}
+
+void AttributeServer::ApplyPreferredMtu(uint16_t mtu) {
+	c7222_grader_att_server_set_max_mtu(mtu);
 }
 
 }  // namespace c7222
@@ -0,0 +1,95 @@
+#include "characteristic.hpp"
+
+#include <cassert>
+
+namespace c7222 {
+
+extern "C" {
+/**
+ * Simulated ATT server transport. Return values follow BTstack:
+ * 0 on success, 0x57 (BTSTACK_ACL_BUFFERS_FULL) when no buffer is free.
+ */
+int c7222_grader_att_server_notify(uint16_t connection_handle,
+								   uint16_t attribute_handle,
+								   const uint8_t* data,
+								   uint16_t size);
+int c7222_grader_att_server_indicate(uint16_t connection_handle,
+									 uint16_t attribute_handle,
+									 const uint8_t* data,
+									 uint16_t size);
+}
+
+namespace {
+
+// BTstack event layout used by the simulated stack
+constexpr uint8_t kHciEventPacket = 0x04;
+constexpr uint8_t kAttEventHandleValueIndicationComplete = 0xB6;
+constexpr uint8_t kAttEventCanSendNow = 0xB7;
+constexpr uint8_t kIndicationCompleteStatusOffset = 2;
+constexpr int kBtstackAclBuffersFull = 0x57;
+
+}  // namespace
+
+BleError Characteristic::SendValueUpdate(uint16_t connection_handle,
+										 bool indicate,
+										 const uint8_t* data,
+										 uint16_t size) {
+	assert((connection_handle != 0) && "Invalid connection handle. Must be connected before updating the CCCD value!");
+
+	const int status =
+		indicate ? c7222_grader_att_server_indicate(connection_handle, value_attr_.GetHandle(), data, size)
+				 : c7222_grader_att_server_notify(connection_handle, value_attr_.GetHandle(), data, size);
+	if(status == 0) {
+		return BleError::kSuccess;
+	}
+	if(status == kBtstackAclBuffersFull) {
+		return BleError::kBtstackAclBuffersFull;
+	}
+	return BleError::kUnspecifiedError;
+}
+
+BleError Characteristic::DispatchBleHciPacket(uint8_t packet_type,
+											  const uint8_t* packet_data,
+											  uint16_t packet_data_size) {
+	if(packet_type != kHciEventPacket || packet_data == nullptr || packet_data_size == 0) {
+		return BleError::kSuccess;
+	}
+
+	const uint8_t event_code = packet_data[0];
+	if(event_code == kAttEventHandleValueIndicationComplete) {
+		return DispatchEvent(EventId::kHandleValueIndicationComplete, packet_data, packet_data_size);
+	}
+
+	// Send the queued update; nothing to do if no update is pending
+	if(event_code == kAttEventCanSendNow) {
+		return FlushPendingUpdate();
+	}
+
+	return BleError::kSuccess;
+}
+
+BleError Characteristic::DispatchEvent(EventId event_id,
+									   const uint8_t* event_data,
+									   uint16_t event_data_size) {
+	switch(event_id) {
+	case EventId::kHandleValueIndicationComplete: {
+		if(event_data == nullptr || event_data_size <= kIndicationCompleteStatusOffset) {
+			return BleError::kSuccess;
+		}
+		const uint8_t status = event_data[kIndicationCompleteStatusOffset];
+		for(auto* handler: event_handlers_) {
+			if(handler) {
+				handler->OnIndicationComplete(status);
+				handler->OnConfirmationReceived(status == 0);
+			}
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	return BleError::kSuccess;
+}
+
+}  // namespace c7222
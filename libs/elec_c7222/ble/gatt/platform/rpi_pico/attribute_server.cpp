@@ -1,11 +1,11 @@
 #include "attribute_server.hpp"
 
 #include <btstack.h>
+#include "pico/platform.h"
 
-#include <array>
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
-#include <memory>
 
 namespace c7222 {
 namespace btstack_map {
@@ -15,96 +15,33 @@ extern bool FromBtStackError(uint8_t code, BleError& out);
 
 namespace {
 
-// Binary parsing helpers
-constexpr size_t kEntryHeaderSize = 6;	// Size + Flags + Handle
-constexpr size_t kUuid16Size = 2;
-constexpr size_t kUuid128Size = 16;
-constexpr size_t kValue16Offset = kEntryHeaderSize + kUuid16Size;	 // 8
-constexpr size_t kValue128Offset = kEntryHeaderSize + kUuid128Size;	 // 22
-
-uint16_t ReadLe16(const uint8_t* data) {
-	return *(reinterpret_cast<const uint16_t*>(data));
-}
-
-std::array<uint8_t, 16> ReverseUuid128(const uint8_t* data) {
-	std::array<uint8_t, 16> out{};
-	for(size_t i = 0; i < out.size(); ++i) {
-		out[i] = data[out.size() - 1 - i];
-	}
-	return out;
-}
-
-Attribute ParseEntry(const uint8_t* ptr, uint16_t entry_size) {
-	const uint16_t flags = ReadLe16(ptr + 2);
-	const uint16_t handle = ReadLe16(ptr + 4);
-	const uint8_t* uuid_ptr = ptr + 6;
-
-	if((flags & static_cast<uint16_t>(Attribute::Properties::kUuid128)) != 0) {
-		if(entry_size < kValue128Offset) {
-			return Attribute();
-		}
-		const uint8_t* value_ptr = ptr + kValue128Offset;
-		const uint16_t value_len = static_cast<uint16_t>(entry_size - kValue128Offset);
-		const std::array<uint8_t, 16> uuid_bytes = ReverseUuid128(uuid_ptr);
-		return Attribute(Uuid(uuid_bytes), flags, value_ptr, value_len, handle);
-	}
-
-	if(entry_size < kValue16Offset) {
-		return Attribute();
-	}
-	const uint16_t uuid16 = ReadLe16(uuid_ptr);
-	const uint8_t* value_ptr = ptr + kValue16Offset;
-	const uint16_t value_len = static_cast<uint16_t>(entry_size - kValue16Offset);
-	return Attribute(Uuid(uuid16), flags, value_ptr, value_len, handle);
-}
-
-std::unique_ptr<std::list<Attribute>> ParseAttributesFromDb(const uint8_t* db) {
-	auto attributes = std::make_unique<std::list<Attribute>>();
-
-	if(db == nullptr) {
-		return attributes;
-	}
-
-	const uint8_t* ptr = db + 1;
-
-	while(true) {
-		const uint16_t entry_size = ReadLe16(ptr);
-		if(entry_size == 0) {
-			break;
-		}
-		if(entry_size < kEntryHeaderSize) {
-			break;
-		}
-
-		attributes->emplace_back(ParseEntry(ptr, entry_size));
-		ptr += entry_size;
-	}
-
-	return attributes;
-}
-
 uint16_t att_read_callback(hci_con_handle_t connection_handle,
 						   uint16_t attribute_handle,
 						   uint16_t offset,
 						   uint8_t* buffer,
 						   uint16_t buffer_size) {
-	(void) connection_handle;
 	auto* server = AttributeServer::GetInstance();
 	if(server == nullptr) {
 		return ATT_ERROR_UNLIKELY_ERROR;
 	}
 
 	const AttributeServer::ReadResult result =
-		server->ReadAttribute(attribute_handle, offset, buffer, buffer_size);
+		server->ReadAttribute(connection_handle, attribute_handle, offset, buffer, buffer_size);
+	if(result.pending) {
+		return ATT_READ_RESPONSE_PENDING;
+	}
 	if(result.ok) {
 		return result.bytes;
 	}
 
 	uint8_t bt_error = ATT_ERROR_UNLIKELY_ERROR;
-	if(btstack_map::ToBtStack(result.error, bt_error)) {
-		return bt_error;
-	}
-	return ATT_ERROR_UNLIKELY_ERROR;
+	(void)btstack_map::ToBtStack(result.error, bt_error);
+#ifdef ATT_READ_ERROR_CODE_OFFSET
+	// Read errors (e.g. Database Out Of Sync) are reported above any valid length.
+	return static_cast<uint16_t>(ATT_READ_ERROR_CODE_OFFSET + bt_error);
+#else
+	return bt_error;
+#endif
 }
 
 int att_write_callback(hci_con_handle_t connection_handle,
@@ -113,20 +50,41 @@ int att_write_callback(hci_con_handle_t connection_handle,
 					   uint16_t offset,
 					   uint8_t* buffer,
 					   uint16_t buffer_size) {
-	(void) connection_handle;
-	(void) transaction_mode;
-	if(attribute_handle == 0) {
-		return 0;
-	}
 	auto* server = AttributeServer::GetInstance();
 	if(server == nullptr) {
 		return ATT_ERROR_UNLIKELY_ERROR;
 	}
 
-	const BleError status = server->WriteAttribute(attribute_handle, offset, buffer, buffer_size);
+	BleError status = BleError::kSuccess;
+	switch(transaction_mode) {
+	case ATT_TRANSACTION_MODE_ACTIVE:
+		// Prepare Write: queue the chunk for Execute Write
+		status = server->PrepareWrite(connection_handle, attribute_handle, offset, buffer, buffer_size);
+		break;
+#ifdef ATT_TRANSACTION_MODE_VALIDATE
+	case ATT_TRANSACTION_MODE_VALIDATE:
+		status = server->ValidatePreparedWrites(connection_handle);
+		break;
+#endif
+	case ATT_TRANSACTION_MODE_EXECUTE:
+		status = server->ExecutePreparedWrites(connection_handle);
+		break;
+	case ATT_TRANSACTION_MODE_CANCEL:
+		server->CancelPreparedWrites(connection_handle);
+		break;
+	default:
+		if(attribute_handle == 0) {
+			return 0;
+		}
+		status = server->WriteAttribute(connection_handle, attribute_handle, offset, buffer, buffer_size);
+		break;
+	}
 	if(status == BleError::kSuccess) {
 		return 0;
 	}
+	if(status == BleError::kAttResponsePending) {
+		return ATT_ERROR_WRITE_RESPONSE_PENDING;
+	}
 
 	uint8_t bt_error = ATT_ERROR_UNLIKELY_ERROR;
 	if(btstack_map::ToBtStack(status, bt_error)) {
@@ -135,6 +93,29 @@ int att_write_callback(hci_con_handle_t connection_handle,
 	return ATT_ERROR_UNLIKELY_ERROR;
 }
 
+// Single run-loop timer releasing rate-limited characteristic updates.
+btstack_timer_source_t update_timer;
+
+void update_timer_handler(btstack_timer_source_t* timer) {
+	(void)timer;
+	auto* server = AttributeServer::GetInstance();
+	if(server != nullptr) {
+		server->ProcessDeferredUpdates();
+	}
+}
+
+// Hands work (deferred ATT responses, ingest credit reports) from application
+// tasks to the BTstack run loop.
+btstack_context_callback_registration_t stack_work_callback;
+
+void stack_work_handler(void* context) {
+	(void)context;
+	auto* server = AttributeServer::GetInstance();
+	if(server != nullptr) {
+		server->ProcessStackWork();
+	}
+}
+
 void att_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t* packet, uint16_t size) {
 	(void)channel;
 	auto* server = AttributeServer::GetInstance();
@@ -150,9 +131,28 @@ void att_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t* packet,
 }  // namespace
 
 BleError AttributeServer::Init(const void* context) {
+	return InitPlatform(context, nullptr);
+}
+
+BleError AttributeServer::Init(const void* context, const GattDatabaseLayout& layout) {
+	return InitPlatform(context, &layout);
+}
+
+BleError AttributeServer::InitPlatform(const void* context, const GattDatabaseLayout* layout) {
 	// Reset runtime state before re-initializing from the platform context.
 	services_.clear();
+	handle_table_.clear();
+	service_index_.Clear();
+	characteristic_index_.Clear();
+	ClearPendingNotifications();
+	ClearDeferredUpdates();
+	ClearDeferredResponse();
+	CancelAllPreparedWrites();
+	deferred_waiters_.clear();
+	connections_.clear();
+	indication_channels_.clear();
 	connection_handle_ = 0;
+	request_connection_handle_ = 0;
 	initialized_ = false;
 
 	assert(context != nullptr &&
@@ -168,11 +168,7 @@ BleError AttributeServer::Init(const void* context) {
 	}
 
 	const auto* att_db = static_cast<const uint8_t*>(context_);
-	// Parse the BTstack ATT DB into Attribute objects and build services.
-	auto attributes = ParseAttributesFromDb(att_db);
-	if(attributes) {
-		InitServices(*attributes);
-	}
+	InitServicesFromDb(att_db, layout);
 	// we must give some time before we can initialize the ATT server, 
 	// otherwise btstack may fail to register callbacks.
 	vTaskDelay(pdMS_TO_TICKS(100));
@@ -183,8 +179,89 @@ BleError AttributeServer::Init(const void* context) {
 	// Register ATT read/write callbacks with BTstack using the ATT DB blob.
 	att_server_init(att_db, att_read_callback, att_write_callback);
 	att_server_register_packet_handler(att_packet_handler);
+	ApplyPreferredMtu(preferred_mtu_);
 	initialized_ = true;
 	return BleError::kSuccess;
 }
 
+AttributeServer::AttEvent AttributeServer::DecodeAttEvent(uint8_t packet_type,
+														  const uint8_t* packet_data,
+														  uint16_t packet_data_size) {
+	AttEvent event{};
+	if(packet_type != HCI_EVENT_PACKET || packet_data == nullptr || packet_data_size == 0) {
+		return event;
+	}
+	switch(hci_event_packet_get_type(packet_data)) {
+	case ATT_EVENT_CAN_SEND_NOW:
+		event.type = AttEvent::Type::kCanSendNow;
+		event.connection_handle = att_event_can_send_now_get_handle(packet_data);
+		break;
+	case ATT_EVENT_HANDLE_VALUE_INDICATION_COMPLETE:
+		event.type = AttEvent::Type::kIndicationComplete;
+		event.connection_handle = att_event_handle_value_indication_complete_get_conn_handle(packet_data);
+		event.attribute_handle = att_event_handle_value_indication_complete_get_attribute_handle(packet_data);
+		if(!btstack_map::FromBtStackError(att_event_handle_value_indication_complete_get_status(packet_data),
+										  event.status)) {
+			event.status = BleError::kUnspecifiedError;
+		}
+		break;
+	case ATT_EVENT_CONNECTED:
+		event.type = AttEvent::Type::kConnected;
+		event.connection_handle = att_event_connected_get_handle(packet_data);
+		break;
+	case ATT_EVENT_DISCONNECTED:
+		event.type = AttEvent::Type::kDisconnected;
+		event.connection_handle = att_event_disconnected_get_handle(packet_data);
+		break;
+	case ATT_EVENT_MTU_EXCHANGE_COMPLETE:
+		event.type = AttEvent::Type::kMtuExchangeComplete;
+		event.connection_handle = att_event_mtu_exchange_complete_get_handle(packet_data);
+		event.mtu = att_event_mtu_exchange_complete_get_MTU(packet_data);
+		break;
+	default:
+		break;
+	}
+	return event;
+}
+
+void AttributeServer::RequestCanSendNowEvent(uint16_t connection_handle) {
+	att_server_request_can_send_now_event(connection_handle);
+}
+
+void AttributeServer::ArmUpdateTimer(uint32_t delay_ms) {
+	btstack_run_loop_remove_timer(&update_timer);
+	btstack_run_loop_set_timer_handler(&update_timer, update_timer_handler);
+	btstack_run_loop_set_timer(&update_timer, delay_ms);
+	btstack_run_loop_add_timer(&update_timer);
+}
+
+void AttributeServer::CancelUpdateTimer() {
+	btstack_run_loop_remove_timer(&update_timer);
+}
+
+void AttributeServer::ScheduleStackWork() {
+	stack_work_callback.callback = stack_work_handler;
+	stack_work_callback.context = nullptr;
+	btstack_run_loop_execute_on_main_thread(&stack_work_callback);
+}
+
+uint32_t AttributeServer::GetContextId() {
+	// BTstack runs in a low-priority IRQ on one core: tasks on that core
+	// never run while it does, tasks on the other core report the other id.
+	return get_core_num();
+}
+
+void AttributeServer::SignalResponseReady(uint16_t connection_handle) {
+	(void)att_server_response_ready(connection_handle);
+}
+
+uint16_t AttributeServer::GetMaxSupportedMtu() {
+	// One ATT PDU per ACL packet: no L2CAP fragmentation of notifications.
+	return static_cast<uint16_t>(HCI_ACL_PAYLOAD_SIZE - L2CAP_HEADER_SIZE);
+}
+
+void AttributeServer::ApplyPreferredMtu(uint16_t mtu) {
+	l2cap_set_max_le_mtu(mtu);
+}
+
 }  // namespace c7222
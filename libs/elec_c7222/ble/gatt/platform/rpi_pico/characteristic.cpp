@@ -2,64 +2,36 @@
 
 #include <btstack.h>
 
-namespace c7222 {
-
-BleError Characteristic::UpdateValue() {
-	// Only send if we have a valid connection handle
-	if(connection_handle_ == 0) {
-		return BleError::kSuccess;
-	}
-
-	// Get the CCCD to check if notifications/indications are enabled
-	const Attribute* cccd = GetCCCD();
-	if(cccd == nullptr || cccd->GetValueSize() < 2) {
-		return BleError::kSuccess;
-	}
-
-	// Read CCCD value (2 bytes, little-endian)
-	const uint8_t* cccd_data = cccd->GetValueData();
-	const uint16_t cccd_value = *reinterpret_cast<const uint16_t*>(cccd_data);
-
-	// Check which updates are enabled (from CCCDProperties enum)
-	const bool notify_enabled = (cccd_value & static_cast<uint16_t>(CCCDProperties::kNotifications)) != 0;
-	const bool indicate_enabled = (cccd_value & static_cast<uint16_t>(CCCDProperties::kIndications)) != 0;
-
-	// If neither is enabled, nothing to do
-	if(!notify_enabled && !indicate_enabled) {
-		return BleError::kSuccess;
-	}
+#include <cassert>
 
-	// Get the value to send
-	const uint8_t* value_data = GetValueData();
-	auto value_size = static_cast<uint16_t>(GetValueSize());
+namespace c7222 {
+namespace btstack_map {
+extern bool FromBtStackError(uint8_t code, BleError& out);
+}
 
-	if(value_data == nullptr) {
-		return BleError::kSuccess;
-	}
+BleError Characteristic::SendValueUpdate(uint16_t connection_handle,
+										 bool indicate,
+										 const uint8_t* data,
+										 uint16_t size) {
+	assert((connection_handle != 0) && "Invalid connection handle. Must be connected before updating the CCCD value!");
 
 	int status = 0;
-	
-	assert((connection_handle_ != 0) && "Invalid connection handle. Must be connected before updating the CCCD value!");
-	// Prioritize indication over notification if both are enabled
-	if(indicate_enabled) {
+	if(indicate) {
 		// Send indication using BTstack's att_server_indicate
-		status = att_server_indicate(connection_handle_, value_attr_.GetHandle(), value_data, value_size);
-	} else { // if(notify_enabled)
+		status = att_server_indicate(connection_handle, value_attr_.GetHandle(), data, size);
+	} else {
 		// Send notification using BTstack's att_server_notify
-		status = att_server_notify(connection_handle_, value_attr_.GetHandle(), value_data, value_size);
+		status = att_server_notify(connection_handle, value_attr_.GetHandle(), data, size);
 	}
 
-	// Check if buffers are full
 	if(status == BTSTACK_ACL_BUFFERS_FULL) {
-		// Stack is busy. Mark as pending and request the callback.
-		notification_pending_ = true;
-		att_server_request_can_send_now_event(connection_handle_);
-	} else {
-		// Successfully sent or other status - clear pending flag
-		notification_pending_ = false;
+		return BleError::kBtstackAclBuffersFull;
 	}
-
-	return BleError::kSuccess;
+	BleError error = BleError::kUnspecifiedError;
+	if(btstack_map::FromBtStackError(static_cast<uint8_t>(status), error)) {
+		return error;
+	}
+	return BleError::kUnspecifiedError;
 }
 
 BleError Characteristic::DispatchBleHciPacket(uint8_t packet_type,
@@ -70,15 +42,15 @@ BleError Characteristic::DispatchBleHciPacket(uint8_t packet_type,
 	}
 
 	const uint8_t event_code = hci_event_packet_get_type(packet_data);
-	
+
 	// Check for ATT events
 	if(event_code == ATT_EVENT_HANDLE_VALUE_INDICATION_COMPLETE) {
 		return DispatchEvent(EventId::kHandleValueIndicationComplete, packet_data, packet_data_size);
 	}
-	
-	// Handle ATT_EVENT_CAN_SEND_NOW by calling UpdateValue to send pending data
+
+	// Send the queued update; nothing to do if no update is pending
 	if(event_code == ATT_EVENT_CAN_SEND_NOW) {
-		return UpdateValue();
+		return FlushPendingUpdate();
 	}
 
 	return BleError::kSuccess;
@@ -93,7 +65,7 @@ BleError Characteristic::DispatchEvent(EventId event_id,
 	case EventId::kHandleValueIndicationComplete: {
 		// Extract status from the ATT event
 		uint8_t status = att_event_handle_value_indication_complete_get_status(event_data);
-		
+
 		// Call OnConfirmationComplete on all registered event handlers
 		for(auto* handler: event_handlers_) {
 			if(handler) {
@@ -5,6 +5,7 @@
 
 #include "attribute.hpp"
 #include <algorithm>
+#include <cassert>
 #include <iomanip>
 #include <utility>
 #include "ble_error.hpp"
@@ -26,7 +27,7 @@ void AppendUuidBytes(std::vector<uint8_t>& out, const Uuid& uuid) {
 
 std::ostream& operator<<(std::ostream& os, const Attribute& attr) {
 	os << "(handle=0x" << std::hex << std::setw(4) << std::setfill('0') << attr.GetHandle()
-	   << ", uuid=" << attr.uuid_ << ", properties=0x" << std::setw(4) << attr.properties_ << " [";
+	   << ", uuid=" << attr.GetUuid() << ", properties=0x" << std::setw(4) << attr.properties_ << " [";
 
 	// Parse and output property flags
 	bool first = true;
@@ -136,7 +137,7 @@ std::ostream& operator<<(std::ostream& os, const Attribute& attr) {
 }
 
 Attribute::Attribute(const Uuid& uuid, uint16_t properties, uint16_t handle) {
-	uuid_ = uuid;
+	uuid_ = CompactUuid(uuid);
 	properties_ = properties;
 	handle_ = handle;
 	UpdateUuidProperty();
@@ -148,14 +149,15 @@ Attribute::Attribute(const Uuid& uuid, uint16_t properties, const uint8_t* data,
 	UpdateUuidProperty();
 	if(data != nullptr && size > 0) {
 		if((properties_ & static_cast<uint16_t>(Properties::kDynamic)) != 0) {
-			// Dynamic: copy to vector for mutable storage
-			dynamic_value_.assign(data, data + size);
+			// Dynamic: copy into owned mutable storage
+			dynamic_value_.Assign(data, size);
 			static_value_ptr_ = nullptr;
 			static_value_size_ = 0;
 		} else {
 			// Static: just store pointer to const DB data
+			assert(size <= UINT16_MAX && "Attribute value too large");
 			static_value_ptr_ = data;
-			static_value_size_ = size;
+			static_value_size_ = static_cast<uint16_t>(size);
 		}
 	}
 }
@@ -165,12 +167,8 @@ bool Attribute::SetValue(const uint8_t* data, size_t size) {
 		return false;
 	}
 
-	// For dynamic attributes, store in vector
-	if(data == nullptr || size == 0) {
-		dynamic_value_.clear();
-		return true;
-	}
-	dynamic_value_.assign(data, data + size);
+	// For dynamic attributes, store in owned storage (empty input clears)
+	dynamic_value_.Assign(data, size);
 	return true;
 }
 
@@ -186,8 +184,9 @@ bool Attribute::SetStaticValue(const uint8_t* data, size_t size) {
 		return true;
 	}
 
+	assert(size <= UINT16_MAX && "Attribute value too large");
 	static_value_ptr_ = data;
-	static_value_size_ = size;
+	static_value_size_ = static_cast<uint16_t>(size);
 	return true;
 }
 
@@ -196,11 +195,7 @@ bool Attribute::SetValue(const std::vector<uint8_t>& data) {
 		return false;
 	}
 
-	if(data.empty()) {
-		dynamic_value_.clear();
-	} else {
-		dynamic_value_ = data;
-	}
+	dynamic_value_.Assign(data.data(), data.size());
 	return true;
 }
 
@@ -213,51 +208,51 @@ bool Attribute::SetValue(std::vector<uint8_t>&& data) {
 		return false;
 	}
 
-	// Move into dynamic storage (empty input clears)
-	dynamic_value_ = std::move(data);
+	// Copy into dynamic storage (empty input clears)
+	dynamic_value_.Assign(data.data(), data.size());
 	return true;
 }
 
 // ========== Static Helper Functions for Attribute Type Checking ==========
 
 bool Attribute::IsPrimaryServiceDeclaration(const Attribute& attr) {
-	return Uuid::IsPrimaryServiceDeclaration(attr.uuid_);
+	return Uuid::IsPrimaryServiceDeclaration(attr.GetUuid());
 }
 
 bool Attribute::IsSecondaryServiceDeclaration(const Attribute& attr) {
-	return Uuid::IsSecondaryServiceDeclaration(attr.uuid_);
+	return Uuid::IsSecondaryServiceDeclaration(attr.GetUuid());
 }
 
 bool Attribute::IsIncludedServiceDeclaration(const Attribute& attr) {
-	return Uuid::IsIncludedServiceDeclaration(attr.uuid_);
+	return Uuid::IsIncludedServiceDeclaration(attr.GetUuid());
 }
 
 bool Attribute::IsCharacteristicDeclaration(const Attribute& attr) {
-	return Uuid::IsCharacteristicDeclaration(attr.uuid_);
+	return Uuid::IsCharacteristicDeclaration(attr.GetUuid());
 }
 
 bool Attribute::IsServiceDeclaration(const Attribute& attr) {
-	return Uuid::IsServiceDeclaration(attr.uuid_);
+	return Uuid::IsServiceDeclaration(attr.GetUuid());
 }
 
 bool Attribute::IsClientCharacteristicConfiguration(const Attribute& attr) {
-	return Uuid::IsClientCharacteristicConfiguration(attr.uuid_);
+	return Uuid::IsClientCharacteristicConfiguration(attr.GetUuid());
 }
 
 bool Attribute::IsServerCharacteristicConfiguration(const Attribute& attr) {
-	return Uuid::IsServerCharacteristicConfiguration(attr.uuid_);
+	return Uuid::IsServerCharacteristicConfiguration(attr.GetUuid());
 }
 
 bool Attribute::IsCharacteristicUserDescription(const Attribute& attr) {
-	return Uuid::IsCharacteristicUserDescription(attr.uuid_);
+	return Uuid::IsCharacteristicUserDescription(attr.GetUuid());
 }
 
 bool Attribute::IsCharacteristicExtendedProperties(const Attribute& attr) {
-	return Uuid::IsCharacteristicExtendedProperties(attr.uuid_);
+	return Uuid::IsCharacteristicExtendedProperties(attr.GetUuid());
 }
 
 bool Attribute::IsDescriptor(const Attribute& attr) {
-	return Uuid::IsDescriptor(attr.uuid_);
+	return Uuid::IsDescriptor(attr.GetUuid());
 }
 
 Attribute Attribute::PrimaryServiceDeclaration(const Uuid& service_uuid, uint16_t handle) {
@@ -396,8 +391,8 @@ Attribute Attribute::CharacteristicAggregateFormat(const std::vector<uint16_t>&
 }
 
 uint16_t Attribute::InvokeReadCallback(uint16_t offset, uint8_t* buffer, uint16_t buffer_size) const {
-	if(read_callback_) {
-		return read_callback_(offset, buffer, buffer_size);
+	if(HasReadCallback()) {
+		return callbacks_->read(offset, buffer, buffer_size);
 	}
 	// Default: copy from value storage
 	const uint8_t* value_data = GetValueData();
@@ -423,8 +418,8 @@ BleError Attribute::InvokeWriteCallback(uint16_t offset, const uint8_t* data, ui
 	}
 	
 	if(is_dynamic) {
-		if(write_callback_) {
-			const BleError status = write_callback_(offset, data, size);
+		if(HasWriteCallback()) {
+			const BleError status = callbacks_->write(offset, data, size);
 			if(status != BleError::kSuccess) {
 				return status;
 			}
@@ -433,14 +428,14 @@ BleError Attribute::InvokeWriteCallback(uint16_t offset, const uint8_t* data, ui
 		// Apply write into the dynamic storage after successful callback.
 		// Store only the written data chunk (no offset padding).
 		if(data != nullptr && size > 0) {
-			dynamic_value_.assign(data, data + size);
+			dynamic_value_.Assign(data, size);
 		}
 		return BleError::kSuccess;
 	}
 
 	// Static attributes cannot be written.
-	if(write_callback_) {
-		return write_callback_(offset, data, size);
+	if(HasWriteCallback()) {
+		return callbacks_->write(offset, data, size);
 	}
 	return BleError::kAttErrorWriteNotPermitted;
 }
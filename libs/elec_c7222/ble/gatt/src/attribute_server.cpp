@@ -2,234 +2,1506 @@
 #include "ble_utils.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstddef>
 #include <iterator>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 
 namespace c7222 {
 
+namespace {
+
+// Resets the request connection when an ATT request handler returns.
+class RequestConnectionScope {
+public:
+	explicit RequestConnectionScope(uint16_t& handle) : handle_(handle) {}
+	~RequestConnectionScope() {
+		handle_ = 0;
+	}
+	RequestConnectionScope(const RequestConnectionScope&) = delete;
+	RequestConnectionScope& operator=(const RequestConnectionScope&) = delete;
+
+private:
+	uint16_t& handle_;
+};
+
+// Marks the calling context as the BLE stack context while an entry point
+// runs. Nested entry points restore the outer value.
+class StackContextScope {
+public:
+	StackContextScope(std::atomic<uint32_t>& id, uint32_t current) : id_(id), previous_(id.exchange(current)) {}
+	~StackContextScope() {
+		id_.store(previous_);
+	}
+	StackContextScope(const StackContextScope&) = delete;
+	StackContextScope& operator=(const StackContextScope&) = delete;
+
+private:
+	std::atomic<uint32_t>& id_;
+	uint32_t previous_;
+};
+
+// Robust Caching state of a bond in the bond storage: the Database Hash it
+// last saw, then its Client Supported Features. Tags are 'GAT' + bond index,
+// clear of BTstack's 'BTD' device DB tags.
+constexpr uint32_t kBondStateTag = 0x47415400;
+constexpr size_t kBondStateSize = DatabaseHash::kSize + 1;
+
+// ATT DB blob parsing helpers (BTstack compile_gatt.py format)
+constexpr size_t kEntryHeaderSize = 6;	// Size + Flags + Handle
+constexpr size_t kUuid16Size = 2;
+constexpr size_t kUuid128Size = 16;
+constexpr size_t kValue16Offset = kEntryHeaderSize + kUuid16Size;	 // 8
+constexpr size_t kValue128Offset = kEntryHeaderSize + kUuid128Size;	 // 22
+
+uint16_t ReadDbLe16(const uint8_t* data) {
+	return static_cast<uint16_t>(data[0] | (static_cast<uint16_t>(data[1]) << 8));
+}
+
+std::array<uint8_t, 16> ReverseUuid128(const uint8_t* data) {
+	std::array<uint8_t, 16> out{};
+	for(size_t i = 0; i < out.size(); ++i) {
+		out[i] = data[out.size() - 1 - i];
+	}
+	return out;
+}
+
+Attribute ParseDbEntry(const uint8_t* ptr, uint16_t entry_size) {
+	const uint16_t flags = ReadDbLe16(ptr + 2);
+	const uint16_t handle = ReadDbLe16(ptr + 4);
+	const uint8_t* uuid_ptr = ptr + 6;
+
+	if((flags & static_cast<uint16_t>(Attribute::Properties::kUuid128)) != 0) {
+		if(entry_size < kValue128Offset) {
+			return Attribute();
+		}
+		const uint8_t* value_ptr = ptr + kValue128Offset;
+		const uint16_t value_len = static_cast<uint16_t>(entry_size - kValue128Offset);
+		const std::array<uint8_t, 16> uuid_bytes = ReverseUuid128(uuid_ptr);
+		return Attribute(Uuid(uuid_bytes), flags, value_ptr, value_len, handle);
+	}
+
+	if(entry_size < kValue16Offset) {
+		return Attribute();
+	}
+	const uint16_t uuid16 = ReadDbLe16(uuid_ptr);
+	const uint8_t* value_ptr = ptr + kValue16Offset;
+	const uint16_t value_len = static_cast<uint16_t>(entry_size - kValue16Offset);
+	return Attribute(Uuid(uuid16), flags, value_ptr, value_len, handle);
+}
+
+std::list<Attribute> ParseAttributesFromDb(const uint8_t* db) {
+	std::list<Attribute> attributes;
+	if(db == nullptr) {
+		return attributes;
+	}
+
+	const uint8_t* ptr = db + 1;  // skip the ATT DB version byte
+	while(true) {
+		const uint16_t entry_size = ReadDbLe16(ptr);
+		if(entry_size < kEntryHeaderSize) {
+			break;	// end marker (0) or malformed entry
+		}
+		attributes.emplace_back(ParseDbEntry(ptr, entry_size));
+		ptr += entry_size;
+	}
+	return attributes;
+}
+
+Attribute ParseLayoutEntry(const uint8_t* db, const GattDatabaseLayout& layout, uint16_t index) {
+	assert(index < layout.attribute_count && "GATT layout attribute index out of range");
+	const GattAttributeLayout& entry = layout.attributes[index];
+	const uint8_t* ptr = db + entry.offset;
+	assert(ReadDbLe16(ptr) == entry.size && ReadDbLe16(ptr + 4) == entry.handle &&
+		   "GATT layout does not match the ATT DB blob");
+	return ParseDbEntry(ptr, entry.size);
+}
+
+std::vector<Service> BuildServicesFromLayout(const uint8_t* db, const GattDatabaseLayout& layout) {
+	std::vector<Service> services;
+	services.reserve(layout.service_count);
+	for(size_t s = 0; s < layout.service_count; ++s) {
+		const GattServiceLayout& service = layout.services[s];
+
+		std::vector<Attribute> included_service_decls;
+		included_service_decls.reserve(service.included_count);
+		for(uint16_t i = 0; i < service.included_count; ++i) {
+			included_service_decls.push_back(
+				ParseLayoutEntry(db, layout, static_cast<uint16_t>(service.first_included + i)));
+		}
+
+		std::vector<Characteristic> characteristics;
+		characteristics.reserve(service.characteristic_count);
+		for(uint16_t c = 0; c < service.characteristic_count; ++c) {
+			const GattCharacteristicLayout& characteristic =
+				layout.characteristics[service.first_characteristic + c];
+			std::vector<Attribute> descriptors;
+			descriptors.reserve(characteristic.descriptor_count);
+			for(uint16_t d = 0; d < characteristic.descriptor_count; ++d) {
+				descriptors.push_back(ParseLayoutEntry(
+					db, layout, static_cast<uint16_t>(characteristic.first_descriptor + d)));
+			}
+			characteristics.emplace_back(ParseLayoutEntry(db, layout, characteristic.declaration),
+										 ParseLayoutEntry(db, layout, characteristic.value),
+										 std::move(descriptors));
+		}
+
+		services.emplace_back(ParseLayoutEntry(db, layout, service.declaration),
+							  std::move(included_service_decls),
+							  std::move(characteristics));
+	}
+	return services;
+}
+
+}  // namespace
+
 AttributeServer* AttributeServer::instance_ = nullptr;
 
+AttributeServer::~AttributeServer() {
+	IndicationHandOff* node = indication_hand_offs_.exchange(nullptr);
+	while(node != nullptr) {
+		std::unique_ptr<IndicationHandOff> hand_off(node);
+		node = node->next;
+	}
+}
+
 void AttributeServer::InitServices(std::list<Attribute>& attributes) {
 	services_ = Service::ParseFromAttributes(attributes);
+	RebuildHandleTable();
+	RebuildUuidIndex();
+	RebuildDatabaseHash();
+	RestorePersistentValues();
+}
+
+void AttributeServer::InitServices(std::vector<Service>&& services) {
+	services_ = std::move(services);
+	RebuildHandleTable();
+	RebuildUuidIndex();
+	RebuildDatabaseHash();
+	RestorePersistentValues();
+}
+
+void AttributeServer::InitServicesFromDb(const uint8_t* att_db, const GattDatabaseLayout* layout) {
+	if(layout != nullptr) {
+		// Materialize services straight from the build-time layout tables.
+		InitServices(BuildServicesFromLayout(att_db, *layout));
+		return;
+	}
+	// Walk the ATT DB into Attribute objects and build services.
+	auto attributes = ParseAttributesFromDb(att_db);
+	InitServices(attributes);
+}
+
+BleError AttributeServer::EnableValuePersistence(const ValueStore::Config& config) {
+	if(value_store_ != nullptr) {
+		return BleError::kCommandDisallowed;
+	}
+	auto store = std::make_unique<ValueStore>(config);
+	if(!store->Start()) {
+		return BleError::kHardwareFailure;
+	}
+	value_store_ = std::move(store);
+	if(!services_.empty()) {
+		RestorePersistentValues();
+	}
+	return BleError::kSuccess;
+}
+
+bool AttributeServer::FlushPersistentValues() {
+	return value_store_ != nullptr && value_store_->Flush();
+}
+
+void AttributeServer::RestorePersistentValues() {
+	if(value_store_ == nullptr || !value_store_->BindDatabase(database_hash_)) {
+		return;
+	}
+	size_t restored = 0;
+	std::vector<uint8_t> value;
+	for(const uint16_t handle: value_store_->GetHandles()) {
+		Characteristic* characteristic = FindCharacteristicByHandle(handle);
+		if(characteristic != nullptr && characteristic->GetValueHandle() == handle &&
+		   characteristic->IsDynamic() && value_store_->Load(handle, value)) {
+			characteristic->RestorePersistentValue(value.data(), value.size());
+			++restored;
+		} else {
+			(void)value_store_->StageErase(handle);
+		}
+	}
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: restored %u persistent values\n",
+		static_cast<unsigned>(restored));
+}
+
+void AttributeServer::RebuildUuidIndex() {
+	service_index_.Clear();
+	characteristic_index_.Clear();
+	for(auto& service: services_) {
+		service_index_.Add(&service);
+		for(auto& characteristic: service.GetCharacteristics()) {
+			characteristic_index_.Add(&characteristic);
+		}
+	}
+	service_index_.Finalize();
+	characteristic_index_.Finalize();
+}
+
+void AttributeServer::RebuildHandleTable() {
+	handle_table_.clear();
+
+	auto add_entry = [this](Attribute* attribute, Characteristic* characteristic) {
+		if(attribute == nullptr || attribute->GetHandle() == 0) {
+			return;
+		}
+		const uint16_t handle = attribute->GetHandle();
+		if(handle >= handle_table_.size()) {
+			handle_table_.resize(static_cast<size_t>(handle) + 1);
+		}
+		const uint16_t props = attribute->GetProperties();
+		HandleEntry& entry = handle_table_[handle];
+		entry.attribute = attribute;
+		entry.characteristic = characteristic;
+		entry.role = characteristic != nullptr ? characteristic->GetAttributeRole(*attribute)
+											   : Characteristic::AttributeRole::kNone;
+		entry.readable = (props & static_cast<uint16_t>(Attribute::Properties::kRead)) != 0;
+		entry.writable =
+			(props & static_cast<uint16_t>(Attribute::Properties::kWrite)) != 0 ||
+			(props & static_cast<uint16_t>(Attribute::Properties::kWriteWithoutResponse)) != 0;
+	};
+
+	for(auto& service: services_) {
+		add_entry(&service.GetDeclarationAttribute(), nullptr);
+		for(size_t i = 0; i < service.GetIncludedServiceDeclarationCount(); ++i) {
+			add_entry(&service.GetIncludedServiceDeclaration(i), nullptr);
+		}
+		for(auto& characteristic: service.GetCharacteristics()) {
+			add_entry(&characteristic.GetDeclarationAttribute(), &characteristic);
+			add_entry(&characteristic.GetValueAttribute(), &characteristic);
+			add_entry(characteristic.GetCCCD(), &characteristic);
+			add_entry(characteristic.GetSCCD(), &characteristic);
+			add_entry(characteristic.GetExtendedProperties(), &characteristic);
+			add_entry(characteristic.GetUserDescription(), &characteristic);
+			for(size_t j = 0; j < characteristic.GetDescriptorCount(); ++j) {
+				add_entry(characteristic.GetDescriptor(j), &characteristic);
+			}
+		}
+	}
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: handle table size=%u\n",
+		static_cast<unsigned>(handle_table_.size()));
+}
+
+void AttributeServer::RebuildDatabaseHash() {
+	DatabaseHash hash;
+	for(const auto& entry: handle_table_) {
+		if(entry.attribute != nullptr) {
+			hash.AddAttribute(entry.attribute->GetHandle(),
+							  entry.attribute->GetUuid(),
+							  entry.attribute->GetValueData(),
+							  entry.attribute->GetValueSize());
+		}
+	}
+	const DatabaseHash::Value previous = database_hash_;
+	database_hash_ = hash.Finish();
+
+	const Characteristic* client_features =
+		FindCharacteristicByUuid(Uuid(static_cast<uint16_t>(ORG_BLUETOOTH_CHARACTERISTIC_CLIENT_SUPPORTED_FEATURES))).front();
+	const Characteristic* service_changed =
+		FindCharacteristicByUuid(Uuid(static_cast<uint16_t>(ORG_BLUETOOTH_CHARACTERISTIC_GATT_SERVICE_CHANGED))).front();
+	Characteristic* database_hash =
+		FindCharacteristicByUuid(Uuid(static_cast<uint16_t>(ORG_BLUETOOTH_CHARACTERISTIC_DATABASE_HASH))).front();
+	client_features_handle_ = client_features != nullptr ? client_features->GetValueHandle() : 0;
+	service_changed_handle_ = service_changed != nullptr ? service_changed->GetValueHandle() : 0;
+	database_hash_handle_ = database_hash != nullptr ? database_hash->GetValueHandle() : 0;
+	if(database_hash != nullptr) {
+		Attribute& value = database_hash->GetValueAttribute();
+		if((value.GetProperties() & static_cast<uint16_t>(Attribute::Properties::kDynamic)) != 0) {
+			(void)value.SetValue(database_hash_.data(), database_hash_.size());
+		} else if(value.GetValueSize() == DatabaseHash::kSize &&
+				  !std::equal(database_hash_.begin(), database_hash_.end(), value.GetValueData())) {
+			// Clients read the static value, so it stays authoritative.
+			C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: static database hash differs from computed hash\n");
+			std::copy_n(value.GetValueData(), DatabaseHash::kSize, database_hash_.begin());
+		}
+	}
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: database hash over %u bytes\n",
+		static_cast<unsigned>(hash.GetMessageSize()));
+
+	if(previous != database_hash_) {
+		std::vector<uint16_t> handles;
+		handles.reserve(connections_.size());
+		for(const auto& info: connections_) {
+			handles.push_back(info.handle);
+		}
+		for(const uint16_t handle: handles) {
+			(void)MarkClientChangeUnaware(handle);
+		}
+	}
+}
+
+const AttributeServer::HandleEntry* AttributeServer::FindHandleEntry(uint16_t handle) const {
+	if(handle >= handle_table_.size()) {
+		return nullptr;
+	}
+	const HandleEntry& entry = handle_table_[handle];
+	return entry.attribute != nullptr ? &entry : nullptr;
 }
 
 Service& AttributeServer::GetService(size_t index) {
 	assert(index < services_.size() && "Service index out of range");
-	auto it = services_.begin();
-	std::advance(it, static_cast<long>(index));
-	return *it;
+	return services_[index];
+}
+
+const Service& AttributeServer::GetService(size_t index) const {
+	assert(index < services_.size() && "Service index out of range");
+	return services_[index];
+}
+
+Service* AttributeServer::FindServiceByUuid(const Uuid& uuid) {
+	return service_index_.Find(uuid).front();
+}
+
+const Service* AttributeServer::FindServiceByUuid(const Uuid& uuid) const {
+	return service_index_.Find(uuid).front();
+}
+
+bool AttributeServer::HasServicesRequiringAuthentication() const {
+	for(const auto& service : services_) {
+		if(service.HasCharacteristicsRequiringAuthentication()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool AttributeServer::HasServicesRequiringEncryption() const {
+	for(const auto& service : services_) {
+		if(service.HasCharacteristicsRequiringEncryption()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool AttributeServer::HasServicesRequiringAuthorization() const {
+	for(const auto& service : services_) {
+		if(service.HasCharacteristicsRequiringAuthorization()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+UuidRange<Characteristic> AttributeServer::FindCharacteristicByUuid(const Uuid& uuid) {
+	return characteristic_index_.Find(uuid);
+}
+
+UuidRange<const Characteristic> AttributeServer::FindCharacteristicByUuid(const Uuid& uuid) const {
+	return characteristic_index_.Find(uuid);
+}
+
+Characteristic* AttributeServer::FindCharacteristicByHandle(uint16_t handle) {
+	const HandleEntry* entry = FindHandleEntry(handle);
+	return entry != nullptr ? entry->characteristic : nullptr;
+}
+
+const Characteristic* AttributeServer::FindCharacteristicByHandle(uint16_t handle) const {
+	const HandleEntry* entry = FindHandleEntry(handle);
+	return entry != nullptr ? entry->characteristic : nullptr;
+}
+
+BleError AttributeServer::AddConnection(uint16_t connection_handle) {
+	if(connection_handle == 0) {
+		return BleError::kCommandDisallowed;
+	}
+	if(FindConnection(connection_handle) == nullptr) {
+		if(connections_.size() >= kMaxConnections) {
+			C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: connection limit reached, handle=0x%04x not served\n",
+				static_cast<unsigned>(connection_handle));
+			return BleError::kConnectionLimitExceeded;
+		}
+		connections_.reserve(kMaxConnections);
+		indication_channels_.reserve(kMaxConnections);
+		ConnectionInfo info;
+		info.handle = connection_handle;
+		connections_.push_back(info);
+		IndicationChannel channel;
+		channel.connection_handle = connection_handle;
+		indication_channels_.push_back(std::move(channel));
+		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: connection added handle=0x%04x (%u open)\n",
+			static_cast<unsigned>(connection_handle),
+			static_cast<unsigned>(connections_.size()));
+	}
+	if(connection_handle_ != connection_handle) {
+		connection_handle_ = connection_handle;
+		for(auto& service: services_) {
+			service.SetConnectionHandle(connection_handle);
+		}
+	}
+	return BleError::kSuccess;
+}
+
+void AttributeServer::RemoveConnection(uint16_t connection_handle) {
+	if(FindConnection(connection_handle) == nullptr) {
+		return;
+	}
+	if(deferred_state_.load() != DeferredState::kIdle &&
+	   deferred_response_.connection_handle == connection_handle) {
+		ClearDeferredResponse();
+	}
+	deferred_waiters_.erase(std::remove(deferred_waiters_.begin(), deferred_waiters_.end(), connection_handle),
+							deferred_waiters_.end());
+	CancelPreparedWrites(connection_handle);
+	FailPendingIndications(connection_handle, BleError::kAttHandleValueIndicationDisconnect);
+	indication_channels_.erase(
+		std::remove_if(indication_channels_.begin(),
+					   indication_channels_.end(),
+					   [connection_handle](const IndicationChannel& channel) {
+						   return channel.connection_handle == connection_handle;
+					   }),
+		indication_channels_.end());
+	for(auto& service: services_) {
+		for(auto& characteristic: service.GetCharacteristics()) {
+			characteristic.RemoveConnection(connection_handle);
+		}
+	}
+	connections_.erase(std::remove_if(connections_.begin(),
+									  connections_.end(),
+									  [connection_handle](const ConnectionInfo& info) {
+										  return info.handle == connection_handle;
+									  }),
+					   connections_.end());
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: connection removed handle=0x%04x (%u open)\n",
+		static_cast<unsigned>(connection_handle),
+		static_cast<unsigned>(connections_.size()));
+
+	const uint16_t active = connections_.empty() ? 0 : connections_.back().handle;
+	if(connection_handle_ != active) {
+		connection_handle_ = active;
+		for(auto& service: services_) {
+			service.SetConnectionHandle(active);
+		}
+	}
+	if(connections_.empty()) {
+		ClearPendingNotifications();
+		ClearDeferredUpdates();
+		return;
+	}
+	if(can_send_now_handle_ == connection_handle) {
+		// The requested event will not arrive; ask on a remaining connection.
+		can_send_now_handle_ = 0;
+		bool pending = std::any_of(indication_channels_.begin(),
+								   indication_channels_.end(),
+								   [](const IndicationChannel& channel) { return channel.blocked; });
+		for(const auto& queue: pending_notifications_) {
+			pending = pending || !queue.empty();
+		}
+		if(pending) {
+			RequestCanSendNowOnce(0);
+		}
+	}
+}
+
+void AttributeServer::SetConnectionHandle(uint16_t connection_handle) {
+	if(connection_handle == 0) {
+		SetDisconnected();
+		return;
+	}
+	(void)AddConnection(connection_handle);
+}
+
+void AttributeServer::SetDisconnected() {
+	while(!connections_.empty()) {
+		RemoveConnection(connections_.back().handle);
+	}
+	connection_handle_ = 0;
+	ClearPendingNotifications();
+	ClearDeferredUpdates();
+	ClearDeferredResponse();
+	deferred_waiters_.clear();
+	CancelAllPreparedWrites();
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: disconnected\n");
+	for(auto& service: services_) {
+		service.SetConnectionHandle(0);
+	}
+}
+
+void AttributeServer::SetSecurityLevel(uint16_t connection_handle, uint8_t security_level) {
+	ConnectionInfo* info = FindConnection(connection_handle);
+	if(info == nullptr) {
+		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: ignoring security level update (unknown conn=0x%04x)\n",
+			static_cast<unsigned>(connection_handle));
+		return;
+	}
+	info->security_level = security_level;
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: security level=%u (handle=0x%04x)\n",
+		static_cast<unsigned>(security_level),
+		static_cast<unsigned>(connection_handle));
+}
+
+uint8_t AttributeServer::GetSecurityLevel(uint16_t connection_handle) const {
+	const ConnectionInfo* info = FindConnection(connection_handle);
+	return info != nullptr ? info->security_level : 0;
+}
+
+void AttributeServer::SetAuthorizationGranted(uint16_t connection_handle, bool granted) {
+	ConnectionInfo* info = FindConnection(connection_handle);
+	if(info == nullptr) {
+		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: ignoring authorization update (unknown conn=0x%04x)\n",
+			static_cast<unsigned>(connection_handle));
+		return;
+	}
+	info->authorization_granted = granted;
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: authorization=%s (handle=0x%04x)\n",
+		granted ? "granted" : "denied",
+		static_cast<unsigned>(connection_handle));
+}
+
+bool AttributeServer::IsAuthorizationGranted(uint16_t connection_handle) const {
+	const ConnectionInfo* info = FindConnection(connection_handle);
+	return info != nullptr && info->authorization_granted;
+}
+
+void AttributeServer::SetBondStorage(FlashStorage* storage) {
+	bond_storage_ = storage;
+	if(storage == nullptr) {
+		for(auto& info: connections_) {
+			info.bond_index = -1;
+		}
+	}
+}
+
+void AttributeServer::SetClientBond(uint16_t connection_handle, int bond_index, bool restore) {
+	ConnectionInfo* info = FindConnection(connection_handle);
+	if(info == nullptr || bond_storage_ == nullptr || bond_index < 0) {
+		return;
+	}
+	info->bond_index = bond_index;
+	if(!restore) {
+		// A new bond has seen the database this connection discovered.
+		info->bond_hash = info->change_aware ? database_hash_ : DatabaseHash::Value{};
+		StoreClientBond(*info);
+		return;
+	}
+	uint8_t record[kBondStateSize]{};
+	info->bond_hash = DatabaseHash::Value{};
+	if(bond_storage_->Get(kBondStateTag + static_cast<uint32_t>(bond_index), record, sizeof(record)) ==
+	   sizeof(record)) {
+		std::copy_n(record, DatabaseHash::kSize, info->bond_hash.begin());
+		info->client_features |= static_cast<uint8_t>(record[DatabaseHash::kSize] & kClientFeatureMask);
+	}
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: bond %d restored (handle=0x%04x features=0x%02x)\n",
+		bond_index,
+		static_cast<unsigned>(connection_handle),
+		static_cast<unsigned>(info->client_features));
+	if(info->bond_hash != database_hash_) {
+		// The database changed since the bond last saw it (Core Vol 3, Part G, 2.5.2.1).
+		(void)MarkClientChangeUnaware(connection_handle);
+	}
+}
+
+void AttributeServer::StoreClientBond(const ConnectionInfo& info) {
+	if(bond_storage_ == nullptr || info.bond_index < 0) {
+		return;
+	}
+	uint8_t record[kBondStateSize];
+	std::copy(info.bond_hash.begin(), info.bond_hash.end(), record);
+	record[DatabaseHash::kSize] = info.client_features;
+	if(!bond_storage_->Store(kBondStateTag + static_cast<uint32_t>(info.bond_index), record, sizeof(record))) {
+		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: storing bond %d state failed\n", info.bond_index);
+	}
+}
+
+AttributeServer::ConnectionInfo* AttributeServer::FindConnection(uint16_t connection_handle) {
+	const auto* found = static_cast<const AttributeServer*>(this)->FindConnection(connection_handle);
+	return const_cast<ConnectionInfo*>(found);
+}
+
+const AttributeServer::ConnectionInfo* AttributeServer::FindConnection(uint16_t connection_handle) const {
+	if(connection_handle == 0) {
+		return nullptr;
+	}
+	for(const auto& info: connections_) {
+		if(info.handle == connection_handle) {
+			return &info;
+		}
+	}
+	return nullptr;
+}
+
+void AttributeServer::BeginRequest(uint16_t connection_handle) {
+	request_connection_handle_ = connection_handle;
+	if(connection_handle != 0 && FindConnection(connection_handle) == nullptr) {
+		// Request before ATT_EVENT_CONNECTED (or a platform without it)
+		(void)AddConnection(connection_handle);
+	}
+}
+
+uint8_t AttributeServer::GetClientSupportedFeatures(uint16_t connection_handle) const {
+	const ConnectionInfo* info = FindConnection(connection_handle);
+	return info != nullptr ? info->client_features : 0;
+}
+
+void AttributeServer::SetClientSupportedFeatures(uint16_t connection_handle, uint8_t features) {
+	ConnectionInfo* info = FindConnection(connection_handle);
+	if(info == nullptr) {
+		return;
+	}
+	info->client_features = static_cast<uint8_t>(features & kClientFeatureMask);
+}
+
+bool AttributeServer::IsClientChangeAware(uint16_t connection_handle) const {
+	const ConnectionInfo* info = FindConnection(connection_handle);
+	return info != nullptr && info->change_aware;
+}
+
+BleError AttributeServer::MarkClientChangeUnaware(uint16_t connection_handle) {
+	ConnectionInfo* info = FindConnection(connection_handle);
+	if(info == nullptr) {
+		return BleError::kCommandDisallowed;
+	}
+	info->change_aware = false;
+	info->out_of_sync_reported = false;
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: client change-unaware (handle=0x%04x)\n",
+		static_cast<unsigned>(connection_handle));
+	return IndicateServiceChanged(connection_handle);
+}
+
+BleError AttributeServer::IndicateServiceChanged(uint16_t connection_handle,
+												 uint16_t start_handle,
+												 uint16_t end_handle) {
+	Characteristic* characteristic = FindCharacteristicByHandle(service_changed_handle_);
+	if(characteristic == nullptr || FindConnection(connection_handle) == nullptr ||
+	   !characteristic->IsIndicationsEnabled(connection_handle)) {
+		return BleError::kCommandDisallowed;
+	}
+	// Affected handle range, little-endian (Core Vol 3, Part G, 7.1)
+	const uint8_t range[4] = {static_cast<uint8_t>(start_handle & 0xFF),
+							  static_cast<uint8_t>(start_handle >> 8),
+							  static_cast<uint8_t>(end_handle & 0xFF),
+							  static_cast<uint8_t>(end_handle >> 8)};
+	return QueueIndication(characteristic,
+						   connection_handle,
+						   range,
+						   sizeof(range),
+						   [this, connection_handle](BleError status, uint32_t) {
+							   ConnectionInfo* info = FindConnection(connection_handle);
+							   if(status == BleError::kSuccess && info != nullptr) {
+								   SetChangeAware(*info);
+							   }
+						   });
+}
+
+void AttributeServer::SetChangeAware(ConnectionInfo& info) {
+	if(!info.change_aware) {
+		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: client change-aware (handle=0x%04x)\n",
+			static_cast<unsigned>(info.handle));
+	}
+	info.change_aware = true;
+	info.out_of_sync_reported = false;
+	if(info.bond_index >= 0 && info.bond_hash != database_hash_) {
+		info.bond_hash = database_hash_;
+		StoreClientBond(info);
+	}
+}
+
+BleError AttributeServer::CheckDatabaseSync(uint16_t attribute_handle) {
+	ConnectionInfo* info = FindConnection(request_connection_handle_);
+	if(info == nullptr || info->change_aware) {
+		return BleError::kSuccess;
+	}
+	if(attribute_handle != 0 && attribute_handle == database_hash_handle_) {
+		// Reading the hash lets the client decide whether its cache is stale.
+		SetChangeAware(*info);
+		return BleError::kSuccess;
+	}
+	if((info->client_features & static_cast<uint8_t>(ClientFeature::kRobustCaching)) == 0) {
+		return BleError::kSuccess;
+	}
+	if(!info->out_of_sync_reported) {
+		info->out_of_sync_reported = true;
+		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: database out of sync (handle=0x%04x)\n",
+			static_cast<unsigned>(info->handle));
+		return BleError::kAttErrorDatabaseOutOfSync;
+	}
+	// A request after Database Out Of Sync acknowledges the change (Core Vol 3, Part G, 2.5.2.1).
+	SetChangeAware(*info);
+	return BleError::kSuccess;
+}
+
+AttributeServer::ReadResult AttributeServer::ReadClientSupportedFeatures(uint16_t offset,
+																		 uint8_t* buffer,
+																		 uint16_t buffer_size) const {
+	ReadResult result{};
+	const uint8_t features = GetClientSupportedFeatures(request_connection_handle_);
+	if(buffer == nullptr) {
+		result.bytes = sizeof(features);
+		return result;
+	}
+	if(offset >= sizeof(features) || buffer_size == 0) {
+		return result;
+	}
+	buffer[0] = features;
+	result.bytes = sizeof(features);
+	return result;
+}
+
+BleError AttributeServer::CheckClientSupportedFeaturesWrite(uint16_t offset,
+															const uint8_t* data,
+															uint16_t size) const {
+	const ConnectionInfo* info = FindConnection(request_connection_handle_);
+	if(info == nullptr) {
+		return BleError::kAttErrorWriteNotPermitted;
+	}
+	if(offset != 0) {
+		return BleError::kAttErrorInvalidOffset;
+	}
+	if(data == nullptr || size == 0) {
+		return BleError::kAttErrorInvalidAttrValueLength;
+	}
+	// Only the first octet defines features; later octets are reserved.
+	const auto features = static_cast<uint8_t>(data[0] & kClientFeatureMask);
+	if((info->client_features & ~features) != 0) {
+		// A client may not clear a feature it enabled (Core Vol 3, Part G, 7.2).
+		return BleError::kAttErrorValueNotAllowed;
+	}
+	return BleError::kSuccess;
+}
+
+BleError AttributeServer::WriteClientSupportedFeatures(uint16_t offset, const uint8_t* data, uint16_t size) {
+	const BleError status = CheckClientSupportedFeaturesWrite(offset, data, size);
+	if(status != BleError::kSuccess) {
+		return status;
+	}
+	ConnectionInfo* info = FindConnection(request_connection_handle_);
+	const auto features = static_cast<uint8_t>(data[0] & kClientFeatureMask);
+	info->client_features = features;
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: client features=0x%02x (handle=0x%04x)\n",
+		static_cast<unsigned>(features),
+		static_cast<unsigned>(info->handle));
+	StoreClientBond(*info);
+	return BleError::kSuccess;
+}
+
+uint32_t AttributeServer::GetTimeMs() {
+	return GetBleTimeMs();
+}
+
+void AttributeServer::SetPreferredMtu(uint16_t mtu) {
+	preferred_mtu_ = std::min(std::max(mtu, kDefaultAttMtu), GetMaxSupportedMtu());
+	ApplyPreferredMtu(preferred_mtu_);
+}
+
+uint16_t AttributeServer::GetMtu(uint16_t connection_handle) const {
+	const ConnectionInfo* info = FindConnection(connection_handle);
+	return info != nullptr ? info->mtu : kDefaultAttMtu;
+}
+
+BleError AttributeServer::DispatchBleHciPacket(uint8_t packet_type,
+											   const uint8_t* packet_data,
+											   uint16_t packet_data_size) {
+	const StackContextScope stack_scope(stack_context_id_, GetContextId());
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: HCI event packet=0x%02x size=%u\n",
+		static_cast<unsigned>(packet_type),
+		static_cast<unsigned>(packet_data_size));
+	const AttEvent event = DecodeAttEvent(packet_type, packet_data, packet_data_size);
+	switch(event.type) {
+	case AttEvent::Type::kIndicationComplete: {
+		Characteristic* characteristic = FindCharacteristicByHandle(event.attribute_handle);
+		if(characteristic == nullptr) {
+			C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: indication complete for unknown handle=0x%04x\n",
+				static_cast<unsigned>(event.attribute_handle));
+			return BleError::kSuccess;
+		}
+		const BleError status =
+			characteristic->DispatchBleHciPacket(packet_type, packet_data, packet_data_size);
+		CompleteIndication(event.connection_handle, event.attribute_handle, event.status);
+		return status;
+	}
+	case AttEvent::Type::kCanSendNow:
+		if(can_send_now_handle_ != 0 && event.connection_handle == can_send_now_handle_) {
+			can_send_now_handle_ = 0;
+			RunTxScheduler();
+		}
+		break;
+	case AttEvent::Type::kMtuExchangeComplete: {
+		if(FindConnection(event.connection_handle) == nullptr) {
+			(void)AddConnection(event.connection_handle);
+		}
+		ConnectionInfo* info = FindConnection(event.connection_handle);
+		if(info == nullptr) {
+			break;
+		}
+		info->mtu = std::max(event.mtu, kDefaultAttMtu);
+		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: ATT MTU=%u (handle=0x%04x)\n",
+			static_cast<unsigned>(info->mtu),
+			static_cast<unsigned>(event.connection_handle));
+		break;
+	}
+	case AttEvent::Type::kConnected:
+		(void)AddConnection(event.connection_handle);
+		break;
+	case AttEvent::Type::kDisconnected:
+		RemoveConnection(event.connection_handle);
+		break;
+	case AttEvent::Type::kNone:
+	default:
+		break;
+	}
+	return BleError::kSuccess;
+}
+
+void AttributeServer::RequestCanSendNow(Characteristic* characteristic, uint16_t connection_handle) {
+	if(characteristic == nullptr) {
+		return;
+	}
+	// Scheduler state belongs to the stack context; tasks hand the request over.
+	if(!IsStackContext()) {
+		characteristic->MarkStackSendRequested();
+		RequestStackWork();
+		return;
+	}
+	if(connections_.empty()) {
+		return;
+	}
+	if(FindCharacteristicByHandle(characteristic->GetValueHandle()) != characteristic) {
+		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: ignoring can-send-now request from foreign characteristic\n");
+		return;
+	}
+	const auto level = static_cast<size_t>(characteristic->GetTxPriority());
+	assert(level < kTxPriorityLevels && "Invalid TX priority");
+	pending_notifications_[level].push_back(characteristic);
+	// While the scheduler runs it picks up new entries itself.
+	if(tx_scheduler_running_) {
+		if(tx_busy_handle_ == 0) {
+			tx_busy_handle_ = connection_handle;
+		}
+		return;
+	}
+	RequestCanSendNowOnce(connection_handle);
+}
+
+void AttributeServer::RequestCanSendNowOnce(uint16_t connection_handle) {
+	if(can_send_now_handle_ != 0 || connections_.empty()) {
+		return;
+	}
+	if(FindConnection(connection_handle) == nullptr) {
+		connection_handle = connections_.front().handle;
+	}
+	can_send_now_handle_ = connection_handle;
+	RequestCanSendNowEvent(connection_handle);
+}
+
+void AttributeServer::RunTxScheduler() {
+	tx_scheduler_running_ = true;
+	tx_busy_handle_ = 0;
+	bool busy = false;
+	// Blocked indications are served before notifications.
+	for(size_t i = 0; i < indication_channels_.size() && !busy; ++i) {
+		if(!indication_channels_[i].blocked) {
+			continue;
+		}
+		const uint16_t connection = indication_channels_[i].connection_handle;
+		indication_channels_[i].blocked = false;
+		TrySendNextIndication(connection);
+		const IndicationChannel* channel = FindIndicationChannel(connection);
+		busy = channel != nullptr && channel->blocked;
+	}
+	while(!busy) {
+		// Highest non-empty priority class first.
+		std::vector<Characteristic*>* queue = nullptr;
+		for(size_t level = kTxPriorityLevels; level-- > 0;) {
+			if(!pending_notifications_[level].empty()) {
+				queue = &pending_notifications_[level];
+				break;
+			}
+		}
+		if(queue == nullptr) {
+			break;
+		}
+
+		Characteristic* characteristic = queue->front();
+		queue->erase(queue->begin());
+		// Re-queues itself at the back of its class if data is left.
+		busy = characteristic->FlushPendingUpdate() == BleError::kBtstackAclBuffersFull;
+		if(busy && !queue->empty() && queue->back() == characteristic) {
+			// Stack is busy; keep its turn for the next event.
+			queue->pop_back();
+			queue->insert(queue->begin(), characteristic);
+		}
+	}
+	tx_scheduler_running_ = false;
+
+	// An indication that blocked during the run also waits for the event.
+	if(busy || tx_busy_handle_ != 0) {
+		RequestCanSendNowOnce(tx_busy_handle_);
+	}
+}
+
+void AttributeServer::ClearPendingNotifications() {
+	for(auto& queue: pending_notifications_) {
+		queue.clear();
+	}
+	can_send_now_handle_ = 0;
+	FailPendingIndications(BleError::kAttHandleValueIndicationDisconnect);
+}
+
+void AttributeServer::SetIndicationQueueCapacity(size_t capacity) {
+	capacity = std::max<size_t>(capacity, 1);
+	// Re-pack each ring in order; entries beyond the new capacity fail.
+	std::vector<Characteristic::IndicationCallback> overflow;
+	for(auto& channel: indication_channels_) {
+		std::vector<PendingIndication> resized(capacity);
+		for(size_t i = 0; i < channel.count; ++i) {
+			PendingIndication& entry = channel.queue[(channel.head + i) % channel.queue.size()];
+			if(i < capacity) {
+				resized[i] = std::move(entry);
+			} else {
+				++indication_stats_.dropped;
+				overflow.push_back(std::move(entry.callback));
+			}
+		}
+		channel.queue = std::move(resized);
+		channel.head = 0;
+		channel.count = std::min(channel.count, capacity);
+	}
+	indication_capacity_ = capacity;
+	for(auto& callback: overflow) {
+		if(callback) {
+			callback(BleError::kMemoryCapacityExceeded, 0);
+		}
+	}
+}
+
+size_t AttributeServer::GetIndicationQueueSize() const {
+	size_t size = 0;
+	for(const auto& channel: indication_channels_) {
+		size += channel.count;
+	}
+	return size;
+}
+
+bool AttributeServer::IsIndicationInFlight() const {
+	return std::any_of(indication_channels_.begin(), indication_channels_.end(), [](const IndicationChannel& channel) {
+		return channel.in_flight_active;
+	});
+}
+
+AttributeServer::IndicationChannel* AttributeServer::FindIndicationChannel(uint16_t connection_handle) {
+	for(auto& channel: indication_channels_) {
+		if(channel.connection_handle == connection_handle) {
+			return &channel;
+		}
+	}
+	return nullptr;
+}
+
+BleError AttributeServer::QueueIndication(Characteristic* characteristic,
+										  uint16_t connection_handle,
+										  const uint8_t* data,
+										  uint16_t size,
+										  Characteristic::IndicationCallback callback) {
+	if(characteristic == nullptr || connection_handle == 0) {
+		return BleError::kCommandDisallowed;
+	}
+	// The rings belong to the stack context; tasks hand the indication over.
+	if(!IsStackContext()) {
+		auto hand_off = std::make_unique<IndicationHandOff>();
+		hand_off->connection_handle = connection_handle;
+		hand_off->indication.characteristic = characteristic;
+		hand_off->indication.value.assign(data, data + size);
+		hand_off->indication.callback = std::move(callback);
+		IndicationHandOff* node = hand_off.release();
+		node->next = indication_hand_offs_.load();
+		while(!indication_hand_offs_.compare_exchange_weak(node->next, node)) {
+		}
+		RequestStackWork();
+		return BleError::kSuccess;
+	}
+	BleError status = BleError::kSuccess;
+	IndicationChannel* channel = ReserveIndication(characteristic, connection_handle, status);
+	if(channel == nullptr) {
+		return status;
+	}
+	PendingIndication& entry = channel->queue[(channel->head + channel->count) % channel->queue.size()];
+	entry.characteristic = characteristic;
+	entry.value.assign(data, data + size);
+	entry.callback = std::move(callback);
+	++channel->count;
+	TrySendNextIndication(connection_handle);
+	return BleError::kSuccess;
+}
+
+AttributeServer::IndicationChannel* AttributeServer::ReserveIndication(Characteristic* characteristic,
+																	   uint16_t connection_handle,
+																	   BleError& status) {
+	IndicationChannel* channel = FindIndicationChannel(connection_handle);
+	if(channel == nullptr) {
+		status = BleError::kCommandDisallowed;
+		return nullptr;
+	}
+	if(channel->queue.size() != indication_capacity_) {
+		channel->queue.resize(indication_capacity_);
+	}
+	if(channel->count == indication_capacity_) {
+		++indication_stats_.dropped;
+		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: indication queue full, handle=0x%04x conn=0x%04x dropped\n",
+			static_cast<unsigned>(characteristic->GetValueHandle()),
+			static_cast<unsigned>(connection_handle));
+		status = BleError::kMemoryCapacityExceeded;
+		return nullptr;
+	}
+	return channel;
+}
+
+void AttributeServer::ProcessIndicationHandOffs() {
+	// Reverse the pushed list to queue in submission order.
+	IndicationHandOff* node = indication_hand_offs_.exchange(nullptr);
+	IndicationHandOff* ordered = nullptr;
+	while(node != nullptr) {
+		IndicationHandOff* next = node->next;
+		node->next = ordered;
+		ordered = node;
+		node = next;
+	}
+	while(ordered != nullptr) {
+		std::unique_ptr<IndicationHandOff> hand_off(ordered);
+		ordered = ordered->next;
+		PendingIndication& pending = hand_off->indication;
+		BleError status = BleError::kSuccess;
+		IndicationChannel* channel = ReserveIndication(pending.characteristic, hand_off->connection_handle, status);
+		if(channel == nullptr) {
+			if(pending.callback) {
+				pending.callback(status, 0);
+			}
+			continue;
+		}
+		PendingIndication& entry = channel->queue[(channel->head + channel->count) % channel->queue.size()];
+		entry.characteristic = pending.characteristic;
+		entry.value.assign(pending.value.begin(), pending.value.end());
+		entry.callback = std::move(pending.callback);
+		++channel->count;
+		TrySendNextIndication(hand_off->connection_handle);
+	}
 }
 
-const Service& AttributeServer::GetService(size_t index) const {
-	assert(index < services_.size() && "Service index out of range");
-	auto it = services_.begin();
-	std::advance(it, static_cast<long>(index));
-	return *it;
-}
+void AttributeServer::TrySendNextIndication(uint16_t connection_handle) {
+	IndicationChannel* channel = FindIndicationChannel(connection_handle);
+	while(channel != nullptr && !channel->in_flight_active && !channel->blocked && channel->count != 0) {
+		PendingIndication& next = channel->queue[channel->head];
+		const BleError status = next.characteristic->TransmitIndication(
+			connection_handle, next.value.data(), static_cast<uint16_t>(next.value.size()));
+		if(status == BleError::kBtstackAclBuffersFull) {
+			channel->blocked = true;
+			if(tx_scheduler_running_) {
+				if(tx_busy_handle_ == 0) {
+					tx_busy_handle_ = connection_handle;
+				}
+			} else {
+				RequestCanSendNowOnce(connection_handle);
+			}
+			return;
+		}
 
-Service* AttributeServer::FindServiceByUuid(const Uuid& uuid) {
-	auto it = std::find_if(services_.begin(), services_.end(),
-		[&uuid](const Service& service) { return service.GetUuid() == uuid; });
-	return it != services_.end() ? &(*it) : nullptr;
+		// Swap so both ring slot and in-flight slot keep their buffers.
+		std::swap(channel->in_flight, next);
+		channel->head = (channel->head + 1) % channel->queue.size();
+		--channel->count;
+		if(status == BleError::kSuccess) {
+			++indication_stats_.sent;
+			channel->in_flight_active = true;
+			channel->sent_ms = GetTimeMs();
+			return;
+		}
+
+		++indication_stats_.failed;
+		auto callback = std::move(channel->in_flight.callback);
+		channel->in_flight.callback = nullptr;
+		if(callback) {
+			callback(status, 0);
+		}
+		// The callback may have changed the connection set.
+		channel = FindIndicationChannel(connection_handle);
+	}
 }
 
-const Service* AttributeServer::FindServiceByUuid(const Uuid& uuid) const {
-	auto it = std::find_if(services_.begin(), services_.end(),
-		[&uuid](const Service& service) { return service.GetUuid() == uuid; });
-	return it != services_.end() ? &(*it) : nullptr;
+void AttributeServer::CompleteIndication(uint16_t connection_handle, uint16_t attribute_handle, BleError status) {
+	IndicationChannel* channel = FindIndicationChannel(connection_handle);
+	if(channel == nullptr || !channel->in_flight_active || channel->in_flight.characteristic == nullptr ||
+	   channel->in_flight.characteristic->GetValueHandle() != attribute_handle) {
+		return;
+	}
+	const uint32_t rtt_ms = GetTimeMs() - channel->sent_ms;
+	channel->in_flight_active = false;
+	if(status == BleError::kSuccess) {
+		IndicationStats& stats = indication_stats_;
+		stats.min_rtt_ms = stats.confirmed == 0 ? rtt_ms : std::min(stats.min_rtt_ms, rtt_ms);
+		stats.max_rtt_ms = std::max(stats.max_rtt_ms, rtt_ms);
+		stats.last_rtt_ms = rtt_ms;
+		stats.total_rtt_ms += rtt_ms;
+		++stats.confirmed;
+	} else {
+		++indication_stats_.failed;
+	}
+
+	auto callback = std::move(channel->in_flight.callback);
+	channel->in_flight.callback = nullptr;
+	if(callback) {
+		callback(status, rtt_ms);
+	}
+	TrySendNextIndication(connection_handle);
 }
 
-bool AttributeServer::HasServicesRequiringAuthentication() const {
-	for(const auto& service : services_) {
-		if(service.HasCharacteristicsRequiringAuthentication()) {
-			return true;
+void AttributeServer::FailPendingIndications(uint16_t connection_handle, BleError status) {
+	IndicationChannel* channel = FindIndicationChannel(connection_handle);
+	if(channel == nullptr) {
+		return;
+	}
+	// Detach callbacks first: they may queue new indications.
+	std::vector<Characteristic::IndicationCallback> callbacks;
+	if(channel->in_flight_active) {
+		callbacks.push_back(std::move(channel->in_flight.callback));
+		channel->in_flight.callback = nullptr;
+		channel->in_flight_active = false;
+	}
+	for(size_t i = 0; i < channel->count; ++i) {
+		PendingIndication& entry = channel->queue[(channel->head + i) % channel->queue.size()];
+		callbacks.push_back(std::move(entry.callback));
+		entry.callback = nullptr;
+	}
+	channel->head = 0;
+	channel->count = 0;
+	channel->blocked = false;
+	for(auto& callback: callbacks) {
+		++indication_stats_.failed;
+		if(callback) {
+			callback(status, 0);
 		}
 	}
-	return false;
 }
 
-bool AttributeServer::HasServicesRequiringEncryption() const {
-	for(const auto& service : services_) {
-		if(service.HasCharacteristicsRequiringEncryption()) {
-			return true;
-		}
+void AttributeServer::FailPendingIndications(BleError status) {
+	std::vector<uint16_t> handles;
+	handles.reserve(indication_channels_.size());
+	for(const auto& channel: indication_channels_) {
+		handles.push_back(channel.connection_handle);
+	}
+	for(const uint16_t handle: handles) {
+		FailPendingIndications(handle, status);
 	}
-	return false;
 }
 
-bool AttributeServer::HasServicesRequiringAuthorization() const {
-	for(const auto& service : services_) {
-		if(service.HasCharacteristicsRequiringAuthorization()) {
-			return true;
-		}
+void AttributeServer::ScheduleDeferredUpdate(Characteristic* characteristic, uint32_t due_ms) {
+	if(characteristic == nullptr || connections_.empty()) {
+		return;
+	}
+	deferred_updates_.push_back(DeferredUpdate{characteristic, due_ms});
+	if(!update_timer_armed_ || static_cast<int32_t>(due_ms - update_timer_due_ms_) < 0) {
+		const auto delay = static_cast<int32_t>(due_ms - GetTimeMs());
+		update_timer_due_ms_ = due_ms;
+		update_timer_armed_ = true;
+		ArmUpdateTimer(delay > 0 ? static_cast<uint32_t>(delay) : 0);
 	}
-	return false;
 }
 
-std::list<Characteristic*> AttributeServer::FindCharacteristicByUuid(const Uuid& uuid) {
-	std::list<Characteristic*> result;
-	for(auto& service: services_) {
-		auto* characteristic = service.FindCharacteristicByUuid(uuid);
-		if(characteristic != nullptr) {
-			result.push_back(characteristic);
+void AttributeServer::ProcessDeferredUpdates() {
+	const StackContextScope stack_scope(stack_context_id_, GetContextId());
+	update_timer_armed_ = false;
+	const uint32_t now = GetTimeMs();
+	size_t kept = 0;
+	bool have_next = false;
+	uint32_t next_due_ms = 0;
+	for(size_t i = 0; i < deferred_updates_.size(); ++i) {
+		const DeferredUpdate entry = deferred_updates_[i];
+		if(static_cast<int32_t>(now - entry.due_ms) >= 0) {
+			RequestCanSendNow(entry.characteristic);
+			continue;
+		}
+		if(!have_next || static_cast<int32_t>(entry.due_ms - next_due_ms) < 0) {
+			next_due_ms = entry.due_ms;
+			have_next = true;
 		}
+		deferred_updates_[kept++] = entry;
 	}
-	return result;
-}	
+	deferred_updates_.resize(kept);
+	if(have_next) {
+		update_timer_due_ms_ = next_due_ms;
+		update_timer_armed_ = true;
+		ArmUpdateTimer(next_due_ms - now);
+	}
+}
 
-std::list<const Characteristic*> AttributeServer::FindCharacteristicByUuid(const Uuid& uuid) const {
-	std::list<const Characteristic*> result;
-	for(const auto& service: services_) {
-		auto* characteristic = service.FindCharacteristicByUuid(uuid);
-		if(characteristic != nullptr) {
-			result.push_back(characteristic);
-		}
+void AttributeServer::ClearDeferredUpdates() {
+	deferred_updates_.clear();
+	if(update_timer_armed_) {
+		CancelUpdateTimer();
+		update_timer_armed_ = false;
 	}
-	return result;
 }
 
-Characteristic* AttributeServer::FindCharacteristicByHandle(uint16_t handle) {
-	for(auto& service: services_) {
-		for(const auto& characteristic : service.GetCharacteristics()) {
-			if(characteristic.HasHandle(handle)) {
-				return &const_cast<Characteristic&>(characteristic);
-			}
-		}
+BleError AttributeServer::CompleteDeferredRead(Characteristic* characteristic,
+											   BleError status,
+											   const uint8_t* data,
+											   size_t size) {
+	return StageDeferredResponse(characteristic, true, status, data, size);
+}
 
-	}
-	return nullptr;
+BleError AttributeServer::CompleteDeferredWrite(Characteristic* characteristic, BleError status) {
+	return StageDeferredResponse(characteristic, false, status, nullptr, 0);
 }
 
-const Characteristic* AttributeServer::FindCharacteristicByHandle(uint16_t handle) const {
-	for(const auto& service: services_) {
-		for(size_t i = 0; i < service.GetCharacteristicCount(); ++i) {
-			const auto& characteristic = service.GetCharacteristic(i);
-			if(characteristic.HasHandle(handle)) {
-				return &characteristic;
-			}
-		}
+BleError AttributeServer::StageDeferredResponse(Characteristic* characteristic,
+												bool is_read,
+												BleError status,
+												const uint8_t* data,
+												size_t size) {
+	// Application task: stage the result, the stack context applies it.
+	// Claiming first keeps the stack context from discarding or re-arming
+	// the operation while the result is written, and lets one task win.
+	DeferredResponse& pending = deferred_response_;
+	DeferredState expected = DeferredState::kWaiting;
+	if(characteristic == nullptr ||
+	   !deferred_state_.compare_exchange_strong(expected, DeferredState::kClaimed)) {
+		return BleError::kCommandDisallowed;
 	}
-	return nullptr;
+	if(pending.characteristic != characteristic || pending.is_read != is_read) {
+		deferred_state_.store(DeferredState::kWaiting);
+		return BleError::kCommandDisallowed;
+	}
+	pending.status = status;
+	if(is_read && status == BleError::kSuccess && data != nullptr) {
+		pending.value.assign(data, data + size);
+	} else {
+		pending.value.clear();
+	}
+	expected = DeferredState::kClaimed;
+	if(!deferred_state_.compare_exchange_strong(expected, DeferredState::kCompleting)) {
+		// Cancelled meanwhile (disconnect); hand the slot back and release waiters.
+		deferred_state_.store(DeferredState::kIdle);
+		RequestStackWork();
+		return BleError::kCommandDisallowed;
+	}
+	RequestStackWork();
+	return BleError::kSuccess;
 }
 
-void AttributeServer::SetConnectionHandle(uint16_t connection_handle) {
-	connection_handle_ = connection_handle;
-	security_level_ = 0;
-	authorization_granted_ = false;
-	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: connection set handle=0x%04x\n",
-		static_cast<unsigned>(connection_handle_));
-	for(auto& service: services_) {
-		service.SetConnectionHandle(connection_handle);
+void AttributeServer::RequestStackWork() {
+	if(!stack_work_scheduled_.exchange(true)) {
+		ScheduleStackWork();
 	}
 }
 
-void AttributeServer::SetDisconnected() {
-	connection_handle_ = 0;
-	security_level_ = 0;
-	authorization_granted_ = false;
-	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: disconnected\n");
+void AttributeServer::ProcessStackWork() {
+	// Clear first so requests made while this runs schedule another run.
+	stack_work_scheduled_.store(false);
+	const StackContextScope stack_scope(stack_context_id_, GetContextId());
+	ProcessDeferredResponse();
+	ProcessIndicationHandOffs();
+	if(deferred_state_.load() == DeferredState::kIdle) {
+		ReleaseDeferredWaiters();
+	}
 	for(auto& service: services_) {
-		service.SetConnectionHandle(0);
+		for(auto& characteristic: service.GetCharacteristics()) {
+			if(characteristic.TakeStackSendRequest()) {
+				RequestCanSendNow(&characteristic, 0);
+			}
+			IngestChannel* ingest = characteristic.GetIngestChannel();
+			if(ingest != nullptr && ingest->TakeReportDue()) {
+				characteristic.SendIngestCreditReport();
+			}
+		}
 	}
 }
 
-void AttributeServer::SetSecurityLevel(uint16_t connection_handle, uint8_t security_level) {
-	if(connection_handle_ == 0 || connection_handle_ != connection_handle) {
-		C7222_BLE_DEBUG_PRINT(
-			"[BLE] AttributeServer: ignoring security level update (conn=0x%04x current=0x%04x)\n",
-			static_cast<unsigned>(connection_handle),
-			static_cast<unsigned>(connection_handle_));
-		return;
+void AttributeServer::ProcessDeferredResponse() {
+	if(deferred_state_.load() != DeferredState::kCompleting) {
+		return;	 // cleared by a connection change meanwhile
 	}
-	security_level_ = security_level;
-	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: security level=%u (handle=0x%04x)\n",
-		static_cast<unsigned>(security_level_),
-		static_cast<unsigned>(connection_handle_));
+	DeferredResponse& pending = deferred_response_;
+	if(pending.is_read && pending.status == BleError::kSuccess &&
+	   !pending.characteristic->StoreDeferredReadValue(pending.connection_handle, pending.value.data(),
+														 pending.value.size())) {
+		pending.status = BleError::kAttErrorReadNotPermitted;
+	}
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: deferred %s ready handle=0x%04x status=%u\n",
+		pending.is_read ? "read" : "write",
+		static_cast<unsigned>(pending.attribute_handle),
+		static_cast<unsigned>(pending.status));
+	deferred_state_.store(DeferredState::kReady);
+	SignalResponseReady(pending.connection_handle);
 }
 
-uint8_t AttributeServer::GetSecurityLevel(uint16_t connection_handle) const {
-	if(connection_handle_ == 0 || connection_handle_ != connection_handle) {
-		return 0;
+void AttributeServer::ClearDeferredResponse() {
+	DeferredState state = deferred_state_.load();
+	DeferredState next = DeferredState::kIdle;
+	do {
+		// A task staging a result owns the slot until it sees the cancellation.
+		next = (state == DeferredState::kClaimed || state == DeferredState::kCancelled) ? DeferredState::kCancelled
+																						: DeferredState::kIdle;
+	} while(!deferred_state_.compare_exchange_weak(state, next));
+	if(next == DeferredState::kCancelled) {
+		return;
+	}
+	deferred_response_.characteristic = nullptr;
+	deferred_response_.attribute_handle = 0;
+	if(!deferred_waiters_.empty()) {
+		RequestStackWork();
 	}
-	return security_level_;
 }
 
-void AttributeServer::SetAuthorizationGranted(uint16_t connection_handle, bool granted) {
-	if(connection_handle_ == 0 || connection_handle_ != connection_handle) {
-		C7222_BLE_DEBUG_PRINT(
-			"[BLE] AttributeServer: ignoring authorization update (conn=0x%04x current=0x%04x)\n",
-			static_cast<unsigned>(connection_handle),
-			static_cast<unsigned>(connection_handle_));
-		return;
+void AttributeServer::AddDeferredWaiter(uint16_t connection_handle) {
+	if(std::find(deferred_waiters_.begin(), deferred_waiters_.end(), connection_handle) ==
+	   deferred_waiters_.end()) {
+		deferred_waiters_.push_back(connection_handle);
 	}
-	authorization_granted_ = granted;
-	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: authorization=%s (handle=0x%04x)\n",
-		granted ? "granted" : "denied",
-		static_cast<unsigned>(connection_handle_));
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: conn=0x%04x waits for deferred response of conn=0x%04x\n",
+		static_cast<unsigned>(connection_handle),
+		static_cast<unsigned>(deferred_response_.connection_handle));
 }
 
-bool AttributeServer::IsAuthorizationGranted(uint16_t connection_handle) const {
-	if(connection_handle_ == 0 || connection_handle_ != connection_handle) {
-		return false;
+void AttributeServer::ReleaseDeferredWaiters() {
+	// Replayed requests may park each other again.
+	std::vector<uint16_t> waiters;
+	waiters.swap(deferred_waiters_);
+	for(const uint16_t connection_handle: waiters) {
+		SignalResponseReady(connection_handle);
 	}
-	return authorization_granted_;
 }
 
-BleError AttributeServer::DispatchBleHciPacket(uint8_t packet_type,
-											   const uint8_t* packet_data,
-											   uint16_t packet_data_size) {
-	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: HCI event packet=0x%02x size=%u\n",
-		static_cast<unsigned>(packet_type),
-		static_cast<unsigned>(packet_data_size));
-	for(auto& service: services_) {
-		for(size_t i = 0; i < service.GetCharacteristicCount(); ++i) {
-			service.GetCharacteristic(i).DispatchBleHciPacket(packet_type,
-															 packet_data,
-															 packet_data_size);
+AttributeServer::ReadResult AttributeServer::ReadDeferred(Characteristic& characteristic,
+														  const Attribute& attribute,
+														  uint8_t* buffer,
+														  uint16_t buffer_size) {
+	ReadResult result{};
+	DeferredResponse& pending = deferred_response_;
+	const uint16_t handle = attribute.GetHandle();
+	DeferredState state = deferred_state_.load();
+	const bool replay = state != DeferredState::kIdle && pending.is_read &&
+						pending.connection_handle == request_connection_handle_ &&
+						pending.attribute_handle == handle;
+	if(state != DeferredState::kIdle && !replay && pending.connection_handle == request_connection_handle_) {
+		// The connection moved on to another request; drop the stale operation.
+		ClearDeferredResponse();
+		state = deferred_state_.load();
+	}
+	if(state != DeferredState::kIdle && !replay) {
+		// One outstanding operation at a time; replayed once it is answered
+		AddDeferredWaiter(request_connection_handle_);
+		result.pending = true;
+		return result;
+	}
+	if(replay) {
+		if(state != DeferredState::kReady) {
+			result.pending = true;
+			return result;
+		}
+		// Replayed request: answer from the completed value
+		if(pending.status != BleError::kSuccess) {
+			result.ok = false;
+			result.error = pending.status;
+			ClearDeferredResponse();
+			return result;
+		}
+		const size_t size = attribute.GetValueSize();
+		if(buffer == nullptr) {
+			result.bytes = static_cast<uint16_t>(size);
+			return result;
 		}
+		result.bytes = static_cast<uint16_t>(std::min<size_t>(size, buffer_size));
+		std::copy_n(attribute.GetValueData(), result.bytes, buffer);
+		ClearDeferredResponse();
+		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: deferred read bytes=%u\n",
+			static_cast<unsigned>(result.bytes));
+		return result;
 	}
-	return BleError::kSuccess;
+
+	// New read. Waiting before the OnRead handlers run, so they may complete it right away.
+	pending.characteristic = &characteristic;
+	pending.connection_handle = request_connection_handle_;
+	pending.attribute_handle = handle;
+	pending.is_read = true;
+	pending.status = BleError::kSuccess;
+	deferred_state_.store(DeferredState::kWaiting);
+	const uint16_t probe = characteristic.DispatchAttributeRead(
+		Characteristic::AttributeRole::kValue, attribute, 0, nullptr, 0);
+	BleError att_error = BleError::kSuccess;
+	if(IsAttErrorCode(probe, att_error)) {
+		ClearDeferredResponse();
+		result.ok = false;
+		result.error = att_error;
+		return result;
+	}
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: read deferred handle=0x%04x\n",
+		static_cast<unsigned>(handle));
+	result.pending = true;
+	return result;
 }
 
-AttributeServer::ReadResult AttributeServer::ReadAttribute(uint16_t attribute_handle,
+AttributeServer::ReadResult AttributeServer::ReadAttribute(uint16_t connection_handle,
+														   uint16_t attribute_handle,
 														   uint16_t offset,
 														   uint8_t* buffer,
 														   uint16_t buffer_size) {
-	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: read handle=0x%04x offset=%u max=%u\n",
+	const StackContextScope stack_scope(stack_context_id_, GetContextId());
+	BeginRequest(connection_handle);
+	const RequestConnectionScope request_scope(request_connection_handle_);
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: read conn=0x%04x handle=0x%04x offset=%u max=%u\n",
+		static_cast<unsigned>(connection_handle),
 		static_cast<unsigned>(attribute_handle),
 		static_cast<unsigned>(offset),
 		static_cast<unsigned>(buffer_size));
 	ReadResult result{};
 
-	const Attribute* attribute = FindAttributeByHandle(attribute_handle);
-	if(attribute == nullptr) {
+	const BleError sync = CheckDatabaseSync(attribute_handle);
+	if(sync != BleError::kSuccess) {
+		result.ok = false;
+		result.error = sync;
+		return result;
+	}
+
+	const HandleEntry* entry = FindHandleEntry(attribute_handle);
+	if(entry == nullptr) {
 		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: read rejected (not found)\n");
 		result.ok = false;
 		result.error = BleError::kAttErrorReadNotPermitted;
 		return result;
 	}
 
-	const bool read_permitted =
-		(attribute->GetProperties() & static_cast<uint16_t>(Attribute::Properties::kRead)) != 0;
-	if(!read_permitted) {
+	if(!entry->readable) {
 		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: read rejected (not permitted)\n");
 		result.ok = false;
 		result.error = BleError::kAttErrorReadNotPermitted;
 		return result;
 	}
+	if(attribute_handle == client_features_handle_) {
+		return ReadClientSupportedFeatures(offset, buffer, buffer_size);
+	}
+
+	const Attribute* attribute = entry->attribute;
+	const bool is_value = entry->role == Characteristic::AttributeRole::kValue;
+	if(is_value && offset == 0 && entry->characteristic->IsReadDeferred()) {
+		// A fresh cached snapshot is served without deferring
+		const bool outstanding = deferred_state_.load() != DeferredState::kIdle &&
+								 deferred_response_.is_read &&
+								 deferred_response_.connection_handle == connection_handle &&
+								 deferred_response_.attribute_handle == attribute_handle;
+		if(outstanding || !entry->characteristic->IsReadCacheFresh()) {
+			return ReadDeferred(*entry->characteristic, *attribute, buffer, buffer_size);
+		}
+	}
 
 	if(buffer == nullptr) {
+		const size_t size =
+			is_value ? entry->characteristic->GetReadValueSize() : attribute->GetValueSize();
 		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: read size query bytes=%u\n",
-			static_cast<unsigned>(attribute->GetValueSize()));
-		result.bytes = static_cast<uint16_t>(attribute->GetValueSize());
+			static_cast<unsigned>(size));
+		result.bytes = static_cast<uint16_t>(size);
 		return result;
 	}
 
-	if(auto* characteristic = FindCharacteristicByHandle(attribute_handle)) {
+	if(auto* characteristic = entry->characteristic) {
 		const uint16_t bytes =
-			characteristic->HandleAttributeRead(attribute_handle, offset, buffer, buffer_size);
+			characteristic->DispatchAttributeRead(entry->role, *attribute, offset, buffer, buffer_size);
 		BleError att_error = BleError::kSuccess;
 		if(IsAttErrorCode(bytes, att_error)) {
 			C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: read error=%u\n",
@@ -259,40 +1531,99 @@ AttributeServer::ReadResult AttributeServer::ReadAttribute(uint16_t attribute_ha
 	return result;
 }
 
-BleError AttributeServer::WriteAttribute(uint16_t attribute_handle,
+BleError AttributeServer::WriteAttribute(uint16_t connection_handle,
+										 uint16_t attribute_handle,
 										 uint16_t offset,
 										 const uint8_t* data,
 										 uint16_t size) {
-	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: write handle=0x%04x offset=%u size=%u\n",
+	const StackContextScope stack_scope(stack_context_id_, GetContextId());
+	BeginRequest(connection_handle);
+	const RequestConnectionScope request_scope(request_connection_handle_);
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: write conn=0x%04x handle=0x%04x offset=%u size=%u\n",
+		static_cast<unsigned>(connection_handle),
 		static_cast<unsigned>(attribute_handle),
 		static_cast<unsigned>(offset),
 		static_cast<unsigned>(size));
-	if(auto* characteristic = FindCharacteristicByHandle(attribute_handle)) {
-		const BleError result =
-			characteristic->HandleAttributeWrite(attribute_handle, offset, data, size);
-		if(result != BleError::kSuccess) {
-			C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: write error=%u\n",
-				static_cast<unsigned>(result));
+	const BleError sync = CheckDatabaseSync(attribute_handle);
+	if(sync != BleError::kSuccess) {
+		return sync;
+	}
+	const HandleEntry* entry = FindHandleEntry(attribute_handle);
+	if(entry == nullptr) {
+		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: write rejected (not found)\n");
+		return BleError::kAttErrorWriteNotPermitted;
+	}
+
+	Characteristic* characteristic = entry->characteristic;
+	const bool deferred = characteristic != nullptr &&
+						  entry->role == Characteristic::AttributeRole::kValue &&
+						  characteristic->IsWriteDeferred();
+	if(deferred) {
+		DeferredState state = deferred_state_.load();
+		const bool replay = state != DeferredState::kIdle && !deferred_response_.is_read &&
+							deferred_response_.connection_handle == connection_handle &&
+							deferred_response_.attribute_handle == attribute_handle;
+		if(state != DeferredState::kIdle && !replay && deferred_response_.connection_handle == connection_handle) {
+			// The connection moved on to another request; drop the stale operation.
+			ClearDeferredResponse();
+			state = deferred_state_.load();
+		}
+		if(state != DeferredState::kIdle && !replay) {
+			// One outstanding operation at a time; replayed once it is answered
+			AddDeferredWaiter(connection_handle);
+			return BleError::kAttResponsePending;
 		}
+		if(replay) {
+			if(state != DeferredState::kReady) {
+				return BleError::kAttResponsePending;
+			}
+			// Replayed request: the write was applied already
+			const BleError status = deferred_response_.status;
+			ClearDeferredResponse();
+			return status;
+		}
+		// Waiting before the OnWrite handlers run, so they may complete it right away.
+		deferred_response_.characteristic = characteristic;
+		deferred_response_.connection_handle = connection_handle;
+		deferred_response_.attribute_handle = attribute_handle;
+		deferred_response_.is_read = false;
+		deferred_response_.status = BleError::kSuccess;
+		deferred_state_.store(DeferredState::kWaiting);
+	}
+
+	const BleError result = DispatchWrite(attribute_handle, offset, data, size);
+	if(!deferred) {
 		return result;
 	}
+	if(result != BleError::kSuccess) {
+		ClearDeferredResponse();
+		return result;
+	}
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: write deferred handle=0x%04x\n",
+		static_cast<unsigned>(attribute_handle));
+	return BleError::kAttResponsePending;
+}
 
-	Attribute* attribute = FindServiceAttributeByHandle(attribute_handle);
-	if(attribute == nullptr) {
-		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: write rejected (not found)\n");
+BleError AttributeServer::DispatchWrite(uint16_t attribute_handle,
+										uint16_t offset,
+										const uint8_t* data,
+										uint16_t size) {
+	const HandleEntry* entry = FindHandleEntry(attribute_handle);
+	if(entry == nullptr) {
 		return BleError::kAttErrorWriteNotPermitted;
 	}
-
-	const bool write_permitted =
-		(attribute->GetProperties() & static_cast<uint16_t>(Attribute::Properties::kWrite)) != 0 ||
-		(attribute->GetProperties() &
-		 static_cast<uint16_t>(Attribute::Properties::kWriteWithoutResponse)) != 0;
-	if(!write_permitted) {
+	if(attribute_handle == client_features_handle_ && entry->writable) {
+		return WriteClientSupportedFeatures(offset, data, size);
+	}
+	BleError result = BleError::kSuccess;
+	if(auto* characteristic = entry->characteristic) {
+		result = characteristic->DispatchAttributeWrite(entry->role, *entry->attribute, offset, data, size);
+	} else if(!entry->writable) {
 		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: write rejected (not permitted)\n");
 		return BleError::kAttErrorWriteNotPermitted;
+	} else {
+		result = entry->attribute->InvokeWriteCallback(offset, data, size);
 	}
-
-	const BleError result = attribute->InvokeWriteCallback(offset, data, size);
 	if(result != BleError::kSuccess) {
 		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: write error=%u\n",
 			static_cast<unsigned>(result));
@@ -300,110 +1631,243 @@ BleError AttributeServer::WriteAttribute(uint16_t attribute_handle,
 	return result;
 }
 
-Attribute* AttributeServer::FindServiceAttributeByHandle(uint16_t handle) {
-	for(auto& service: services_) {
-		if(auto* attribute = service.FindServiceAttributeByHandle(handle)) {
-			return attribute;
+void AttributeServer::SetPreparedWriteLimits(size_t connection_bytes, size_t connection_chunks) {
+	CancelAllPreparedWrites();
+	// Chunk positions in the pool are 16-bit
+	prepared_connection_bytes_ = std::min<size_t>(connection_bytes, UINT16_MAX / kMaxConnections);
+	prepared_connection_chunks_ = std::min<size_t>(connection_chunks, UINT16_MAX);
+	// Reallocated on next use
+	std::vector<uint8_t>().swap(prepared_pool_);
+	std::vector<PreparedWrite>().swap(prepared_writes_);
+}
+
+BleError AttributeServer::PrepareWrite(uint16_t connection_handle,
+									   uint16_t attribute_handle,
+									   uint16_t offset,
+									   const uint8_t* data,
+									   uint16_t size) {
+	const StackContextScope stack_scope(stack_context_id_, GetContextId());
+	BeginRequest(connection_handle);
+	const RequestConnectionScope request_scope(request_connection_handle_);
+	C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: prepare write conn=0x%04x handle=0x%04x offset=%u size=%u\n",
+		static_cast<unsigned>(connection_handle),
+		static_cast<unsigned>(attribute_handle),
+		static_cast<unsigned>(offset),
+		static_cast<unsigned>(size));
+	const BleError sync = CheckDatabaseSync(attribute_handle);
+	if(sync != BleError::kSuccess) {
+		return sync;
+	}
+	const HandleEntry* entry = FindHandleEntry(attribute_handle);
+	if(entry == nullptr || !entry->writable ||
+	   (entry->attribute->GetProperties() & static_cast<uint16_t>(Attribute::Properties::kDynamic)) == 0 ||
+	   (entry->role == Characteristic::AttributeRole::kValue && entry->characteristic->GetIngestChannel() != nullptr)) {
+		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: prepare write rejected (not permitted)\n");
+		return BleError::kAttErrorWriteNotPermitted;
+	}
+	const BleError access = CheckWriteAccess(*entry);
+	if(access != BleError::kSuccess) {
+		return access;
+	}
+	if(data == nullptr && size != 0) {
+		return BleError::kAttErrorInvalidAttrValueLength;
+	}
+	ConnectionInfo* info = FindConnection(connection_handle);
+	if(info == nullptr) {
+		return BleError::kAttErrorPrepareQueueFull;	 // not served (connection limit)
+	}
+	const size_t pool_size = kMaxConnections * prepared_connection_bytes_;
+	if(prepared_pool_.size() != pool_size) {
+		prepared_pool_.resize(pool_size);
+		prepared_writes_.reserve(kMaxConnections * prepared_connection_chunks_);
+	}
+	// Each connection stays within its own budget, so the pool always has room for it
+	if(info->prepared_chunks >= prepared_connection_chunks_ ||
+	   prepared_connection_bytes_ - info->prepared_bytes < size) {
+		C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: prepare queue full conn=0x%04x (%u bytes, %u chunks)\n",
+			static_cast<unsigned>(connection_handle),
+			static_cast<unsigned>(info->prepared_bytes),
+			static_cast<unsigned>(info->prepared_chunks));
+		return BleError::kAttErrorPrepareQueueFull;
+	}
+	std::copy_n(data, size, prepared_pool_.begin() + static_cast<std::ptrdiff_t>(prepared_pool_used_));
+	prepared_writes_.push_back(PreparedWrite{
+		connection_handle, attribute_handle, offset, size, static_cast<uint16_t>(prepared_pool_used_)});
+	prepared_pool_used_ += size;
+	info->prepared_bytes = static_cast<uint16_t>(info->prepared_bytes + size);
+	++info->prepared_chunks;
+	return BleError::kSuccess;
+}
+
+BleError AttributeServer::AssemblePreparedValue(uint16_t connection_handle,
+												uint16_t attribute_handle,
+												std::vector<uint8_t>* out) const {
+	const HandleEntry* entry = FindHandleEntry(attribute_handle);
+	if(entry == nullptr) {
+		return BleError::kAttErrorWriteNotPermitted;
+	}
+	size_t length = entry->attribute->GetValueSize();
+	if(out != nullptr) {
+		const uint8_t* current = entry->attribute->GetValueData();
+		out->assign(current, current + (current != nullptr ? length : 0));
+	}
+	for(const auto& chunk: prepared_writes_) {
+		if(chunk.connection_handle != connection_handle || chunk.attribute_handle != attribute_handle) {
+			continue;
+		}
+		if(chunk.offset > length) {
+			return BleError::kAttErrorInvalidOffset;
+		}
+		length = static_cast<size_t>(chunk.offset) + chunk.size;
+		if(length > kMaxAttributeValueSize) {
+			return BleError::kAttErrorInvalidAttrValueLength;
+		}
+		if(out != nullptr) {
+			const uint8_t* chunk_data = prepared_pool_.data() + chunk.pool_offset;
+			out->resize(chunk.offset);
+			out->insert(out->end(), chunk_data, chunk_data + chunk.size);
 		}
 	}
-	return nullptr;
+	return BleError::kSuccess;
 }
 
-const Attribute* AttributeServer::FindServiceAttributeByHandle(uint16_t handle) const {
-	for(const auto& service: services_) {
-		if(auto* attribute = service.FindServiceAttributeByHandle(handle)) {
-			return attribute;
+BleError AttributeServer::CheckWriteAccess(const HandleEntry& entry) const {
+	if(!entry.writable) {
+		return BleError::kAttErrorWriteNotPermitted;
+	}
+	if(entry.characteristic != nullptr) {
+		return entry.characteristic->CheckAttributeWriteAccess(entry.role, *entry.attribute);
+	}
+	return BleError::kSuccess;
+}
+
+BleError AttributeServer::CheckPreparedWrites(uint16_t connection_handle) {
+	for(size_t i = 0; i < prepared_writes_.size(); ++i) {
+		if(prepared_writes_[i].connection_handle != connection_handle) {
+			continue;
+		}
+		const uint16_t handle = prepared_writes_[i].attribute_handle;
+		bool seen = false;
+		for(size_t j = 0; j < i && !seen; ++j) {
+			seen = prepared_writes_[j].connection_handle == connection_handle &&
+				   prepared_writes_[j].attribute_handle == handle;
+		}
+		if(seen) {
+			continue;
+		}
+		const HandleEntry* entry = FindHandleEntry(handle);
+		BleError status = entry != nullptr ? CheckWriteAccess(*entry) : BleError::kAttErrorWriteNotPermitted;
+		if(status == BleError::kSuccess) {
+			status = AssemblePreparedValue(connection_handle, handle, &prepared_value_);
+		}
+		const auto size = static_cast<uint16_t>(prepared_value_.size());
+		if(status == BleError::kSuccess && handle == client_features_handle_) {
+			status = CheckClientSupportedFeaturesWrite(0, prepared_value_.data(), size);
+		} else if(status == BleError::kSuccess && entry->characteristic != nullptr) {
+			status = entry->characteristic->CheckAttributeWriteValue(entry->role, *entry->attribute, size);
+		}
+		if(status != BleError::kSuccess) {
+			C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: prepared write invalid handle=0x%04x error=%u\n",
+				static_cast<unsigned>(handle),
+				static_cast<unsigned>(status));
+			return status;
 		}
 	}
-	return nullptr;
+	return BleError::kSuccess;
 }
 
-Attribute* AttributeServer::FindAttributeByHandle(uint16_t handle) {
-	for(auto& service: services_) {
-		if(auto* attribute = service.FindServiceAttributeByHandle(handle)) {
-			return attribute;
+BleError AttributeServer::ValidatePreparedWrites(uint16_t connection_handle) {
+	BeginRequest(connection_handle);
+	const RequestConnectionScope request_scope(request_connection_handle_);
+	return CheckPreparedWrites(connection_handle);
+}
+
+BleError AttributeServer::ExecutePreparedWrites(uint16_t connection_handle) {
+	const StackContextScope stack_scope(stack_context_id_, GetContextId());
+	BeginRequest(connection_handle);
+	const RequestConnectionScope request_scope(request_connection_handle_);
+	// Everything that can fail is checked up front: the stack does not
+	// report the commit result, so a partial commit would go unnoticed.
+	BleError result = CheckPreparedWrites(connection_handle);
+	// Attributes are committed in order of their first chunk
+	for(size_t i = 0; i < prepared_writes_.size() && result == BleError::kSuccess; ++i) {
+		if(prepared_writes_[i].connection_handle != connection_handle) {
+			continue;
 		}
-		for(size_t i = 0; i < service.GetCharacteristicCount(); ++i) {
-			auto& characteristic = service.GetCharacteristic(i);
-			if(characteristic.GetDeclarationHandle() == handle) {
-				return &characteristic.GetDeclarationAttribute();
-			}
-			if(characteristic.GetValueHandle() == handle) {
-				return &characteristic.GetValueAttribute();
-			}
-			if(auto* cccd = characteristic.GetCCCD()) {
-				if(cccd->GetHandle() == handle) {
-					return cccd;
-				}
-			}
-			if(auto* sccd = characteristic.GetSCCD()) {
-				if(sccd->GetHandle() == handle) {
-					return sccd;
-				}
-			}
-			if(auto* extended = characteristic.GetExtendedProperties()) {
-				if(extended->GetHandle() == handle) {
-					return extended;
-				}
-			}
-			if(auto* user_desc = characteristic.GetUserDescription()) {
-				if(user_desc->GetHandle() == handle) {
-					return user_desc;
-				}
-			}
-			for(size_t j = 0; j < characteristic.GetDescriptorCount(); ++j) {
-				Attribute* descriptor = characteristic.GetDescriptor(j);
-				if(descriptor && descriptor->GetHandle() == handle) {
-					return descriptor;
-				}
-			}
+		const uint16_t handle = prepared_writes_[i].attribute_handle;
+		bool seen = false;
+		for(size_t j = 0; j < i && !seen; ++j) {
+			seen = prepared_writes_[j].connection_handle == connection_handle &&
+				   prepared_writes_[j].attribute_handle == handle;
+		}
+		if(seen) {
+			continue;
+		}
+		result = AssemblePreparedValue(connection_handle, handle, &prepared_value_);
+		if(result == BleError::kSuccess) {
+			C7222_BLE_DEBUG_PRINT("[BLE] AttributeServer: execute write handle=0x%04x size=%u\n",
+				static_cast<unsigned>(handle),
+				static_cast<unsigned>(prepared_value_.size()));
+			result = DispatchWrite(handle, 0, prepared_value_.data(),
+								   static_cast<uint16_t>(prepared_value_.size()));
 		}
 	}
-	return nullptr;
+	CancelPreparedWrites(connection_handle);
+	return result;
 }
 
-const Attribute* AttributeServer::FindAttributeByHandle(uint16_t handle) const {
-	for(const auto& service: services_) {
-		if(auto* attribute = service.FindServiceAttributeByHandle(handle)) {
-			return attribute;
+void AttributeServer::CancelPreparedWrites(uint16_t connection_handle) {
+	// Compact the pool: the other connections' chunks move down in arrival order.
+	size_t kept = 0;
+	size_t pool_used = 0;
+	for(size_t i = 0; i < prepared_writes_.size(); ++i) {
+		PreparedWrite chunk = prepared_writes_[i];
+		if(chunk.connection_handle == connection_handle) {
+			continue;
 		}
-		for(size_t i = 0; i < service.GetCharacteristicCount(); ++i) {
-			const auto& characteristic = service.GetCharacteristic(i);
-			if(characteristic.GetDeclarationHandle() == handle) {
-				return &characteristic.GetDeclarationAttribute();
-			}
-			if(characteristic.GetValueHandle() == handle) {
-				return &characteristic.GetValueAttribute();
-			}
-			if(auto* cccd = characteristic.GetCCCD()) {
-				if(cccd->GetHandle() == handle) {
-					return cccd;
-				}
-			}
-			if(auto* sccd = characteristic.GetSCCD()) {
-				if(sccd->GetHandle() == handle) {
-					return sccd;
-				}
-			}
-			if(auto* extended = characteristic.GetExtendedProperties()) {
-				if(extended->GetHandle() == handle) {
-					return extended;
-				}
-			}
-			if(auto* user_desc = characteristic.GetUserDescription()) {
-				if(user_desc->GetHandle() == handle) {
-					return user_desc;
-				}
-			}
-			for(size_t j = 0; j < characteristic.GetDescriptorCount(); ++j) {
-				const Attribute* descriptor = characteristic.GetDescriptor(j);
-				if(descriptor && descriptor->GetHandle() == handle) {
-					return descriptor;
-				}
-			}
+		if(chunk.pool_offset != pool_used) {
+			const auto source = prepared_pool_.begin() + chunk.pool_offset;
+			std::copy(source, source + chunk.size, prepared_pool_.begin() + static_cast<std::ptrdiff_t>(pool_used));
+			chunk.pool_offset = static_cast<uint16_t>(pool_used);
 		}
+		pool_used += chunk.size;
+		prepared_writes_[kept++] = chunk;
 	}
-	return nullptr;
+	prepared_writes_.resize(kept);
+	prepared_pool_used_ = pool_used;
+	if(ConnectionInfo* info = FindConnection(connection_handle)) {
+		info->prepared_bytes = 0;
+		info->prepared_chunks = 0;
+	}
+}
+
+void AttributeServer::CancelAllPreparedWrites() {
+	prepared_writes_.clear();
+	prepared_pool_used_ = 0;
+	for(auto& info: connections_) {
+		info.prepared_bytes = 0;
+		info.prepared_chunks = 0;
+	}
+}
+
+Attribute* AttributeServer::FindServiceAttributeByHandle(uint16_t handle) {
+	const HandleEntry* entry = FindHandleEntry(handle);
+	return (entry != nullptr && entry->characteristic == nullptr) ? entry->attribute : nullptr;
+}
+
+const Attribute* AttributeServer::FindServiceAttributeByHandle(uint16_t handle) const {
+	const HandleEntry* entry = FindHandleEntry(handle);
+	return (entry != nullptr && entry->characteristic == nullptr) ? entry->attribute : nullptr;
+}
+
+Attribute* AttributeServer::FindAttributeByHandle(uint16_t handle) {
+	const HandleEntry* entry = FindHandleEntry(handle);
+	return entry != nullptr ? entry->attribute : nullptr;
+}
+
+const Attribute* AttributeServer::FindAttributeByHandle(uint16_t handle) const {
+	const HandleEntry* entry = FindHandleEntry(handle);
+	return entry != nullptr ? entry->attribute : nullptr;
 }
 
 bool AttributeServer::IsAttErrorCode(uint16_t value, BleError& out_error) {
@@ -419,15 +1883,91 @@ bool AttributeServer::IsAttErrorCode(uint16_t value, BleError& out_error) {
 	return false;
 }
 
+AttributeServer::MemoryReport AttributeServer::GetMemoryReport() const {
+	MemoryReport report;
+	report.services.reserve(services_.size());
+	size_t services_bytes = 0;
+	for(const auto& service: services_) {
+		ServiceMemoryUsage usage;
+		usage.uuid = service.GetUuid();
+		usage.handle = service.GetDeclarationAttribute().GetHandle();
+		usage.bytes = service.GetMemoryUsage();
+		usage.characteristics.reserve(service.GetCharacteristicCount());
+		for(const auto& characteristic: service) {
+			usage.characteristics.push_back(CharacteristicMemoryUsage{
+				characteristic.GetUuid(), characteristic.GetValueHandle(), characteristic.GetMemoryUsage()});
+		}
+		services_bytes += usage.bytes;
+		report.services.push_back(std::move(usage));
+	}
+	// services_ elements are counted by Service::GetMemoryUsage(); add spare capacity only
+	size_t server_bytes = sizeof(AttributeServer);
+	server_bytes += (services_.capacity() - services_.size()) * sizeof(Service);
+	server_bytes += handle_table_.capacity() * sizeof(HandleEntry);
+	server_bytes += service_index_.GetMemoryUsage() + characteristic_index_.GetMemoryUsage();
+	for(const auto& queue: pending_notifications_) {
+		server_bytes += queue.capacity() * sizeof(Characteristic*);
+	}
+	server_bytes += deferred_updates_.capacity() * sizeof(DeferredUpdate);
+	server_bytes += connections_.capacity() * sizeof(ConnectionInfo);
+	server_bytes += indication_channels_.capacity() * sizeof(IndicationChannel);
+	for(const auto& channel: indication_channels_) {
+		server_bytes += channel.queue.capacity() * sizeof(PendingIndication);
+		for(const auto& pending: channel.queue) {
+			server_bytes += pending.value.capacity();
+		}
+		server_bytes += channel.in_flight.value.capacity();
+	}
+	server_bytes += deferred_response_.value.capacity();
+	server_bytes += deferred_waiters_.capacity() * sizeof(uint16_t);
+	server_bytes += prepared_writes_.capacity() * sizeof(PreparedWrite);
+	server_bytes += prepared_pool_.capacity() + prepared_value_.capacity();
+	report.server_bytes = server_bytes;
+	report.uuid_table_bytes = CompactUuid::GetTableMemoryUsage();
+	report.total_bytes = services_bytes + server_bytes + report.uuid_table_bytes;
+	return report;
+}
+
+std::ostream& operator<<(std::ostream& os, const AttributeServer::MemoryReport& report) {
+	os << "GATT memory {";
+	for(const auto& service: report.services) {
+		os << "\n  Service handle=0x" << std::hex << std::setw(4) << std::setfill('0') << service.handle
+		   << std::dec << " " << service.uuid << ": " << service.bytes << " bytes";
+		for(const auto& characteristic: service.characteristics) {
+			os << "\n    Characteristic value_handle=0x" << std::hex << std::setw(4) << std::setfill('0')
+			   << characteristic.value_handle << std::dec << " " << characteristic.uuid << ": "
+			   << characteristic.bytes << " bytes";
+		}
+	}
+	os << "\n  Server: " << report.server_bytes << " bytes";
+	os << "\n  UUID table: " << report.uuid_table_bytes << " bytes";
+	os << "\n  Total: " << report.total_bytes << " bytes";
+	os << "\n}";
+	return os;
+}
+
 std::ostream& operator<<(std::ostream& os, const AttributeServer& server) {
 	os << "AttributeServer {";
 	os << "\n  Initialized: " << (server.IsInitialized() ? "true" : "false");
 	os << "\n  Service Count: " << server.GetServiceCount();
-	if(server.GetConnectionHandle() == 0) {
+	os << "\n  Database Hash: " << std::hex << std::setfill('0');
+	for(const uint8_t byte: server.GetDatabaseHash()) {
+		os << std::setw(2) << static_cast<unsigned>(byte);
+	}
+	os << std::dec;
+	if(!server.IsConnected()) {
 		os << "\n  Connection: disconnected";
 	} else {
-		os << "\n  Connection: connected (handle=0x" << std::hex << std::setw(4)
+		os << "\n  Connection: connected (active handle=0x" << std::hex << std::setw(4)
 		   << std::setfill('0') << server.GetConnectionHandle() << std::dec << ")";
+		for(const auto& connection: server.GetConnections()) {
+			os << "\n    handle=0x" << std::hex << std::setw(4) << std::setfill('0') << connection.handle
+			   << std::dec << " security=" << static_cast<unsigned>(connection.security_level)
+			   << " authorized=" << (connection.authorization_granted ? "true" : "false")
+			   << " mtu=" << connection.mtu
+			   << " features=0x" << std::hex << static_cast<unsigned>(connection.client_features) << std::dec
+			   << " change_aware=" << (connection.change_aware ? "true" : "false");
+		}
 	}
 	os << "\n  Services:" << std::endl;
 	size_t index = 1;
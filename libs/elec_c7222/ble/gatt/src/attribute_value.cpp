@@ -0,0 +1,62 @@
+#include "attribute_value.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+namespace c7222 {
+
+AttributeValue::AttributeValue(AttributeValue&& other) noexcept
+	: heap_(std::move(other.heap_)),
+	  heap_capacity_(other.heap_capacity_),
+	  size_(other.size_) {
+	std::copy(other.inline_, other.inline_ + kInlineCapacity, inline_);
+	other.heap_capacity_ = 0;
+	other.size_ = 0;
+}
+
+AttributeValue& AttributeValue::operator=(AttributeValue&& other) noexcept {
+	if(this == &other) {
+		return *this;
+	}
+	heap_ = std::move(other.heap_);
+	heap_capacity_ = other.heap_capacity_;
+	size_ = other.size_;
+	std::copy(other.inline_, other.inline_ + kInlineCapacity, inline_);
+	other.heap_capacity_ = 0;
+	other.size_ = 0;
+	return *this;
+}
+
+void AttributeValue::Assign(const uint8_t* data, size_t size) {
+	if(data == nullptr || size == 0) {
+		size_ = 0;
+		return;
+	}
+	assert(size <= UINT16_MAX && "Attribute value too large");
+	if(size <= kInlineCapacity) {
+		// data may point into our own storage
+		std::memmove(inline_, data, size);
+		size_ = static_cast<uint16_t>(size);
+		return;
+	}
+	if(size > heap_capacity_) {
+		std::unique_ptr<uint8_t[]> block(new uint8_t[size]);
+		std::copy_n(data, size, block.get());
+		heap_ = std::move(block);
+		heap_capacity_ = static_cast<uint16_t>(size);
+	} else {
+		std::memmove(heap_.get(), data, size);
+	}
+	size_ = static_cast<uint16_t>(size);
+}
+
+void AttributeValue::ShrinkToFit() {
+	if(size_ <= kInlineCapacity) {
+		heap_.reset();
+		heap_capacity_ = 0;
+	}
+}
+
+}  // namespace c7222
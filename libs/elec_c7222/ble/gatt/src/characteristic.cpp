@@ -3,6 +3,7 @@
 #include "ble_utils.hpp"
 
 #include <algorithm>
+#include <initializer_list>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
@@ -83,19 +84,12 @@ Characteristic::Characteristic(const Uuid& uuid,
 	  notification_pending_(false),
 	  declaration_attr_(MakeOwnedDeclarationAttribute(properties, declaration_handle, value_handle, uuid)),
 	  value_attr_(uuid, MakeValueAttributeProperties(properties), value_handle) {
-
-	// Set up read and write callbacks for the value attribute
-	value_attr_.SetReadCallback([this](uint16_t offset, uint8_t* buffer, uint16_t buffer_size) {
-		return this->HandleValueRead(offset, buffer, buffer_size);
-	});
-	value_attr_.SetWriteCallback([this](uint16_t offset, const uint8_t* data, uint16_t size) {
-		return this->HandleValueWrite(offset, data, size);
-	});
+	// Value reads/writes are routed by role (see DispatchAttributeRead/Write)
 }
 
 Characteristic::Characteristic(Attribute&& decl_attribute,
 							   Attribute&& value_attr,
-							   std::list<Attribute>&& descriptor_attrs)
+							   std::vector<Attribute>&& descriptor_attrs)
 	: uuid_(Uuid()),
 	  properties_(Properties::kNone),
 	  connection_handle_(0),
@@ -128,24 +122,12 @@ Characteristic::Characteristic(Attribute&& decl_attribute,
 		value_attr_.SetHandle(value_handle);
 	}
 
-	value_attr_.SetReadCallback([&](uint16_t offset, uint8_t* buffer, uint16_t buffer_size) {
-		return this->HandleValueRead(offset, buffer, buffer_size);
-	});
-	value_attr_.SetWriteCallback([this](uint16_t offset, const uint8_t* data, uint16_t size) {
-		return this->HandleValueWrite(offset, data, size);
-	});
-
+	descriptors_.reserve(descriptor_attrs.size());
 	for(auto& descriptor: descriptor_attrs) {
 		if(Attribute::IsClientCharacteristicConfiguration(descriptor)) {
 			cccd_ = std::make_unique<Attribute>(std::move(descriptor));
-			cccd_->SetWriteCallback([this](uint16_t offset, const uint8_t* data, uint16_t size) {
-				return HandleCccdWrite(offset, data, size);
-			});
 		} else if(Attribute::IsServerCharacteristicConfiguration(descriptor)) {
 			sccd_ = std::make_unique<Attribute>(std::move(descriptor));
-			sccd_->SetWriteCallback([this](uint16_t offset, const uint8_t* data, uint16_t size) {
-				return HandleSccdWrite(offset, data, size);
-			});
 		} else if(Attribute::IsCharacteristicExtendedProperties(descriptor)) {
 			extended_properties_ = std::make_unique<Attribute>(std::move(descriptor));
 		} else if(Attribute::IsCharacteristicUserDescription(descriptor)) {
@@ -166,7 +148,26 @@ Characteristic::Characteristic(Characteristic&& other) noexcept
 	  uuid_(std::move(other.uuid_)),
 	  properties_(other.properties_),
 	  connection_handle_(other.connection_handle_),
+	  subscriptions_(std::move(other.subscriptions_)),
 	  notification_pending_(other.notification_pending_),
+	  stack_send_requested_(other.stack_send_requested_.load()),
+	  has_last_sent_value_(other.has_last_sent_value_),
+	  last_sent_ms_(other.last_sent_ms_),
+	  coalescing_(other.coalescing_),
+	  last_sent_value_(std::move(other.last_sent_value_)),
+	  notification_queue_(std::move(other.notification_queue_)),
+	  notification_backpressure_(other.notification_backpressure_),
+	  ingest_(std::move(other.ingest_)),
+	  read_cache_(std::move(other.read_cache_)),
+	  tx_priority_(other.tx_priority_),
+	  tx_weight_(other.tx_weight_),
+	  tx_turn_sent_(other.tx_turn_sent_),
+	  truncated_updates_(other.truncated_updates_),
+	  store_written_value_(other.store_written_value_),
+	  deferred_reads_(other.deferred_reads_),
+	  deferred_writes_(other.deferred_writes_),
+	  persistent_(other.persistent_),
+	  value_restored_(other.value_restored_),
 	  declaration_attr_(std::move(other.declaration_attr_)),
 	  value_attr_(std::move(other.value_attr_)),
 	  cccd_(std::move(other.cccd_)),
@@ -176,7 +177,6 @@ Characteristic::Characteristic(Characteristic&& other) noexcept
 	  user_description_text_(std::move(other.user_description_text_)),
 	  descriptors_(std::move(other.descriptors_)),
 	  event_handlers_(std::move(other.event_handlers_)) {
-	RebindInternalCallbacks();
 }
 
 Characteristic& Characteristic::operator=(Characteristic&& other) noexcept {
@@ -187,7 +187,26 @@ Characteristic& Characteristic::operator=(Characteristic&& other) noexcept {
 	uuid_ = std::move(other.uuid_);
 	properties_ = other.properties_;
 	connection_handle_ = other.connection_handle_;
+	subscriptions_ = std::move(other.subscriptions_);
 	notification_pending_ = other.notification_pending_;
+	stack_send_requested_.store(other.stack_send_requested_.load());
+	has_last_sent_value_ = other.has_last_sent_value_;
+	last_sent_ms_ = other.last_sent_ms_;
+	coalescing_ = other.coalescing_;
+	last_sent_value_ = std::move(other.last_sent_value_);
+	notification_queue_ = std::move(other.notification_queue_);
+	notification_backpressure_ = other.notification_backpressure_;
+	ingest_ = std::move(other.ingest_);
+	read_cache_ = std::move(other.read_cache_);
+	tx_priority_ = other.tx_priority_;
+	tx_weight_ = other.tx_weight_;
+	tx_turn_sent_ = other.tx_turn_sent_;
+	truncated_updates_ = other.truncated_updates_;
+	store_written_value_ = other.store_written_value_;
+	deferred_reads_ = other.deferred_reads_;
+	deferred_writes_ = other.deferred_writes_;
+	persistent_ = other.persistent_;
+	value_restored_ = other.value_restored_;
 	declaration_attr_ = std::move(other.declaration_attr_);
 	value_attr_ = std::move(other.value_attr_);
 	cccd_ = std::move(other.cccd_);
@@ -197,7 +216,6 @@ Characteristic& Characteristic::operator=(Characteristic&& other) noexcept {
 	user_description_text_ = std::move(other.user_description_text_);
 	descriptors_ = std::move(other.descriptors_);
 	event_handlers_ = std::move(other.event_handlers_);
-	RebindInternalCallbacks();
 	return *this;
 }
 
@@ -253,41 +271,18 @@ Characteristic::ParseFromAttributes(std::list<Attribute>& attributes) {
 	Attribute value_attribute = std::move(*value_it);
 	characteristic_attributes.erase(value_it);
 
-	std::list<Attribute> descriptor_attrs;
-	if(!characteristic_attributes.empty()) {
-		descriptor_attrs.splice(descriptor_attrs.end(),
-								characteristic_attributes,
-								characteristic_attributes.begin(),
-								characteristic_attributes.end());
+	std::vector<Attribute> descriptor_attrs;
+	descriptor_attrs.reserve(characteristic_attributes.size());
+	for(auto& descriptor: characteristic_attributes) {
+		descriptor_attrs.push_back(std::move(descriptor));
 	}
+	characteristic_attributes.clear();
 
 	return Characteristic(std::move(decl_attribute),
 						  std::move(value_attribute),
 						  std::move(descriptor_attrs));
 }
 
-void Characteristic::RebindInternalCallbacks() {
-	value_attr_.SetReadCallback([this](uint16_t offset, uint8_t* buffer, uint16_t buffer_size) {
-		return HandleValueRead(offset, buffer, buffer_size);
-	});
-	value_attr_.SetWriteCallback([this](uint16_t offset, const uint8_t* data, uint16_t size) {
-		return HandleValueWrite(offset, data, size);
-	});
-	if(cccd_) {
-		cccd_->SetWriteCallback([this](uint16_t offset, const uint8_t* data, uint16_t size) {
-			return HandleCccdWrite(offset, data, size);
-		});
-	}
-	if(sccd_) {
-		sccd_->SetWriteCallback([this](uint16_t offset, const uint8_t* data, uint16_t size) {
-			return HandleSccdWrite(offset, data, size);
-		});
-	}
-	if(user_description_) {
-		ConfigureUserDescriptionDescriptor();
-	}
-}
-
 bool Characteristic::IsValid() const {
 	return uuid_.IsValid() && value_attr_.GetHandle() != 0 && declaration_attr_.GetHandle() != 0;
 }
@@ -357,6 +352,8 @@ bool Characteristic::SetValue(const uint8_t* data, size_t size) {
 	if(!value_attr_.SetValue(data, size)) {
 		return false;
 	}
+	InvalidateReadCache();
+	PersistValue();
 	UpdateValue();
 	return true;
 }
@@ -365,6 +362,8 @@ bool Characteristic::SetValue(std::vector<uint8_t>&& data) {
 	if(!value_attr_.SetValue(std::move(data))) {
 		return false;
 	}
+	InvalidateReadCache();
+	PersistValue();
 	UpdateValue();
 	return true;
 }
@@ -373,10 +372,589 @@ bool Characteristic::SetValue(const std::vector<uint8_t>& data) {
 	if(!value_attr_.SetValue(data)) {
 		return false;
 	}
+	InvalidateReadCache();
+	PersistValue();
 	UpdateValue();
 	return true;
 }
 
+bool Characteristic::SetPersistent(bool enable) {
+	auto* server = AttributeServer::GetInstance();
+	ValueStore* store = server != nullptr ? server->GetValueStore() : nullptr;
+	if(store == nullptr || !IsDynamic()) {
+		return false;
+	}
+	if(!enable) {
+		persistent_ = false;
+		return store->StageErase(GetValueHandle());
+	}
+	if(persistent_) {
+		return true;
+	}
+	if(!store->Stage(GetValueHandle(), value_attr_.GetValueData(), value_attr_.GetValueSize())) {
+		return false;
+	}
+	persistent_ = true;
+	return true;
+}
+
+void Characteristic::RestorePersistentValue(const uint8_t* data, size_t size) {
+	(void)value_attr_.SetValue(data, size);
+	InvalidateReadCache();
+	persistent_ = true;
+	value_restored_ = true;
+}
+
+void Characteristic::PersistValue() {
+	if(!persistent_) {
+		return;
+	}
+	auto* server = AttributeServer::GetInstance();
+	ValueStore* store = server != nullptr ? server->GetValueStore() : nullptr;
+	if(store != nullptr) {
+		(void)store->Stage(GetValueHandle(), value_attr_.GetValueData(), value_attr_.GetValueSize());
+	}
+}
+
+void Characteristic::SetReadCache(uint32_t ttl_ms) {
+	if(!read_cache_) {
+		read_cache_ = std::make_unique<ReadCache>();
+	}
+	read_cache_->ttl_ms = ttl_ms;
+	InvalidateReadCache();
+}
+
+bool Characteristic::IsReadCacheFresh() const {
+	const ReadCache::Snapshot* snapshot = FindReadSnapshot(GetRequestConnectionHandle());
+	if(snapshot == nullptr || snapshot->stale) {
+		return false;
+	}
+	return AttributeServer::GetTimeMs() - snapshot->refreshed_ms < read_cache_->ttl_ms;
+}
+
+size_t Characteristic::GetReadValueSize() const {
+	const ReadCache::Snapshot* snapshot = FindReadSnapshot(GetRequestConnectionHandle());
+	return snapshot != nullptr ? snapshot->value.size() : GetValueSize();
+}
+
+Characteristic::ReadCache::Snapshot* Characteristic::FindReadSnapshot(uint16_t connection_handle) const {
+	if(!read_cache_) {
+		return nullptr;
+	}
+	auto& snapshots = read_cache_->snapshots;
+	const auto it = std::find_if(snapshots.begin(), snapshots.end(), [connection_handle](const ReadCache::Snapshot& entry) {
+		return entry.connection_handle == connection_handle;
+	});
+	return it != snapshots.end() ? &*it : nullptr;
+}
+
+Characteristic::ReadCache::Snapshot& Characteristic::RefreshReadSnapshot(uint16_t connection_handle) const {
+	ReadCache::Snapshot* snapshot = FindReadSnapshot(connection_handle);
+	if(snapshot == nullptr) {
+		read_cache_->snapshots.emplace_back();
+		snapshot = &read_cache_->snapshots.back();
+		snapshot->connection_handle = connection_handle;
+	}
+	snapshot->value.Assign(GetValueData(), GetValueSize());
+	snapshot->refreshed_ms = AttributeServer::GetTimeMs();
+	snapshot->stale = false;
+	return *snapshot;
+}
+
+bool Characteristic::StoreDeferredReadValue(uint16_t connection_handle, const uint8_t* data, size_t size) {
+	if(!value_attr_.SetValue(data, size)) {
+		return false;
+	}
+	if(read_cache_) {
+		(void)RefreshReadSnapshot(connection_handle);
+	}
+	return true;
+}
+
+void Characteristic::SetUpdateCoalescing(const UpdateCoalescing& config) {
+	coalescing_ = config;
+	if(!coalescing_.suppress_unchanged) {
+		has_last_sent_value_ = false;
+		last_sent_value_.clear();
+		last_sent_value_.shrink_to_fit();
+	}
+}
+
+void Characteristic::EnableNotificationQueue(size_t capacity,
+											 size_t max_payload_size,
+											 size_t high_watermark) {
+	DisableNotificationQueue();
+	notification_queue_ = std::make_unique<NotificationQueue>(capacity, max_payload_size, high_watermark);
+}
+
+void Characteristic::DisableNotificationQueue() {
+	if(!notification_queue_) {
+		return;
+	}
+	notification_queue_->Clear();
+	UpdateNotificationBackpressure();
+	notification_queue_.reset();
+}
+
+IngestChannel* Characteristic::EnableIngest(size_t buffer_size, size_t report_threshold) {
+	ingest_.reset();
+	if(!CanWriteWithoutResponse() || !IsDynamic()) {
+		C7222_BLE_DEBUG_PRINT("[BLE] Ingest requires a dynamic write-without-response value\n");
+		return nullptr;
+	}
+	auto channel = std::make_unique<IngestChannel>(buffer_size, report_threshold);
+	if(!channel->IsValid()) {
+		return nullptr;
+	}
+	ingest_ = std::move(channel);
+	return ingest_.get();
+}
+
+void Characteristic::SendIngestCreditReport() {
+	if(!ingest_) {
+		return;
+	}
+	uint8_t report[IngestChannel::kCreditReportSize];
+	ingest_->BuildCreditReport(report);
+	if(!value_attr_.SetValue(report, sizeof(report))) {
+		return;
+	}
+	InvalidateReadCache();
+	// Credits are granted to the connection feeding the stream only.
+	const uint16_t owner = ingest_->GetOwnerConnection();
+	for(auto& subscription: subscriptions_) {
+		subscription.update_pending = owner != 0 && subscription.connection_handle == owner;
+	}
+	(void)SendCurrentValue();
+}
+
+void Characteristic::SetConnectionHandle(uint16_t connection_handle) {
+	connection_handle_ = connection_handle;
+	if(connection_handle != 0) {
+		return;
+	}
+	// Last connection closed
+	if(!subscriptions_.empty()) {
+		subscriptions_.clear();
+		SyncCccdAttribute();
+	}
+	if(read_cache_) {
+		read_cache_->snapshots.clear();
+	}
+	notification_pending_ = false;
+	has_last_sent_value_ = false;
+	tx_turn_sent_ = 0;
+	if(ingest_) {
+		ingest_->Release(ingest_->GetOwnerConnection());
+	}
+	if(notification_queue_ && !notification_queue_->IsEmpty()) {
+		notification_queue_->Clear();
+		UpdateNotificationBackpressure();
+	}
+}
+
+void Characteristic::RemoveConnection(uint16_t connection_handle) {
+	SetSubscription(connection_handle, 0);
+	if(ingest_) {
+		ingest_->Release(connection_handle);
+	}
+	if(read_cache_) {
+		auto& snapshots = read_cache_->snapshots;
+		snapshots.erase(std::remove_if(snapshots.begin(), snapshots.end(), [connection_handle](const ReadCache::Snapshot& entry) {
+							return entry.connection_handle == connection_handle;
+						}),
+						snapshots.end());
+	}
+	if(notification_queue_ && !notification_queue_->IsEmpty() && !IsNotificationsEnabled()) {
+		notification_queue_->Clear();
+		UpdateNotificationBackpressure();
+	}
+	if(subscriptions_.empty()) {
+		notification_pending_ = false;
+		tx_turn_sent_ = 0;
+	}
+}
+
+BleError Characteristic::UpdateValue() {
+	if(notification_queue_ && IsNotificationsEnabled() && !IsIndicationsEnabled()) {
+		return EnqueueCurrentValue();
+	}
+	if(!coalescing_.enabled) {
+		MarkSubscribersPending();
+		return SendCurrentValue();
+	}
+	// Coalesced: the value is already stored; one queued flush sends the
+	// latest value to every subscriber, however many updates arrive before it.
+	if(subscriptions_.empty()) {
+		return BleError::kSuccess;
+	}
+	MarkSubscribersPending();
+	if(!notification_pending_) {
+		QueuePendingUpdate();
+	}
+	return BleError::kSuccess;
+}
+
+BleError Characteristic::FlushPendingUpdate() {
+	if(!notification_pending_) {
+		return BleError::kSuccess;
+	}
+	notification_pending_ = false;
+	if(notification_queue_ && !notification_queue_->IsEmpty()) {
+		return DrainNotificationQueue();
+	}
+	if(!coalescing_.enabled) {
+		return SendCurrentValue();
+	}
+
+	auto* server = AttributeServer::GetInstance();
+	if(coalescing_.min_interval_ms != 0 && has_last_sent_value_ && server != nullptr) {
+		const uint32_t due_ms = last_sent_ms_ + coalescing_.min_interval_ms;
+		if(static_cast<int32_t>(AttributeServer::GetTimeMs() - due_ms) < 0) {
+			notification_pending_ = true;
+			server->ScheduleDeferredUpdate(this, due_ms);
+			return BleError::kSuccess;
+		}
+	}
+
+	if(coalescing_.suppress_unchanged && has_last_sent_value_) {
+		const uint8_t* data = GetValueData();
+		const size_t size = GetValueSize();
+		if(data != nullptr && size == last_sent_value_.size() &&
+		   std::equal(data, data + size, last_sent_value_.begin())) {
+			for(auto& subscription: subscriptions_) {
+				subscription.update_pending = false;
+			}
+			return BleError::kSuccess;
+		}
+	}
+	return SendCurrentValue();
+}
+
+BleError Characteristic::SendCurrentValue() {
+	const uint8_t* value_data = GetValueData();
+	if(value_data == nullptr) {
+		return BleError::kSuccess;
+	}
+	const auto value_size = static_cast<uint16_t>(GetValueSize());
+
+	uint16_t busy_connection = 0;
+	bool any_sent = false;
+	const BleError status = SendToPendingSubscribers(value_data, value_size, busy_connection, any_sent);
+	if(busy_connection != 0) {
+		// Stack is busy. Queue once with the server so only pending characteristics
+		// see the next ATT_EVENT_CAN_SEND_NOW; connections already served are skipped.
+		if(!notification_pending_) {
+			QueuePendingUpdate(busy_connection);
+		}
+		return BleError::kBtstackAclBuffersFull;
+	}
+
+	notification_pending_ = false;
+	if(any_sent) {
+		// Bookkeeping for coalescing: last_sent_value_ reuses its capacity.
+		has_last_sent_value_ = true;
+		last_sent_ms_ = AttributeServer::GetTimeMs();
+		if(coalescing_.suppress_unchanged) {
+			last_sent_value_.assign(value_data, value_data + value_size);
+		}
+	}
+	return status;
+}
+
+BleError Characteristic::SendToPendingSubscribers(const uint8_t* data,
+												  uint16_t size,
+												  uint16_t& busy_connection,
+												  bool& any_sent) {
+	busy_connection = 0;
+	any_sent = false;
+	BleError result = BleError::kSuccess;
+	const bool use_indication_queue = IsServedByAttributeServer();
+	// Indexed: queue callbacks may re-enter this characteristic.
+	for(size_t i = 0; i < subscriptions_.size(); ++i) {
+		if(!subscriptions_[i].update_pending) {
+			continue;
+		}
+		const uint16_t connection = subscriptions_[i].connection_handle;
+		// Prioritize indication over notification if both are enabled. Indications
+		// are serialized per connection by the server's indication queue.
+		const bool indicate =
+			(subscriptions_[i].config & static_cast<uint16_t>(CCCDProperties::kIndications)) != 0;
+		const BleError status =
+			indicate && use_indication_queue
+				? AttributeServer::GetInstance()->QueueIndication(this, connection, data, size, nullptr)
+				: TransmitValue(connection, indicate, data, size);
+		if(i >= subscriptions_.size() || subscriptions_[i].connection_handle != connection) {
+			continue;
+		}
+		if(status == BleError::kBtstackAclBuffersFull) {
+			if(busy_connection == 0) {
+				busy_connection = connection;
+			}
+			continue;
+		}
+		subscriptions_[i].update_pending = false;
+		if(status == BleError::kSuccess) {
+			any_sent = true;
+		} else if(result == BleError::kSuccess) {
+			result = status;
+		}
+	}
+	return result;
+}
+
+void Characteristic::MarkSubscribersPending() {
+	for(auto& subscription: subscriptions_) {
+		subscription.update_pending = true;
+	}
+}
+
+BleError Characteristic::EnqueueCurrentValue() {
+	if(subscriptions_.empty()) {
+		return BleError::kSuccess;
+	}
+	const uint8_t* value_data = GetValueData();
+	const size_t value_size = GetValueSize();
+	if(value_data == nullptr) {
+		return BleError::kSuccess;
+	}
+
+	// Fast path: nothing is queued ahead of this payload.
+	uint16_t busy_connection = 0;
+	const bool queue_was_empty = notification_queue_->IsEmpty();
+	if(!notification_pending_ && queue_was_empty) {
+		MarkSubscribersPending();
+		bool any_sent = false;
+		const BleError status = SendToPendingSubscribers(
+			value_data, static_cast<uint16_t>(value_size), busy_connection, any_sent);
+		if(busy_connection == 0) {
+			return status;
+		}
+		// Queued for the busy connections only: their flags stay set.
+	}
+
+	if(!notification_queue_->Push(value_data, value_size)) {
+		C7222_BLE_DEBUG_PRINT("[BLE] Characteristic 0x%04x: notification queue full, payload dropped\n",
+			static_cast<unsigned>(GetValueHandle()));
+		return BleError::kMemoryCapacityExceeded;
+	}
+	if(queue_was_empty && busy_connection == 0) {
+		// New queue front: owed to every subscriber.
+		MarkSubscribersPending();
+	}
+	UpdateNotificationBackpressure();
+	if(!notification_pending_) {
+		QueuePendingUpdate(busy_connection);
+	}
+	return BleError::kSuccess;
+}
+
+BleError Characteristic::DrainNotificationQueue() {
+	while(!notification_queue_->IsEmpty()) {
+		if(tx_turn_sent_ >= tx_weight_) {
+			// Turn used up: yield to the next characteristic of this class.
+			tx_turn_sent_ = 0;
+			UpdateNotificationBackpressure();
+			QueuePendingUpdate();
+			return BleError::kSuccess;
+		}
+		if(subscriptions_.empty() || !IsNotificationsEnabled()) {
+			notification_queue_->Clear();
+			break;
+		}
+		uint16_t busy_connection = 0;
+		bool any_sent = false;
+		(void)SendToPendingSubscribers(
+			notification_queue_->FrontData(), notification_queue_->FrontSize(), busy_connection, any_sent);
+		if(busy_connection != 0) {
+			UpdateNotificationBackpressure();
+			QueuePendingUpdate(busy_connection);
+			return BleError::kBtstackAclBuffersFull;
+		}
+		notification_queue_->Pop();
+		if(!notification_queue_->IsEmpty()) {
+			MarkSubscribersPending();
+		}
+		++tx_turn_sent_;
+	}
+	tx_turn_sent_ = 0;
+	UpdateNotificationBackpressure();
+	return BleError::kSuccess;
+}
+
+void Characteristic::UpdateNotificationBackpressure() {
+	const size_t depth = notification_queue_->GetSize();
+	bool active = notification_backpressure_;
+	if(!active && depth >= notification_queue_->GetHighWatermark()) {
+		active = true;
+	} else if(active && depth <= notification_queue_->GetLowWatermark()) {
+		active = false;
+	}
+	if(active == notification_backpressure_) {
+		return;
+	}
+	notification_backpressure_ = active;
+	for(auto* handler: event_handlers_) {
+		if(handler) {
+			handler->OnNotificationQueueBackpressure(active);
+		}
+	}
+}
+
+BleError Characteristic::Indicate(const uint8_t* data, size_t size, IndicationCallback callback) {
+	if(!IsIndicationsEnabled() || !IsServedByAttributeServer()) {
+		return BleError::kCommandDisallowed;
+	}
+	if(!value_attr_.SetValue(data, size)) {
+		return BleError::kAttErrorWriteNotPermitted;
+	}
+	auto* server = AttributeServer::GetInstance();
+	BleError result = BleError::kCommandDisallowed;
+	for(size_t i = 0; i < subscriptions_.size(); ++i) {
+		if((subscriptions_[i].config & static_cast<uint16_t>(CCCDProperties::kIndications)) == 0) {
+			continue;
+		}
+		const BleError status = server->QueueIndication(
+			this, subscriptions_[i].connection_handle, data, static_cast<uint16_t>(size), callback);
+		if(result == BleError::kCommandDisallowed || result == BleError::kSuccess) {
+			result = status;
+		}
+	}
+	return result;
+}
+
+BleError Characteristic::TransmitIndication(uint16_t connection_handle, const uint8_t* data, uint16_t size) {
+	if(!IsIndicationsEnabled(connection_handle)) {
+		return BleError::kCommandDisallowed;
+	}
+	return TransmitValue(connection_handle, true, data, size);
+}
+
+uint16_t Characteristic::GetMaxUpdatePayload() const {
+	const auto* server = AttributeServer::GetInstance();
+	if(server == nullptr) {
+		return AttributeServer::kDefaultAttMtu - AttributeServer::kValueUpdateHeaderSize;
+	}
+	if(subscriptions_.empty()) {
+		return server->GetMaxValuePayload(connection_handle_);
+	}
+	uint16_t payload = UINT16_MAX;
+	for(const auto& subscription: subscriptions_) {
+		payload = std::min(payload, server->GetMaxValuePayload(subscription.connection_handle));
+	}
+	return payload;
+}
+
+BleError Characteristic::TransmitValue(uint16_t connection_handle,
+									   bool indicate,
+									   const uint8_t* data,
+									   uint16_t size) {
+	const auto* server = AttributeServer::GetInstance();
+	const uint16_t max_payload =
+		server != nullptr ? server->GetMaxValuePayload(connection_handle)
+						  : AttributeServer::kDefaultAttMtu - AttributeServer::kValueUpdateHeaderSize;
+	if(size > max_payload) {
+		++truncated_updates_;
+		C7222_BLE_DEBUG_PRINT("[BLE] Characteristic 0x%04x: update of %u bytes truncated to %u (ATT MTU)\n",
+			static_cast<unsigned>(GetValueHandle()),
+			static_cast<unsigned>(size),
+			static_cast<unsigned>(max_payload));
+		size = max_payload;
+	}
+	return SendValueUpdate(connection_handle, indicate, data, size);
+}
+
+BleError Characteristic::CompleteDeferredRead(const uint8_t* data, size_t size) {
+	auto* server = AttributeServer::GetInstance();
+	if(server == nullptr) {
+		return BleError::kCommandDisallowed;
+	}
+	return server->CompleteDeferredRead(this, BleError::kSuccess, data, size);
+}
+
+BleError Characteristic::FailDeferredRead(BleError error) {
+	auto* server = AttributeServer::GetInstance();
+	if(server == nullptr) {
+		return BleError::kCommandDisallowed;
+	}
+	return server->CompleteDeferredRead(this, error, nullptr, 0);
+}
+
+BleError Characteristic::CompleteDeferredWrite(BleError status) {
+	auto* server = AttributeServer::GetInstance();
+	if(server == nullptr) {
+		return BleError::kCommandDisallowed;
+	}
+	return server->CompleteDeferredWrite(this, status);
+}
+
+bool Characteristic::IsServedByAttributeServer() const {
+	const auto* server = AttributeServer::GetInstance();
+	return server != nullptr && server->FindCharacteristicByHandle(GetValueHandle()) == this;
+}
+
+void Characteristic::QueuePendingUpdate(uint16_t connection_handle) {
+	notification_pending_ = true;
+	auto* server = AttributeServer::GetInstance();
+	if(server != nullptr) {
+		server->RequestCanSendNow(this, connection_handle);
+	}
+}
+
+void Characteristic::MarkStackSendRequested() {
+	stack_send_requested_.store(true);
+}
+
+bool Characteristic::TakeStackSendRequest() {
+	return stack_send_requested_.exchange(false);
+}
+
+uint16_t Characteristic::GetRequestConnectionHandle() const {
+	const auto* server = AttributeServer::GetInstance();
+	const uint16_t request_handle = server != nullptr ? server->GetRequestConnectionHandle() : 0;
+	return request_handle != 0 ? request_handle : connection_handle_;
+}
+
+const Characteristic::Subscription* Characteristic::FindSubscription(uint16_t connection_handle) const {
+	const auto it = std::find_if(subscriptions_.begin(), subscriptions_.end(), [connection_handle](const Subscription& entry) {
+		return entry.connection_handle == connection_handle;
+	});
+	return it != subscriptions_.end() ? &*it : nullptr;
+}
+
+void Characteristic::SetSubscription(uint16_t connection_handle, uint16_t config) {
+	if(connection_handle == 0) {
+		return;
+	}
+	auto it = std::find_if(subscriptions_.begin(), subscriptions_.end(), [connection_handle](const Subscription& entry) {
+		return entry.connection_handle == connection_handle;
+	});
+	if(config == 0) {
+		if(it == subscriptions_.end()) {
+			return;
+		}
+		subscriptions_.erase(it);
+	} else if(it != subscriptions_.end()) {
+		it->config = config;
+	} else {
+		subscriptions_.push_back({connection_handle, config, false});
+	}
+	SyncCccdAttribute();
+}
+
+void Characteristic::SyncCccdAttribute() {
+	if(!cccd_) {
+		return;
+	}
+	// The attribute holds the union so IsNotificationsEnabled() stays a cheap
+	// "anyone subscribed" test; reads are answered per connection.
+	uint16_t config = 0;
+	for(const auto& subscription: subscriptions_) {
+		config |= subscription.config;
+	}
+	const uint8_t cccd_bytes[2] = {static_cast<uint8_t>(config & 0xFF), static_cast<uint8_t>((config >> 8) & 0xFF)};
+	cccd_->SetValue(cccd_bytes, sizeof(cccd_bytes));
+}
 
 bool Characteristic::IsNotificationsEnabled() const {
 	if(!cccd_) {
@@ -402,6 +980,18 @@ bool Characteristic::IsIndicationsEnabled() const {
 	return (value & static_cast<uint16_t>(CCCDProperties::kIndications)) != 0;
 }
 
+bool Characteristic::IsNotificationsEnabled(uint16_t connection_handle) const {
+	const Subscription* subscription = FindSubscription(connection_handle);
+	return subscription != nullptr &&
+		   (subscription->config & static_cast<uint16_t>(CCCDProperties::kNotifications)) != 0;
+}
+
+bool Characteristic::IsIndicationsEnabled(uint16_t connection_handle) const {
+	const Subscription* subscription = FindSubscription(connection_handle);
+	return subscription != nullptr &&
+		   (subscription->config & static_cast<uint16_t>(CCCDProperties::kIndications)) != 0;
+}
+
 bool Characteristic::IsBroadcastEnabled() const {
 	if(!sccd_) {
 		return false;
@@ -419,22 +1009,30 @@ Attribute& Characteristic::EnableCCCD() {
 		// CCCD initial value: 0x0000 = notifications and indications disabled
 		cccd_ = std::make_unique<Attribute>(
 			Attribute::ClientCharacteristicConfiguration(0x0000, 0 /* handle assigned later */));
-		cccd_->SetWriteCallback([this](uint16_t offset, const uint8_t* data, uint16_t size) {
-			return HandleCccdWrite(offset, data, size);
-		});
 	}
 	return *cccd_;
 }
 
 Attribute& Characteristic::SetCCCDValue(CCCDProperties config) {
 	EnableCCCD();
-	// Convert the 16-bit config value to little-endian bytes
 	uint16_t config_value = static_cast<uint16_t>(config);
-	std::vector<uint8_t> cccd_bytes = {
+	const auto* server = AttributeServer::GetInstance();
+	if(server != nullptr && !server->GetConnections().empty()) {
+		for(const auto& connection: server->GetConnections()) {
+			SetSubscription(connection.handle, config_value);
+		}
+		return *cccd_;
+	}
+	if(connection_handle_ != 0) {
+		SetSubscription(connection_handle_, config_value);
+		return *cccd_;
+	}
+	// Convert the 16-bit config value to little-endian bytes
+	const uint8_t cccd_bytes[2] = {
 		static_cast<uint8_t>(config_value & 0xFF),		  // LSB
 		static_cast<uint8_t>((config_value >> 8) & 0xFF)  // MSB
 	};
-	cccd_->SetValue(cccd_bytes);
+	cccd_->SetValue(cccd_bytes, sizeof(cccd_bytes));
 	return *cccd_;
 }
 
@@ -443,9 +1041,6 @@ Attribute& Characteristic::EnableSCCD() {
 		// SCCD initial value: 0x0000 = broadcasts disabled
 		sccd_ = std::make_unique<Attribute>(
 			Attribute::ServerCharacteristicConfiguration(0x0000, 0 /* handle assigned later */));
-		sccd_->SetWriteCallback([this](uint16_t offset, const uint8_t* data, uint16_t size) {
-			return HandleSccdWrite(offset, data, size);
-		});
 	}
 	return *sccd_;
 }
@@ -454,11 +1049,11 @@ Attribute& Characteristic::SetSCCDValue(SCCDProperties config) {
 	EnableSCCD();
 	// Convert the 16-bit config value to little-endian bytes
 	uint16_t config_value = static_cast<uint16_t>(config);
-	std::vector<uint8_t> sccd_bytes = {
+	const uint8_t sccd_bytes[2] = {
 		static_cast<uint8_t>(config_value & 0xFF),		  // LSB
 		static_cast<uint8_t>((config_value >> 8) & 0xFF)  // MSB
 	};
-	sccd_->SetValue(sccd_bytes);
+	sccd_->SetValue(sccd_bytes, sizeof(sccd_bytes));
 	return *sccd_;
 }
 
@@ -516,12 +1111,6 @@ void Characteristic::ConfigureUserDescriptionDescriptor() {
 	props &= ~static_cast<uint16_t>(Attribute::Properties::kWriteWithoutResponse);
 	props &= ~static_cast<uint16_t>(Attribute::Properties::kAuthenticatedSignedWrite);
 	user_description_->SetProperties(props);
-	user_description_->SetReadCallback([this](uint16_t offset, uint8_t* buffer, uint16_t buffer_size) {
-		return HandleUserDescriptionRead(offset, buffer, buffer_size);
-	});
-	user_description_->SetWriteCallback([this](uint16_t offset, const uint8_t* data, uint16_t size) {
-		return HandleUserDescriptionWrite(offset, data, size);
-	});
 }
 
 void Characteristic::SyncUserDescriptionTextFromAttribute() {
@@ -571,18 +1160,14 @@ Attribute* Characteristic::GetDescriptor(size_t index) {
 	if(index >= descriptors_.size()) {
 		return nullptr;
 	}
-	auto it = descriptors_.begin();
-	std::advance(it, index);
-	return &(*it);
+	return &descriptors_[index];
 }
 
 const Attribute* Characteristic::GetDescriptor(size_t index) const {
 	if(index >= descriptors_.size()) {
 		return nullptr;
 	}
-	auto it = descriptors_.begin();
-	std::advance(it, index);
-	return &(*it);
+	return &descriptors_[index];
 }
 
 std::ostream& operator<<(std::ostream& os, Characteristic::Properties props) {
@@ -716,7 +1301,7 @@ std::ostream& operator<<(std::ostream& os, const Characteristic& characteristic)
 				os << " (Indications Enabled)";
 			}
 		}
-		os << "\n";
+		os << ", Subscribers: " << characteristic.GetSubscriberCount() << "\n";
 	}
 
 	// Print SCCD if present
@@ -800,6 +1385,44 @@ std::ostream& operator<<(std::ostream& os, const Characteristic& characteristic)
 	os << "}";
 	return os;
 }
+// ========== Memory Footprint ==========
+
+size_t Characteristic::GetMemoryUsage() const {
+	// Attributes embedded in the object only add their heap-stored values
+	size_t bytes = sizeof(Characteristic);
+	bytes += declaration_attr_.GetMemoryUsage() - sizeof(Attribute);
+	bytes += value_attr_.GetMemoryUsage() - sizeof(Attribute);
+	for(const auto* descriptor: {cccd_.get(), sccd_.get(), extended_properties_.get(), user_description_.get()}) {
+		if(descriptor != nullptr) {
+			bytes += descriptor->GetMemoryUsage();
+		}
+	}
+	bytes += (descriptors_.capacity() - descriptors_.size()) * sizeof(Attribute);
+	for(const auto& descriptor: descriptors_) {
+		bytes += descriptor.GetMemoryUsage();
+	}
+	if(user_description_text_.capacity() > std::string().capacity()) {
+		bytes += user_description_text_.capacity() + 1;
+	}
+	bytes += event_handlers_.capacity() * sizeof(EventHandler*);
+	bytes += last_sent_value_.capacity();
+	bytes += subscriptions_.capacity() * sizeof(Subscription);
+	if(notification_queue_) {
+		bytes += sizeof(NotificationQueue) +
+				 notification_queue_->GetCapacity() * (notification_queue_->GetMaxPayloadSize() + sizeof(uint16_t));
+	}
+	if(read_cache_) {
+		bytes += sizeof(ReadCache) + read_cache_->snapshots.capacity() * sizeof(ReadCache::Snapshot);
+		for(const auto& snapshot: read_cache_->snapshots) {
+			bytes += snapshot.value.GetHeapCapacity();
+		}
+	}
+	if(ingest_) {
+		bytes += sizeof(IngestChannel) + ingest_->GetBufferSize();
+	}
+	return bytes;
+}
+
 // ========== Event Handler Management ==========
 
 void Characteristic::AddEventHandler(EventHandler& handler) {
@@ -821,60 +1444,71 @@ void Characteristic::ClearEventHandlers() {
 
 // ========== Internal descriptor write handlers ==========
 
-BleError Characteristic::HandleCccdWrite(uint16_t offset, const uint8_t* data, uint16_t size) const {
-	if(offset != 0 || data == nullptr || size != 2) {
-		C7222_BLE_DEBUG_PRINT("[BLE] CCCD write rejected: invalid length (offset=%u size=%u)\n",
-			static_cast<unsigned>(offset), static_cast<unsigned>(size));
-		return BleError::kAttErrorInvalidAttrValueLength;
-	}
-
+Characteristic::SecurityLevel Characteristic::GetDescriptorSecurityLevel() const {
 	const auto read_level = GetReadSecurityLevel();
 	const auto write_level = GetWriteSecurityLevel();
-	const auto required_level =
-		static_cast<uint8_t>(read_level) > static_cast<uint8_t>(write_level) ? read_level
-																			 : write_level;
-	const bool requires_sc = ReadRequiresSC() || WriteRequiresSC();
+	return static_cast<uint8_t>(read_level) > static_cast<uint8_t>(write_level) ? read_level : write_level;
+}
+
+BleError Characteristic::CheckConnectionSecurity(SecurityLevel required_level,
+												 bool requires_sc,
+												 const char* what) const {
+	(void)what;
+	if(required_level == SecurityLevel::kNone) {
+		return BleError::kSuccess;
+	}
 	auto* server = AttributeServer::GetInstance();
+	const uint16_t connection = GetRequestConnectionHandle();
 	const uint8_t security_level =
-		server != nullptr ? server->GetSecurityLevel(connection_handle_) : 0;
+		server != nullptr ? server->GetSecurityLevel(connection) : 0;
 	const bool authorized =
-		server != nullptr ? server->IsAuthorizationGranted(connection_handle_) : false;
-
-	if(required_level != SecurityLevel::kNone) {
-		if(requires_sc && security_level < 3) {
-			C7222_BLE_DEBUG_PRINT("[BLE] CCCD write rejected: SC required (sec=%u)\n",
-				static_cast<unsigned>(security_level));
-			return BleError::kAttErrorInsufficientAuthentication;
-		}
-		if(required_level == SecurityLevel::kEncryptionRequired && security_level < 1) {
-			C7222_BLE_DEBUG_PRINT("[BLE] CCCD write rejected: encryption required (sec=%u)\n",
-				static_cast<unsigned>(security_level));
-			return BleError::kAttErrorInsufficientEncryption;
-		}
-		if(required_level == SecurityLevel::kAuthenticationRequired && security_level < 2) {
-			C7222_BLE_DEBUG_PRINT("[BLE] CCCD write rejected: authentication required (sec=%u)\n",
-				static_cast<unsigned>(security_level));
+		server != nullptr ? server->IsAuthorizationGranted(connection) : false;
+
+	if(requires_sc && security_level < 3) {
+		C7222_BLE_DEBUG_PRINT("[BLE] %s write rejected: SC required (sec=%u)\n",
+			what, static_cast<unsigned>(security_level));
+		return BleError::kAttErrorInsufficientAuthentication;
+	}
+	if(required_level == SecurityLevel::kEncryptionRequired && security_level < 1) {
+		C7222_BLE_DEBUG_PRINT("[BLE] %s write rejected: encryption required (sec=%u)\n",
+			what, static_cast<unsigned>(security_level));
+		return BleError::kAttErrorInsufficientEncryption;
+	}
+	if(required_level == SecurityLevel::kAuthenticationRequired && security_level < 2) {
+		C7222_BLE_DEBUG_PRINT("[BLE] %s write rejected: authentication required (sec=%u)\n",
+			what, static_cast<unsigned>(security_level));
+		return BleError::kAttErrorInsufficientAuthentication;
+	}
+	if(required_level == SecurityLevel::kAuthorizationRequired) {
+		if(security_level < 2) {
+			C7222_BLE_DEBUG_PRINT("[BLE] %s write rejected: authorization required (sec=%u)\n",
+				what, static_cast<unsigned>(security_level));
 			return BleError::kAttErrorInsufficientAuthentication;
 		}
-		if(required_level == SecurityLevel::kAuthorizationRequired) {
-			if(security_level < 2) {
-				C7222_BLE_DEBUG_PRINT("[BLE] CCCD write rejected: authorization required (sec=%u)\n",
-					static_cast<unsigned>(security_level));
-				return BleError::kAttErrorInsufficientAuthentication;
-			}
-			if(!authorized) {
-				C7222_BLE_DEBUG_PRINT("[BLE] CCCD write rejected: authorization not granted\n");
-				return BleError::kAttErrorInsufficientAuthorization;
-			}
+		if(!authorized) {
+			C7222_BLE_DEBUG_PRINT("[BLE] %s write rejected: authorization not granted\n", what);
+			return BleError::kAttErrorInsufficientAuthorization;
 		}
 	}
+	return BleError::kSuccess;
+}
 
-	uint16_t old_config = 0;
-	const uint8_t* current = cccd_ ? cccd_->GetValueData() : nullptr;
-	if(current) {
-		old_config = *reinterpret_cast<const uint16_t*>(current);
+BleError Characteristic::HandleCccdWrite(uint16_t offset, const uint8_t* data, uint16_t size) const {
+	if(offset != 0 || data == nullptr || size != 2) {
+		C7222_BLE_DEBUG_PRINT("[BLE] CCCD write rejected: invalid length (offset=%u size=%u)\n",
+			static_cast<unsigned>(offset), static_cast<unsigned>(size));
+		return BleError::kAttErrorInvalidAttrValueLength;
+	}
+
+	const BleError security = CheckConnectionSecurity(GetDescriptorSecurityLevel(), ReadRequiresSC() || WriteRequiresSC(), "CCCD");
+	if(security != BleError::kSuccess) {
+		return security;
 	}
 
+	const uint16_t connection = GetRequestConnectionHandle();
+	const Subscription* subscription = FindSubscription(connection);
+	const uint16_t old_config = subscription != nullptr ? subscription->config : 0;
+
 	uint16_t new_config = *reinterpret_cast<const uint16_t*>(data);
 
 	bool old_notify = (old_config & static_cast<uint16_t>(CCCDProperties::kNotifications)) != 0;
@@ -883,8 +1517,9 @@ BleError Characteristic::HandleCccdWrite(uint16_t offset, const uint8_t* data, u
 	bool new_indicate = (new_config & static_cast<uint16_t>(CCCDProperties::kIndications)) != 0;
 
 	C7222_BLE_DEBUG_PRINT(
-		"[BLE] CCCD write accepted: handle=0x%04x old=0x%04x new=0x%04x notify=%u indicate=%u\n",
+		"[BLE] CCCD write accepted: handle=0x%04x conn=0x%04x old=0x%04x new=0x%04x notify=%u indicate=%u\n",
 		static_cast<unsigned>(value_attr_.GetHandle()),
+		static_cast<unsigned>(connection),
 		static_cast<unsigned>(old_config),
 		static_cast<unsigned>(new_config),
 		static_cast<unsigned>(new_notify),
@@ -922,6 +1557,21 @@ BleError Characteristic::HandleCccdWrite(uint16_t offset, const uint8_t* data, u
 	return BleError::kSuccess;	// success
 }
 
+uint16_t Characteristic::HandleCccdRead(uint16_t offset, uint8_t* buffer, uint16_t buffer_size) const {
+	const Subscription* subscription = FindSubscription(GetRequestConnectionHandle());
+	const uint16_t config = subscription != nullptr ? subscription->config : 0;
+	const uint8_t cccd_bytes[2] = {static_cast<uint8_t>(config & 0xFF), static_cast<uint8_t>((config >> 8) & 0xFF)};
+	if(offset >= sizeof(cccd_bytes)) {
+		return 0;
+	}
+	const uint16_t bytes_to_copy =
+		std::min(static_cast<uint16_t>(sizeof(cccd_bytes) - offset), buffer_size);
+	if(buffer != nullptr && bytes_to_copy > 0) {
+		std::copy(cccd_bytes + offset, cccd_bytes + offset + bytes_to_copy, buffer);
+	}
+	return bytes_to_copy;
+}
+
 BleError Characteristic::HandleSccdWrite(uint16_t offset, const uint8_t* data, uint16_t size) const {
 	if(offset != 0 || data == nullptr || size != 2) {
 		C7222_BLE_DEBUG_PRINT("[BLE] SCCD write rejected: invalid length (offset=%u size=%u)\n",
@@ -929,45 +1579,9 @@ BleError Characteristic::HandleSccdWrite(uint16_t offset, const uint8_t* data, u
 		return BleError::kAttErrorInvalidAttrValueLength;
 	}
 
-	const auto read_level = GetReadSecurityLevel();
-	const auto write_level = GetWriteSecurityLevel();
-	const auto required_level =
-		static_cast<uint8_t>(read_level) > static_cast<uint8_t>(write_level) ? read_level
-																			 : write_level;
-	const bool requires_sc = ReadRequiresSC() || WriteRequiresSC();
-	auto* server = AttributeServer::GetInstance();
-	const uint8_t security_level =
-		server != nullptr ? server->GetSecurityLevel(connection_handle_) : 0;
-	const bool authorized =
-		server != nullptr ? server->IsAuthorizationGranted(connection_handle_) : false;
-
-	if(required_level != SecurityLevel::kNone) {
-		if(requires_sc && security_level < 3) {
-			C7222_BLE_DEBUG_PRINT("[BLE] SCCD write rejected: SC required (sec=%u)\n",
-				static_cast<unsigned>(security_level));
-			return BleError::kAttErrorInsufficientAuthentication;
-		}
-		if(required_level == SecurityLevel::kEncryptionRequired && security_level < 1) {
-			C7222_BLE_DEBUG_PRINT("[BLE] SCCD write rejected: encryption required (sec=%u)\n",
-				static_cast<unsigned>(security_level));
-			return BleError::kAttErrorInsufficientEncryption;
-		}
-		if(required_level == SecurityLevel::kAuthenticationRequired && security_level < 2) {
-			C7222_BLE_DEBUG_PRINT("[BLE] SCCD write rejected: authentication required (sec=%u)\n",
-				static_cast<unsigned>(security_level));
-			return BleError::kAttErrorInsufficientAuthentication;
-		}
-		if(required_level == SecurityLevel::kAuthorizationRequired) {
-			if(security_level < 2) {
-				C7222_BLE_DEBUG_PRINT("[BLE] SCCD write rejected: authorization required (sec=%u)\n",
-					static_cast<unsigned>(security_level));
-				return BleError::kAttErrorInsufficientAuthentication;
-			}
-			if(!authorized) {
-				C7222_BLE_DEBUG_PRINT("[BLE] SCCD write rejected: authorization not granted\n");
-				return BleError::kAttErrorInsufficientAuthorization;
-			}
-		}
+	const BleError security = CheckConnectionSecurity(GetDescriptorSecurityLevel(), ReadRequiresSC() || WriteRequiresSC(), "SCCD");
+	if(security != BleError::kSuccess) {
+		return security;
 	}
 
 	uint16_t old_config = 0;
@@ -1040,16 +1654,37 @@ uint16_t Characteristic::HandleValueRead(uint16_t offset, uint8_t* buffer, uint1
 		return static_cast<uint16_t>(BleError::kAttErrorReadNotPermitted);
 	}
 
-	// Notify OnRead handlers that a read is happening
-	for(auto* handler: event_handlers_) {
-		if(handler) {
-			handler->OnRead();
+	const uint8_t* current_data = nullptr;
+	size_t current_size = 0;
+	if(read_cache_) {
+		// Refresh only at the start of a logical read; blob chunks keep the
+		// requesting connection's snapshot, whatever other clients read meanwhile
+		const uint16_t connection = GetRequestConnectionHandle();
+		ReadCache::Snapshot* snapshot = FindReadSnapshot(connection);
+		if(snapshot == nullptr || (offset == 0 && !IsReadCacheFresh())) {
+			if(offset == 0) {
+				for(auto* handler: event_handlers_) {
+					if(handler) {
+						handler->OnRead();
+					}
+				}
+			}
+			snapshot = &RefreshReadSnapshot(connection);
+		}
+		current_data = snapshot->value.data();
+		current_size = snapshot->value.size();
+	} else {
+		// Notify OnRead handlers that a read is happening
+		for(auto* handler: event_handlers_) {
+			if(handler) {
+				handler->OnRead();
+			}
 		}
-	}
 
-	// Return current stored value
-	const uint8_t* current_data = GetValueData();
-	size_t current_size = GetValueSize();
+		// Return current stored value
+		current_data = GetValueData();
+		current_size = GetValueSize();
+	}
 
 	if(current_data != nullptr && current_size > 0) {
 		if(offset >= current_size) {
@@ -1085,180 +1720,229 @@ BleError Characteristic::HandleValueWrite(uint16_t offset, const uint8_t* data,
 		return BleError::kAttErrorInvalidAttrValueLength;
 	}
 
-	// Store the data in the value attribute
-	if(!value_attr_.SetValue(data, size)) {
-		return BleError::kAttErrorInvalidAttrValueLength;
+	// Store the data in the value attribute unless the handlers consume it
+	if(store_written_value_) {
+		if(!value_attr_.SetValue(data, size)) {
+			return BleError::kAttErrorInvalidAttrValueLength;
+		}
+		PersistValue();
 	}
+	InvalidateReadCache();
 
-	// Create vector from the incoming data for notification
-	std::vector<uint8_t> write_data(data, data + size);
-
-	// Notify OnWrite handlers
+	// Notify OnWrite handlers with a view of the ATT buffer
 	for(auto* handler: event_handlers_) {
 		if(handler) {
-			handler->OnWrite(write_data);
+			handler->OnWrite(data, size);
 		}
 	}
 
 	return BleError::kSuccess;	// success
 }
 
-uint16_t Characteristic::HandleAttributeRead(uint16_t attribute_handle,
-											 uint16_t offset,
-											 uint8_t* buffer,
-											 uint16_t buffer_size) {
-	// Check declaration attribute
-	if(declaration_attr_.GetHandle() == attribute_handle) {
-		// Verify read permission
-		if((declaration_attr_.GetProperties() &
-			static_cast<uint16_t>(Attribute::Properties::kRead)) == 0) {
-			return static_cast<uint16_t>(BleError::kAttErrorReadNotPermitted);
-		}
-		return declaration_attr_.InvokeReadCallback(offset, buffer, buffer_size);
+Attribute* Characteristic::FindAttributeByHandle(uint16_t handle) {
+	if(handle == 0) {
+		return nullptr;
 	}
-
-	// Check value attribute
-	if(value_attr_.GetHandle() == attribute_handle) {
-		// Verify read permission
-		if((value_attr_.GetProperties() & static_cast<uint16_t>(Attribute::Properties::kRead)) ==
-		   0) {
-			return static_cast<uint16_t>(BleError::kAttErrorReadNotPermitted);
+	for(Attribute* attribute: {&declaration_attr_, &value_attr_, cccd_.get(), sccd_.get(),
+							   extended_properties_.get(), user_description_.get()}) {
+		if(attribute != nullptr && attribute->GetHandle() == handle) {
+			return attribute;
 		}
-		return value_attr_.InvokeReadCallback(offset, buffer, buffer_size);
 	}
-
-	// Check CCCD
-	if(cccd_ && cccd_->GetHandle() == attribute_handle) {
-		// Verify read permission
-		if((cccd_->GetProperties() & static_cast<uint16_t>(Attribute::Properties::kRead)) == 0) {
-			return static_cast<uint16_t>(BleError::kAttErrorReadNotPermitted);
+	for(auto& descriptor: descriptors_) {
+		if(descriptor.GetHandle() == handle) {
+			return &descriptor;
 		}
-		return cccd_->InvokeReadCallback(offset, buffer, buffer_size);
 	}
+	return nullptr;
+}
 
-	// Check SCCD
-	if(sccd_ && sccd_->GetHandle() == attribute_handle) {
-		// Verify read permission
-		if((sccd_->GetProperties() & static_cast<uint16_t>(Attribute::Properties::kRead)) == 0) {
-			return static_cast<uint16_t>(BleError::kAttErrorReadNotPermitted);
-		}
-		return sccd_->InvokeReadCallback(offset, buffer, buffer_size);
+Characteristic::AttributeRole Characteristic::GetAttributeRole(const Attribute& attribute) const {
+	if(&attribute == &value_attr_) {
+		return AttributeRole::kValue;
 	}
-
-	// Check Extended Properties
-	if(extended_properties_ && extended_properties_->GetHandle() == attribute_handle) {
-		// Verify read permission
-		if((extended_properties_->GetProperties() &
-			static_cast<uint16_t>(Attribute::Properties::kRead)) == 0) {
-			return static_cast<uint16_t>(BleError::kAttErrorReadNotPermitted);
-		}
-		return extended_properties_->InvokeReadCallback(offset, buffer, buffer_size);
+	if(&attribute == &declaration_attr_) {
+		return AttributeRole::kDeclaration;
 	}
-
-	// Check User Description
-	if(user_description_ && user_description_->GetHandle() == attribute_handle) {
-		// Verify read permission
-		if((user_description_->GetProperties() &
-			static_cast<uint16_t>(Attribute::Properties::kRead)) == 0) {
-			return static_cast<uint16_t>(BleError::kAttErrorReadNotPermitted);
-		}
-		return user_description_->InvokeReadCallback(offset, buffer, buffer_size);
+	if(&attribute == cccd_.get()) {
+		return AttributeRole::kCccd;
 	}
-
-	// Check custom descriptors
-	for(auto& descriptor: descriptors_) {
-		if(descriptor.GetHandle() == attribute_handle) {
-			// Verify read permission
-			if((descriptor.GetProperties() & static_cast<uint16_t>(Attribute::Properties::kRead)) ==
-			   0) {
-				return static_cast<uint16_t>(BleError::kAttErrorReadNotPermitted);
-			}
-			return descriptor.InvokeReadCallback(offset, buffer, buffer_size);
+	if(&attribute == sccd_.get()) {
+		return AttributeRole::kSccd;
+	}
+	if(&attribute == extended_properties_.get()) {
+		return AttributeRole::kExtendedProperties;
+	}
+	if(&attribute == user_description_.get()) {
+		return AttributeRole::kUserDescription;
+	}
+	for(const auto& descriptor: descriptors_) {
+		if(&attribute == &descriptor) {
+			return AttributeRole::kDescriptor;
 		}
 	}
+	return AttributeRole::kNone;
+}
 
-	return 0;
+uint16_t Characteristic::HandleAttributeRead(uint16_t attribute_handle,
+											 uint16_t offset,
+											 uint8_t* buffer,
+											 uint16_t buffer_size) {
+	const Attribute* attribute = FindAttributeByHandle(attribute_handle);
+	if(attribute == nullptr) {
+		return 0;
+	}
+	return DispatchAttributeRead(GetAttributeRole(*attribute), *attribute, offset, buffer, buffer_size);
 }
 
 BleError Characteristic::HandleAttributeWrite(uint16_t attribute_handle,
 											  uint16_t offset,
 											  const uint8_t* data,
 											  uint16_t size) {
-	// Check value attribute
-	if(value_attr_.GetHandle() == attribute_handle) {
-		// Verify write permission
-		uint16_t props = value_attr_.GetProperties();
-		if((props & static_cast<uint16_t>(Attribute::Properties::kWrite)) == 0 &&
-		   (props & static_cast<uint16_t>(Attribute::Properties::kWriteWithoutResponse)) == 0 &&
-		   (props & static_cast<uint16_t>(Attribute::Properties::kAuthenticatedSignedWrite)) == 0) {
-			return BleError::kAttErrorWriteNotPermitted;
-		}
-		return value_attr_.InvokeWriteCallback(offset, data, size);
+	Attribute* attribute = FindAttributeByHandle(attribute_handle);
+	if(attribute == nullptr || attribute == &declaration_attr_) {
+		return BleError::kSuccess;
 	}
+	return DispatchAttributeWrite(GetAttributeRole(*attribute), *attribute, offset, data, size);
+}
 
-	// Check CCCD
-	if(cccd_ && cccd_->GetHandle() == attribute_handle) {
-		// Verify write permission
-		uint16_t props = cccd_->GetProperties();
-		if((props & static_cast<uint16_t>(Attribute::Properties::kWrite)) == 0 &&
-		   (props & static_cast<uint16_t>(Attribute::Properties::kWriteWithoutResponse)) == 0 &&
-		   (props & static_cast<uint16_t>(Attribute::Properties::kAuthenticatedSignedWrite)) == 0) {
-			return BleError::kAttErrorWriteNotPermitted;
-		}
-		return cccd_->InvokeWriteCallback(offset, data, size);
+uint16_t Characteristic::DispatchAttributeRead(AttributeRole role,
+											   const Attribute& attribute,
+											   uint16_t offset,
+											   uint8_t* buffer,
+											   uint16_t buffer_size) {
+	// Verify read permission
+	if((attribute.GetProperties() & static_cast<uint16_t>(Attribute::Properties::kRead)) == 0) {
+		return static_cast<uint16_t>(BleError::kAttErrorReadNotPermitted);
 	}
 
-	// Check SCCD
-	if(sccd_ && sccd_->GetHandle() == attribute_handle) {
-		// Verify write permission
-		uint16_t props = sccd_->GetProperties();
-		if((props & static_cast<uint16_t>(Attribute::Properties::kWrite)) == 0 &&
-		   (props & static_cast<uint16_t>(Attribute::Properties::kWriteWithoutResponse)) == 0 &&
-		   (props & static_cast<uint16_t>(Attribute::Properties::kAuthenticatedSignedWrite)) == 0) {
-			return BleError::kAttErrorWriteNotPermitted;
-		}
-		return sccd_->InvokeWriteCallback(offset, data, size);
+	// An application callback replaces the internal handler
+	if(attribute.HasReadCallback()) {
+		return attribute.InvokeReadCallback(offset, buffer, buffer_size);
 	}
 
-	// Check Extended Properties
-	if(extended_properties_ && extended_properties_->GetHandle() == attribute_handle) {
-		// Verify write permission
-		uint16_t props = extended_properties_->GetProperties();
-		if((props & static_cast<uint16_t>(Attribute::Properties::kWrite)) == 0 &&
-		   (props & static_cast<uint16_t>(Attribute::Properties::kWriteWithoutResponse)) == 0 &&
-		   (props & static_cast<uint16_t>(Attribute::Properties::kAuthenticatedSignedWrite)) == 0) {
-			return BleError::kAttErrorWriteNotPermitted;
+	switch(role) {
+	case AttributeRole::kValue:
+		return HandleValueRead(offset, buffer, buffer_size);
+	case AttributeRole::kCccd:
+		return HandleCccdRead(offset, buffer, buffer_size);
+	case AttributeRole::kUserDescription:
+		return HandleUserDescriptionRead(offset, buffer, buffer_size);
+	case AttributeRole::kNone:
+		return 0;
+	default:
+		return attribute.InvokeReadCallback(offset, buffer, buffer_size);
+	}
+}
+
+BleError Characteristic::DispatchAttributeWrite(AttributeRole role,
+												Attribute& attribute,
+												uint16_t offset,
+												const uint8_t* data,
+												uint16_t size) {
+	// Verify write permission
+	const uint16_t props = attribute.GetProperties();
+	if((props & static_cast<uint16_t>(Attribute::Properties::kWrite)) == 0 &&
+	   (props & static_cast<uint16_t>(Attribute::Properties::kWriteWithoutResponse)) == 0 &&
+	   (props & static_cast<uint16_t>(Attribute::Properties::kAuthenticatedSignedWrite)) == 0) {
+		return BleError::kAttErrorWriteNotPermitted;
+	}
+
+	// An application callback replaces the internal handler
+	if(attribute.HasWriteCallback()) {
+		return attribute.InvokeWriteCallback(offset, data, size);
+	}
+
+	switch(role) {
+	case AttributeRole::kValue:
+		if(ingest_) {
+			// Straight into the stream buffer; the value only holds credit reports
+			const BleError status =
+				offset == 0 ? ingest_->Write(GetRequestConnectionHandle(), data, size) : BleError::kAttErrorInvalidOffset;
+			if(ingest_->TakeReportDue()) {
+				SendIngestCreditReport();
+			}
+			return status;
+		}
+		// HandleValueWrite() stores the value itself
+		return HandleValueWrite(offset, data, size);
+	case AttributeRole::kCccd: {
+		BleError status = HandleCccdWrite(offset, data, size);
+		if(status == BleError::kSuccess) {
+			status = attribute.InvokeWriteCallback(offset, data, size);
+		}
+		if(status == BleError::kSuccess) {
+			// Each client owns its configuration; the attribute keeps the union
+			SetSubscription(GetRequestConnectionHandle(),
+							static_cast<uint16_t>(data[0] | (static_cast<uint16_t>(data[1]) << 8)));
+		}
+		const uint16_t connection = GetRequestConnectionHandle();
+		if(status == BleError::kSuccess && ingest_ && IsNotificationsEnabled(connection) && ingest_->Bind(connection)) {
+			SendIngestCreditReport();	// initial credit grant
 		}
-		return extended_properties_->InvokeWriteCallback(offset, data, size);
+		return status;
+	}
+	case AttributeRole::kSccd: {
+		const BleError status = HandleSccdWrite(offset, data, size);
+		return status == BleError::kSuccess ? attribute.InvokeWriteCallback(offset, data, size) : status;
+	}
+	case AttributeRole::kUserDescription:
+		return HandleUserDescriptionWrite(offset, data, size);
+	case AttributeRole::kNone:
+		return BleError::kSuccess;
+	default:
+		return attribute.InvokeWriteCallback(offset, data, size);
+	}
+}
+
+BleError Characteristic::CheckAttributeWriteAccess(AttributeRole role, const Attribute& attribute) const {
+	const uint16_t props = attribute.GetProperties();
+	if((props & static_cast<uint16_t>(Attribute::Properties::kWrite)) == 0 &&
+	   (props & static_cast<uint16_t>(Attribute::Properties::kWriteWithoutResponse)) == 0 &&
+	   (props & static_cast<uint16_t>(Attribute::Properties::kAuthenticatedSignedWrite)) == 0) {
+		return BleError::kAttErrorWriteNotPermitted;
 	}
 
-	// Check User Description
-	if(user_description_ && user_description_->GetHandle() == attribute_handle) {
-		// Verify write permission
-		uint16_t props = user_description_->GetProperties();
-		if((props & static_cast<uint16_t>(Attribute::Properties::kWrite)) == 0 &&
-		   (props & static_cast<uint16_t>(Attribute::Properties::kWriteWithoutResponse)) == 0 &&
-		   (props & static_cast<uint16_t>(Attribute::Properties::kAuthenticatedSignedWrite)) == 0) {
+	if(role == AttributeRole::kValue) {
+		// The value's ATT permission bits apply whoever handles the write
+		const BleError security = CheckConnectionSecurity(GetWriteSecurityLevel(), WriteRequiresSC(), "Value");
+		if(security != BleError::kSuccess || attribute.HasWriteCallback()) {
+			return security;
+		}
+		const uint8_t char_props = static_cast<uint8_t>(properties_);
+		if((char_props & static_cast<uint8_t>(Properties::kWrite)) == 0 &&
+		   (char_props & static_cast<uint8_t>(Properties::kWriteWithoutResponse)) == 0 &&
+		   (char_props & static_cast<uint8_t>(Properties::kAuthenticatedSignedWrites)) == 0) {
 			return BleError::kAttErrorWriteNotPermitted;
 		}
-		return user_description_->InvokeWriteCallback(offset, data, size);
+		return BleError::kSuccess;
 	}
 
-	// Check custom descriptors
-	for(auto& descriptor: descriptors_) {
-		if(descriptor.GetHandle() == attribute_handle) {
-			// Verify write permission
-			uint16_t props = descriptor.GetProperties();
-			if((props & static_cast<uint16_t>(Attribute::Properties::kWrite)) == 0 &&
-			   (props & static_cast<uint16_t>(Attribute::Properties::kWriteWithoutResponse)) == 0 &&
-			   (props & static_cast<uint16_t>(Attribute::Properties::kAuthenticatedSignedWrite)) ==
-				   0) {
-				return BleError::kAttErrorWriteNotPermitted;
-			}
-			return descriptor.InvokeWriteCallback(offset, data, size);
-		}
+	// An application callback replaces the internal descriptor handlers
+	if(attribute.HasWriteCallback()) {
+		return BleError::kSuccess;
 	}
+	switch(role) {
+	case AttributeRole::kCccd:
+		return CheckConnectionSecurity(GetDescriptorSecurityLevel(), ReadRequiresSC() || WriteRequiresSC(), "CCCD");
+	case AttributeRole::kSccd:
+		return CheckConnectionSecurity(GetDescriptorSecurityLevel(), ReadRequiresSC() || WriteRequiresSC(), "SCCD");
+	case AttributeRole::kUserDescription:
+		return BleError::kAttErrorWriteNotPermitted;
+	default:
+		return BleError::kSuccess;
+	}
+}
 
+BleError Characteristic::CheckAttributeWriteValue(AttributeRole role,
+												  const Attribute& attribute,
+												  uint16_t size) const {
+	if(attribute.HasWriteCallback()) {
+		return BleError::kSuccess;
+	}
+	if((role == AttributeRole::kCccd || role == AttributeRole::kSccd) && size != 2) {
+		return BleError::kAttErrorInvalidAttrValueLength;
+	}
 	return BleError::kSuccess;
 }
 
@@ -0,0 +1,65 @@
+#include "compact_uuid.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <vector>
+
+namespace c7222 {
+namespace {
+
+std::vector<std::array<uint8_t, 16>>& Uuid128Table() {
+	static std::vector<std::array<uint8_t, 16>> table;
+	return table;
+}
+
+}  // namespace
+
+CompactUuid::CompactUuid(const Uuid& uuid) : type_(uuid.type()) {
+	if(uuid.Is16Bit()) {
+		value_ = uuid.Get16Bit();
+	} else if(uuid.Is128Bit()) {
+		auto& table = Uuid128Table();
+		const auto& bytes = uuid.Get128Bit();
+		auto it = std::find(table.begin(), table.end(), bytes);
+		if(it == table.end()) {
+			assert(table.size() < UINT16_MAX && "128-bit UUID table full");
+			it = table.insert(table.end(), bytes);
+		}
+		value_ = static_cast<uint16_t>(it - table.begin());
+	}
+}
+
+Uuid CompactUuid::ToUuid() const {
+	switch(type_) {
+	case Uuid::Type::k16Bit:
+		return Uuid(value_);
+	case Uuid::Type::k128Bit:
+		return Uuid(Uuid128Table()[value_]);
+	default:
+		return Uuid();
+	}
+}
+
+bool CompactUuid::operator==(const Uuid& uuid) const {
+	if(type_ != uuid.type()) {
+		return false;
+	}
+	if(type_ == Uuid::Type::k16Bit) {
+		return value_ == uuid.Get16Bit();
+	}
+	if(type_ == Uuid::Type::k128Bit) {
+		return Uuid128Table()[value_] == uuid.Get128Bit();
+	}
+	return false;
+}
+
+size_t CompactUuid::GetTableSize() {
+	return Uuid128Table().size();
+}
+
+size_t CompactUuid::GetTableMemoryUsage() {
+	return Uuid128Table().capacity() * sizeof(std::array<uint8_t, 16>);
+}
+
+}  // namespace c7222
@@ -0,0 +1,203 @@
+#include "database_hash.hpp"
+
+#include <algorithm>
+
+namespace c7222 {
+
+namespace {
+
+constexpr size_t kRounds = 10;
+constexpr uint8_t kCmacRb = 0x87;
+
+constexpr std::array<uint8_t, 256> kSbox = {
+	0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+	0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+	0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+	0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+	0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+	0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+	0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+	0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+	0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+	0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+	0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+	0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+	0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+	0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+	0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+	0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+uint8_t Xtime(uint8_t value) {
+	return static_cast<uint8_t>((value << 1) ^ ((value & 0x80) != 0 ? 0x1b : 0x00));
+}
+
+void AddRoundKey(DatabaseHash::Block& state, const uint8_t* round_key) {
+	for(size_t i = 0; i < DatabaseHash::kSize; ++i) {
+		state[i] ^= round_key[i];
+	}
+}
+
+void SubBytesShiftRows(DatabaseHash::Block& state) {
+	// State is column-major: byte (row r, column c) lives at index 4 * c + r.
+	DatabaseHash::Block shifted{};
+	for(size_t c = 0; c < 4; ++c) {
+		for(size_t r = 0; r < 4; ++r) {
+			shifted[4 * c + r] = kSbox[state[4 * ((c + r) % 4) + r]];
+		}
+	}
+	state = shifted;
+}
+
+void MixColumns(DatabaseHash::Block& state) {
+	for(size_t c = 0; c < 4; ++c) {
+		uint8_t* column = &state[4 * c];
+		const uint8_t all = static_cast<uint8_t>(column[0] ^ column[1] ^ column[2] ^ column[3]);
+		const uint8_t first = column[0];
+		column[0] ^= static_cast<uint8_t>(all ^ Xtime(static_cast<uint8_t>(column[0] ^ column[1])));
+		column[1] ^= static_cast<uint8_t>(all ^ Xtime(static_cast<uint8_t>(column[1] ^ column[2])));
+		column[2] ^= static_cast<uint8_t>(all ^ Xtime(static_cast<uint8_t>(column[2] ^ column[3])));
+		column[3] ^= static_cast<uint8_t>(all ^ Xtime(static_cast<uint8_t>(column[3] ^ first)));
+	}
+}
+
+// Left shift by one bit; returns the bit shifted out.
+bool ShiftLeft(DatabaseHash::Block& block) {
+	const bool carry = (block[0] & 0x80) != 0;
+	for(size_t i = 0; i < DatabaseHash::kSize; ++i) {
+		const uint8_t next = i + 1 < DatabaseHash::kSize ? block[i + 1] : 0;
+		block[i] = static_cast<uint8_t>((block[i] << 1) | (next >> 7));
+	}
+	return carry;
+}
+
+void AppendLe16(std::vector<uint8_t>& message, uint16_t value) {
+	message.push_back(static_cast<uint8_t>(value & 0xFF));
+	message.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+}  // namespace
+
+bool DatabaseHash::IsHashed(const Uuid& type) {
+	if(!type.Is16Bit()) {
+		return false;
+	}
+	switch(static_cast<Uuid::AttributeType>(type.Get16Bit())) {
+	case Uuid::AttributeType::kPrimaryServiceDeclaration:
+	case Uuid::AttributeType::kSecondaryServiceDeclaration:
+	case Uuid::AttributeType::kIncludedServiceDeclaration:
+	case Uuid::AttributeType::kCharacteristicDeclaration:
+	case Uuid::AttributeType::kCharacteristicExtendedProperties:
+	case Uuid::AttributeType::kCharacteristicUserDescription:
+	case Uuid::AttributeType::kClientCharacteristicConfiguration:
+	case Uuid::AttributeType::kServerCharacteristicConfiguration:
+	case Uuid::AttributeType::kCharacteristicPresentationFormat:
+	case Uuid::AttributeType::kCharacteristicAggregateFormat:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool DatabaseHash::IsValueHashed(const Uuid& type) {
+	if(!type.Is16Bit()) {
+		return false;
+	}
+	switch(static_cast<Uuid::AttributeType>(type.Get16Bit())) {
+	case Uuid::AttributeType::kPrimaryServiceDeclaration:
+	case Uuid::AttributeType::kSecondaryServiceDeclaration:
+	case Uuid::AttributeType::kIncludedServiceDeclaration:
+	case Uuid::AttributeType::kCharacteristicDeclaration:
+	case Uuid::AttributeType::kCharacteristicExtendedProperties:
+		return true;
+	default:
+		return false;
+	}
+}
+
+void DatabaseHash::AddAttribute(uint16_t handle, const Uuid& type, const uint8_t* value, size_t size) {
+	if(!IsHashed(type)) {
+		return;
+	}
+	AppendLe16(message_, handle);
+	AppendLe16(message_, type.Get16Bit());
+	if(IsValueHashed(type) && value != nullptr) {
+		message_.insert(message_.end(), value, value + size);
+	}
+}
+
+DatabaseHash::Value DatabaseHash::Finish() const {
+	const Block cmac = AesCmac(Block{}, message_.data(), message_.size());
+	Value value{};
+	std::reverse_copy(cmac.begin(), cmac.end(), value.begin());
+	return value;
+}
+
+DatabaseHash::Block DatabaseHash::Aes128Encrypt(const Block& key, const Block& plaintext) {
+	std::array<uint8_t, kSize*(kRounds + 1)> round_keys{};
+	std::copy(key.begin(), key.end(), round_keys.begin());
+	uint8_t rcon = 0x01;
+	for(size_t i = kSize; i < round_keys.size(); i += 4) {
+		uint8_t word[4] = {round_keys[i - 4], round_keys[i - 3], round_keys[i - 2], round_keys[i - 1]};
+		if(i % kSize == 0) {
+			const uint8_t first = word[0];
+			word[0] = static_cast<uint8_t>(kSbox[word[1]] ^ rcon);
+			word[1] = kSbox[word[2]];
+			word[2] = kSbox[word[3]];
+			word[3] = kSbox[first];
+			rcon = Xtime(rcon);
+		}
+		for(size_t j = 0; j < 4; ++j) {
+			round_keys[i + j] = static_cast<uint8_t>(round_keys[i + j - kSize] ^ word[j]);
+		}
+	}
+
+	Block state = plaintext;
+	AddRoundKey(state, round_keys.data());
+	for(size_t round = 1; round <= kRounds; ++round) {
+		SubBytesShiftRows(state);
+		if(round != kRounds) {
+			MixColumns(state);
+		}
+		AddRoundKey(state, &round_keys[round * kSize]);
+	}
+	return state;
+}
+
+DatabaseHash::Block DatabaseHash::AesCmac(const Block& key, const uint8_t* message, size_t size) {
+	// Subkeys K1/K2 (RFC 4493, 2.3)
+	Block k1 = Aes128Encrypt(key, Block{});
+	if(ShiftLeft(k1)) {
+		k1[kSize - 1] ^= kCmacRb;
+	}
+	Block k2 = k1;
+	if(ShiftLeft(k2)) {
+		k2[kSize - 1] ^= kCmacRb;
+	}
+
+	const size_t blocks = size == 0 ? 1 : (size + kSize - 1) / kSize;
+	const bool complete = size != 0 && size % kSize == 0;
+	Block state{};
+	for(size_t i = 0; i + 1 < blocks; ++i) {
+		for(size_t j = 0; j < kSize; ++j) {
+			state[j] ^= message[i * kSize + j];
+		}
+		state = Aes128Encrypt(key, state);
+	}
+
+	// Last block: complete blocks are masked with K1, padded ones with K2.
+	const size_t last_offset = (blocks - 1) * kSize;
+	const size_t last_size = size - last_offset;
+	Block last{};
+	std::copy_n(message + last_offset, last_size, last.begin());
+	if(!complete) {
+		last[last_size] = 0x80;
+	}
+	const Block& subkey = complete ? k1 : k2;
+	for(size_t j = 0; j < kSize; ++j) {
+		state[j] ^= static_cast<uint8_t>(last[j] ^ subkey[j]);
+	}
+	return Aes128Encrypt(key, state);
+}
+
+}  // namespace c7222
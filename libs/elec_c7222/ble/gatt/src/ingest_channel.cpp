@@ -0,0 +1,104 @@
+#include "ingest_channel.hpp"
+
+#include <algorithm>
+
+#include "attribute_server.hpp"
+
+namespace c7222 {
+
+IngestChannel::IngestChannel(size_t buffer_size, size_t report_threshold)
+	: stream_(std::max<size_t>(buffer_size, 1), 1),
+	  buffer_size_(std::max<size_t>(buffer_size, 1)),
+	  report_threshold_(report_threshold == 0 ? std::max<size_t>(buffer_size_ / 4, 1) : report_threshold) {
+}
+
+size_t IngestChannel::Read(void* out, size_t max_size, uint32_t ticks_to_wait) {
+	const size_t received = stream_.Receive(out, max_size, ticks_to_wait);
+	if(received == 0) {
+		return 0;
+	}
+	// Consumer task: the report itself is built on the stack context.
+	const size_t freed = freed_since_report_.fetch_add(received) + received;
+	if(freed >= report_threshold_ && !report_due_.exchange(true)) {
+		auto* server = AttributeServer::GetInstance();
+		if(server != nullptr) {
+			server->RequestStackWork();
+		}
+	}
+	return received;
+}
+
+BleError IngestChannel::Write(uint16_t connection_handle, const uint8_t* data, size_t size) {
+	if(!Bind(connection_handle)) {
+		++foreign_writes_;
+		return BleError::kAttErrorWriteNotPermitted;
+	}
+	if(data == nullptr || size < kHeaderSize) {
+		return BleError::kAttErrorInvalidAttrValueLength;
+	}
+	if(data[0] != next_seq_) {
+		++sequence_errors_;
+		Reject();
+		return BleError::kSuccess;
+	}
+	const size_t payload_size = size - kHeaderSize;
+	// Single producer: the free space can only grow until Send() runs.
+	if(payload_size > stream_.SpacesAvailable()) {
+		++overflows_;
+		Reject();
+		return BleError::kSuccess;
+	}
+	if(payload_size != 0 && stream_.Send(data + kHeaderSize, payload_size, 0) != payload_size) {
+		++overflows_;
+		Reject();
+		return BleError::kSuccess;
+	}
+	++next_seq_;
+	++packets_;
+	bytes_ += static_cast<uint32_t>(payload_size);
+	resync_pending_ = false;
+	return BleError::kSuccess;
+}
+
+void IngestChannel::Reject() {
+	if(!resync_pending_) {
+		resync_pending_ = true;
+		report_due_.store(true);
+	}
+}
+
+void IngestChannel::BuildCreditReport(uint8_t (&out)[kCreditReportSize]) {
+	freed_since_report_.store(0);
+	const size_t free_bytes = std::min<size_t>(stream_.SpacesAvailable(), UINT16_MAX);
+	out[0] = next_seq_;
+	out[1] = static_cast<uint8_t>(free_bytes & 0xFF);
+	out[2] = static_cast<uint8_t>(free_bytes >> 8);
+	++credit_reports_;
+}
+
+bool IngestChannel::Bind(uint16_t connection_handle) {
+	if(owner_connection_ == 0) {
+		owner_connection_ = connection_handle;
+	}
+	return connection_handle != 0 && owner_connection_ == connection_handle;
+}
+
+void IngestChannel::Release(uint16_t connection_handle) {
+	if(connection_handle == 0 || owner_connection_ != connection_handle) {
+		return;
+	}
+	owner_connection_ = 0;
+	next_seq_ = 0;
+	resync_pending_ = false;
+}
+
+void IngestChannel::ResetCounters() {
+	packets_ = 0;
+	bytes_ = 0;
+	overflows_ = 0;
+	sequence_errors_ = 0;
+	foreign_writes_ = 0;
+	credit_reports_ = 0;
+}
+
+}  // namespace c7222
@@ -0,0 +1,56 @@
+#include "notification_queue.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace c7222 {
+
+NotificationQueue::NotificationQueue(size_t capacity, size_t max_payload_size, size_t high_watermark)
+	: capacity_(std::max<size_t>(capacity, 1)),
+	  slot_size_(std::min<size_t>(std::max<size_t>(max_payload_size, 1), UINT16_MAX)),
+	  high_watermark_(high_watermark == 0 || high_watermark > capacity_ ? capacity_ : high_watermark) {
+	storage_.resize(capacity_ * slot_size_);
+	sizes_.resize(capacity_);
+}
+
+bool NotificationQueue::Push(const uint8_t* data, size_t size) {
+	if(count_ == capacity_ || size > slot_size_ || (data == nullptr && size != 0)) {
+		++dropped_;
+		return false;
+	}
+	const size_t slot = (head_ + count_) % capacity_;
+	std::copy(data, data + size, storage_.begin() + static_cast<std::ptrdiff_t>(slot * slot_size_));
+	sizes_[slot] = static_cast<uint16_t>(size);
+	++count_;
+	peak_ = std::max(peak_, count_);
+	return true;
+}
+
+const uint8_t* NotificationQueue::FrontData() const {
+	return count_ == 0 ? nullptr : storage_.data() + head_ * slot_size_;
+}
+
+uint16_t NotificationQueue::FrontSize() const {
+	return count_ == 0 ? 0 : sizes_[head_];
+}
+
+void NotificationQueue::Pop() {
+	assert(count_ != 0 && "Pop() on empty NotificationQueue");
+	head_ = (head_ + 1) % capacity_;
+	--count_;
+	++sent_;
+}
+
+void NotificationQueue::Clear() {
+	dropped_ += static_cast<uint32_t>(count_);
+	head_ = 0;
+	count_ = 0;
+}
+
+void NotificationQueue::ResetCounters() {
+	peak_ = count_;
+	sent_ = 0;
+	dropped_ = 0;
+}
+
+}  // namespace c7222
@@ -18,7 +18,7 @@ Service::Service(const Uuid& uuid, ServiceType service_type, uint16_t declaratio
 
 Service::Service(Attribute&& declaration_attr,
 				 std::vector<Attribute>&& included_service_declarations,
-				 std::list<Characteristic>&& characteristics)
+				 std::vector<Characteristic>&& characteristics)
 	: uuid_(Uuid()),
 	  service_type_(Attribute::IsPrimaryServiceDeclaration(declaration_attr)
 						? ServiceType::kPrimary
@@ -40,8 +40,12 @@ Service::Service(Attribute&& declaration_attr,
 	}
 }
 
-std::list<Service> Service::ParseFromAttributes(std::list<Attribute>& attributes) {
-	std::list<Service> services;
+std::vector<Service> Service::ParseFromAttributes(std::list<Attribute>& attributes) {
+	std::vector<Service> services;
+	services.reserve(static_cast<size_t>(
+		std::count_if(attributes.begin(), attributes.end(), [](const Attribute& attr) {
+			return Attribute::IsServiceDeclaration(attr);
+		})));
 
 	while(true) {
 		while(!attributes.empty() && !Attribute::IsServiceDeclaration(attributes.front())) {
@@ -81,7 +85,11 @@ std::list<Service> Service::ParseFromAttributes(std::list<Attribute>& attributes
 			}
 		}
 
-		std::list<Characteristic> characteristics;
+		std::vector<Characteristic> characteristics;
+		characteristics.reserve(static_cast<size_t>(
+			std::count_if(service_attributes.begin(), service_attributes.end(), [](const Attribute& attr) {
+				return Attribute::IsCharacteristicDeclaration(attr);
+			})));
 		while(!service_attributes.empty()) {
 			auto characteristic = Characteristic::ParseFromAttributes(service_attributes);
 			assert(characteristic && "Failed to parse characteristic from attribute DB");
@@ -98,16 +106,12 @@ std::list<Service> Service::ParseFromAttributes(std::list<Attribute>& attributes
 
 Characteristic& Service::GetCharacteristic(size_t index) {
 	assert(index < characteristics_.size() && "Characteristic index out of range");
-	auto it = characteristics_.begin();
-	std::advance(it, static_cast<long>(index));
-	return *it;
+	return characteristics_[index];
 }
 
 const Characteristic& Service::GetCharacteristic(size_t index) const {
 	assert(index < characteristics_.size() && "Characteristic index out of range");
-	auto it = characteristics_.begin();
-	std::advance(it, static_cast<long>(index));
-	return *it;
+	return characteristics_[index];
 }
 
 std::list<Characteristic*> Service::FindCharacteristicsByProperties(Characteristic::Properties properties) const {
@@ -189,16 +193,12 @@ const Characteristic* Service::FindCharacteristicByHandle(uint16_t handle) const
 
 Service& Service::GetIncludedService(size_t index) {
 	assert(index < included_services_.size() && "Included service index out of range");
-	auto it = included_services_.begin();
-	std::advance(it, static_cast<long>(index));
-	return *it;
+	return included_services_[index];
 }
 
 const Service& Service::GetIncludedService(size_t index) const {
 	assert(index < included_services_.size() && "Included service index out of range");
-	auto it = included_services_.begin();
-	std::advance(it, static_cast<long>(index));
-	return *it;
+	return included_services_[index];
 }
 
 bool Service::IsValid() const {
@@ -259,9 +259,7 @@ bool Service::RemoveCharacteristic(size_t index) {
 	if(index >= characteristics_.size()) {
 		return false;
 	}
-	auto it = characteristics_.begin();
-	std::advance(it, static_cast<long>(index));
-	characteristics_.erase(it);
+	characteristics_.erase(characteristics_.begin() + static_cast<long>(index));
 	return true;
 }
 
@@ -312,9 +310,7 @@ bool Service::RemoveIncludedService(size_t index) {
 	if(index >= included_services_.size()) {
 		return false;
 	}
-	auto it = included_services_.begin();
-	std::advance(it, static_cast<long>(index));
-	included_services_.erase(it);
+	included_services_.erase(included_services_.begin() + static_cast<long>(index));
 	if(index < included_service_declarations_.size()) {
 		included_service_declarations_.erase(included_service_declarations_.begin() + index);
 	}
@@ -326,6 +322,24 @@ void Service::ClearIncludedServices() {
 	included_service_declarations_.clear();
 }
 
+size_t Service::GetMemoryUsage() const {
+	size_t bytes = sizeof(Service);
+	bytes += declaration_attr_.GetMemoryUsage() - sizeof(Attribute);
+	bytes += (characteristics_.capacity() - characteristics_.size()) * sizeof(Characteristic);
+	for(const auto& characteristic: characteristics_) {
+		bytes += characteristic.GetMemoryUsage();
+	}
+	bytes += (included_services_.capacity() - included_services_.size()) * sizeof(Service);
+	for(const auto& included: included_services_) {
+		bytes += included.GetMemoryUsage();
+	}
+	bytes += (included_service_declarations_.capacity() - included_service_declarations_.size()) * sizeof(Attribute);
+	for(const auto& declaration: included_service_declarations_) {
+		bytes += declaration.GetMemoryUsage();
+	}
+	return bytes;
+}
+
 std::ostream& operator<<(std::ostream& os, const Service& service) {
 	os << "{";
 	os << "\n  UUID: " << service.GetUuid();
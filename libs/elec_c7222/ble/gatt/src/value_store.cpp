@@ -0,0 +1,261 @@
+#include "value_store.hpp"
+
+#include <algorithm>
+
+#include "ble_utils.hpp"
+#include "freertos_task_notification.hpp"
+
+namespace c7222 {
+
+ValueStore::ValueStore(const Config& config)
+	: config_(config),
+	  storage_(config.region.bank_size != 0 ? config.region : GetDefaultRegion()) {
+	config_.region = storage_.GetConfig();
+	config_.max_values = std::max<size_t>(config_.max_values, 1);
+}
+
+FlashStorage::Config ValueStore::GetDefaultRegion() {
+	const uint32_t sector = FlashStorage::GetSectorSize();
+	return FlashStorage::Config{FlashStorage::GetStorageLimit() - 4U * sector, sector};
+}
+
+bool ValueStore::Start() {
+	if(started_) {
+		return true;
+	}
+	if(!storage_mutex_.IsValid() || !storage_.Init()) {
+		C7222_BLE_DEBUG_PRINT("[BLE] ValueStore: region offset=0x%08x bank=%u unusable\n",
+			static_cast<unsigned>(config_.region.offset),
+			static_cast<unsigned>(config_.region.bank_size));
+		return false;
+	}
+	slots_.resize(config_.max_values);
+	for(auto& slot: slots_) {
+		slot.record.reserve(kMaxRecordSize);
+		slot.flush_record.reserve(kMaxRecordSize);
+	}
+	started_ = true;
+	if(config_.flush_task) {
+		task_ = std::make_unique<FreeRtosTask>();
+		if(!task_->Initialize("c7222_values",
+							  config_.task_stack_words,
+							  FreeRtosTask::IdlePriority(),
+							  [this](void*) { RunFlushTask(); })) {
+			task_.reset();
+			started_ = false;
+			return false;
+		}
+	}
+	C7222_BLE_DEBUG_PRINT("[BLE] ValueStore: %u stored values\n",
+		static_cast<unsigned>(GetHandles().size()));
+	return true;
+}
+
+bool ValueStore::BindDatabase(const DatabaseHash::Value& hash) {
+	if(!started_) {
+		return false;
+	}
+	(void)Flush();
+	if(!storage_mutex_.Lock(FreeRtosTask::kInfinite)) {
+		return false;
+	}
+	DatabaseHash::Value stored{};
+	const bool same = storage_.Get(kDatabaseHashTag, stored.data(), stored.size()) == stored.size() &&
+					  stored == hash;
+	if(!same) {
+		C7222_BLE_DEBUG_PRINT("[BLE] ValueStore: database layout changed, dropping %u values\n",
+			static_cast<unsigned>(storage_.GetStats().entries));
+		if(storage_.GetStats().entries != 0) {
+			(void)storage_.Format();
+		}
+		(void)storage_.Store(kDatabaseHashTag, hash.data(), hash.size());
+	}
+	// Characteristics are rebuilt with the database; they claim slots again on their next write.
+	FreeRtosCriticalSection lock;
+	lock.Enter();
+	for(auto& slot: slots_) {
+		if(!slot.dirty) {
+			slot.handle = 0;
+			slot.erase = false;
+		}
+	}
+	(void)lock.Exit();
+	(void)storage_mutex_.Unlock();
+	return same;
+}
+
+std::vector<uint16_t> ValueStore::GetHandles() const {
+	std::vector<uint16_t> handles;
+	if(!storage_mutex_.Lock(FreeRtosTask::kInfinite)) {
+		return handles;
+	}
+	for(const uint32_t tag: storage_.GetTags()) {
+		if(tag != 0 && tag < kDatabaseHashTag) {
+			handles.push_back(static_cast<uint16_t>(tag));
+		}
+	}
+	(void)storage_mutex_.Unlock();
+	std::sort(handles.begin(), handles.end());
+	return handles;
+}
+
+bool ValueStore::Load(uint16_t handle, std::vector<uint8_t>& value) const {
+	if(!storage_mutex_.Lock(FreeRtosTask::kInfinite)) {
+		return false;
+	}
+	std::vector<uint8_t> record(storage_.GetSize(handle));
+	if(!record.empty()) {
+		(void)storage_.Get(handle, record.data(), record.size());
+	}
+	(void)storage_mutex_.Unlock();
+	if(record.empty() || record[0] != kValueRecordFormat) {
+		return false;
+	}
+	value.assign(record.begin() + 1, record.end());
+	return true;
+}
+
+bool ValueStore::Stage(uint16_t handle, const uint8_t* data, size_t size) {
+	if(size > kMaxValueSize) {
+		return false;
+	}
+	return StageRecord(handle, data, data != nullptr ? size : 0, false);
+}
+
+bool ValueStore::StageErase(uint16_t handle) {
+	return StageRecord(handle, nullptr, 0, true);
+}
+
+bool ValueStore::StageRecord(uint16_t handle, const uint8_t* data, size_t size, bool erase) {
+	if(!started_ || handle == 0) {
+		return false;
+	}
+	bool staged = false;
+	bool first_dirty = false;
+	FreeRtosCriticalSection lock;
+	lock.Enter();
+	++stats_.staged;
+	auto it = std::find_if(slots_.begin(), slots_.end(), [handle](const Slot& slot) {
+		return slot.handle == handle;
+	});
+	if(it == slots_.end()) {
+		it = std::find_if(slots_.begin(), slots_.end(), [](const Slot& slot) {
+			return slot.handle == 0;
+		});
+	}
+	if(it != slots_.end()) {
+		if(it->dirty) {
+			++stats_.coalesced;
+		} else {
+			it->dirty = true;
+			first_dirty = dirty_count_++ == 0;
+		}
+		it->handle = handle;
+		it->erase = erase;
+		// Within the capacity reserved by Start(): no allocation here.
+		it->record.clear();
+		if(!erase) {
+			it->record.push_back(kValueRecordFormat);
+			it->record.insert(it->record.end(), data, data + size);
+		}
+		staged = true;
+	} else {
+		++stats_.dropped;
+	}
+	(void)lock.Exit();
+
+	// The first value of a burst starts the flush delay.
+	if(first_dirty && task_ != nullptr) {
+		(void)FreeRtosTaskNotification::Notify(task_->GetHandle(), 1, FreeRtosTaskNotification::Action::kIncrement);
+	}
+	return staged;
+}
+
+bool ValueStore::HasPending() const {
+	FreeRtosCriticalSection lock;
+	lock.Enter();
+	const bool pending = dirty_count_ != 0;
+	(void)lock.Exit();
+	return pending;
+}
+
+bool ValueStore::Flush() {
+	if(!started_ || !storage_mutex_.Lock(FreeRtosTask::kInfinite)) {
+		return false;
+	}
+	std::vector<FlashStorage::Entry> entries;
+	entries.reserve(slots_.size());
+	FreeRtosCriticalSection lock;
+	lock.Enter();
+	for(auto& slot: slots_) {
+		if(slot.dirty) {
+			// Swap buffers: Stage() keeps filling `record` while this one is written.
+			slot.flush_record.swap(slot.record);
+			slot.flushing = true;
+			slot.dirty = false;
+			entries.push_back(FlashStorage::Entry{slot.handle,
+												  slot.erase ? nullptr : slot.flush_record.data(),
+												  slot.erase ? 0 : slot.flush_record.size()});
+		}
+	}
+	dirty_count_ = 0;
+	(void)lock.Exit();
+	if(entries.empty()) {
+		(void)storage_mutex_.Unlock();
+		return true;
+	}
+
+	const bool ok = storage_.StoreBatch(entries.data(), entries.size());
+
+	lock.Enter();
+	if(ok) {
+		++stats_.flushes;
+		stats_.values_written += static_cast<uint32_t>(entries.size());
+	} else {
+		++stats_.failures;
+	}
+	for(auto& slot: slots_) {
+		if(!slot.flushing) {
+			continue;
+		}
+		slot.flushing = false;
+		if(slot.dirty) {
+			continue;  // staged again meanwhile
+		}
+		if(!ok) {
+			// Keep the value for the next flush.
+			slot.record.swap(slot.flush_record);
+			slot.dirty = true;
+			++dirty_count_;
+		} else if(slot.erase) {
+			slot.handle = 0;
+			slot.erase = false;
+		}
+	}
+	(void)lock.Exit();
+	(void)storage_mutex_.Unlock();
+	C7222_BLE_DEBUG_PRINT("[BLE] ValueStore: flushed %u values ok=%u\n",
+		static_cast<unsigned>(entries.size()),
+		static_cast<unsigned>(ok));
+	return ok;
+}
+
+ValueStore::Stats ValueStore::GetStats() const {
+	FreeRtosCriticalSection lock;
+	lock.Enter();
+	const Stats stats = stats_;
+	(void)lock.Exit();
+	return stats;
+}
+
+void ValueStore::RunFlushTask() {
+	for(;;) {
+		(void)FreeRtosTaskNotification::Take(true, FreeRtosTask::kInfinite);
+		// Let the burst finish; values staged meanwhile are coalesced into this flush.
+		do {
+			FreeRtosTask::Delay(FreeRtosTask::MsToTicks(config_.flush_delay_ms));
+		} while(!Flush() && HasPending());
+	}
+}
+
+}  // namespace c7222
@@ -14,6 +14,7 @@
 #include "ble_address.hpp"
 #include "ble_error.hpp"
 #include "gap.hpp"
+#include "l2cap_channel.hpp"
 #include "non_copyable.hpp"
 #include "security_manager.hpp"
 
@@ -152,6 +153,7 @@ namespace c7222 {
  * - Powers on the controller via `hci_power_control(HCI_POWER_ON)`.
  * - Routes HCI events into GAP, AttributeServer, and SecurityManager.
  * - Updates the AttributeServer security cache on `GAP_EVENT_SECURITY_LEVEL`.
+ * - Routes LE credit-based L2CAP channel packets into `DispatchL2capPacket()`.
  *
  * The `DumpAttributeServerContext()` helper can dump the ATT database using
  * BTstack when HCI logging is enabled.
@@ -215,6 +217,15 @@ class Ble : public NonCopyableNonMovable {
 	 * ATT database blob (att_db).
 	 */
 	AttributeServer* EnableAttributeServer(const void* context);
+
+	/**
+	 * @brief Enable the Attribute Server using a build-time GATT layout.
+	 *
+	 * Same as `EnableAttributeServer(const void*)`, but the server graph is
+	 * materialized from the constexpr tables in `<name>_layout.hpp` instead of
+	 * parsing the ATT DB at startup.
+	 */
+	AttributeServer* EnableAttributeServer(const void* context, const GattDatabaseLayout& layout);
 	/** @} */
 
 	/**
@@ -631,6 +642,16 @@ class Ble : public NonCopyableNonMovable {
 										  uint8_t channel,
 										  const uint8_t* packet_data,
 										  uint16_t packet_data_size);
+
+	/**
+	 * @brief Dispatch L2CAP channel events and SDUs to the `L2capChannel` objects.
+	 *
+	 * `channel` is the 16-bit local channel ID of data packets.
+	 */
+	virtual BleError DispatchL2capPacket(uint8_t packet_type,
+										 uint16_t channel,
+										 const uint8_t* packet_data,
+										 uint16_t packet_data_size);
 	/** @} */
 
    private:
@@ -693,6 +714,11 @@ class Ble : public NonCopyableNonMovable {
 	 * @brief Ensure SM event handler is registered with the platform.
 	 */
 	void EnsureSmEventHandlerRegistered();
+
+	/**
+	 * @brief Shared implementation of both `EnableAttributeServer()` overloads.
+	 */
+	AttributeServer* EnableAttributeServerImpl(const void* context, const GattDatabaseLayout* layout);
 };
 
 }  // namespace c7222
@@ -171,6 +171,26 @@ enum class BleError : int {
 	 * @brief ATT Error: Insufficient Encryption (0x0F from spec).
 	 */
 	kAttErrorInsufficientEncryption,
+	/**
+	 * @brief ATT Error: Invalid Offset (0x07 from spec).
+	 */
+	kAttErrorInvalidOffset,
+	/**
+	 * @brief ATT Error: Prepare Queue Full (0x09 from spec).
+	 */
+	kAttErrorPrepareQueueFull,
+	/**
+	 * @brief ATT Error: Database Out Of Sync (0x12 from spec).
+	 */
+	kAttErrorDatabaseOutOfSync,
+	/**
+	 * @brief ATT Error: Value Not Allowed (0x13 from spec).
+	 */
+	kAttErrorValueNotAllowed,
+	/**
+	 * @brief ATT response deferred (not an ATT error; completes asynchronously).
+	 */
+	kAttResponsePending,
 
 	/**
 	 * @brief GATT client errors.
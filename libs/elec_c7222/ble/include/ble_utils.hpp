@@ -1,6 +1,7 @@
 #ifndef _BLE_UTILS_H_
 #define _BLE_UTILS_H_
 
+#include <cstdint>
 #include <cstdio>
 
 #if defined(C7222_BLE_DEBUG)
@@ -10,6 +11,15 @@
 #endif
 
 namespace c7222 {
+
+/**
+ * @brief BLE stack time in milliseconds (platform-specific).
+ *
+ * The BTstack run loop clock on the Pico W, the harness clock on the grader.
+ * Wraps around; compare times with signed differences.
+ */
+uint32_t GetBleTimeMs();
+
 }
 
 #endif	//! _BLE_UTILS_H_
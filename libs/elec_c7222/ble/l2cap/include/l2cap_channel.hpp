@@ -0,0 +1,439 @@
+/**
+ * @file l2cap_channel.hpp
+ * @brief LE credit-based L2CAP connection-oriented channel.
+ */
+#ifndef ELEC_C7222_BLE_L2CAP_CHANNEL_H_
+#define ELEC_C7222_BLE_L2CAP_CHANNEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+#include "ble_error.hpp"
+#include "gap.hpp"
+#include "non_copyable.hpp"
+
+namespace c7222 {
+
+/**
+ * @class L2capChannel
+ * @brief One LE credit-based L2CAP channel (LE CoC) listening on a PSM.
+ *
+ * LE connection-oriented channels move application SDUs of up to the
+ * negotiated MTU with per-PDU credit flow control and no ATT header, which
+ * makes them the fastest path for bulk transfers (log offload, firmware
+ * images) without abusing GATT notifications.
+ *
+ * ---
+ * ### Lifecycle
+ *
+ * 1. Construct with a `Config` (PSM, receive MTU, credits, security level).
+ *    The receive SDU buffer is allocated once here.
+ * 2. Call `Listen()` after `Ble::TurnOn()`; the PSM is registered with the
+ *    stack and the next incoming connection on it is accepted.
+ * 3. `EventHandler::OnOpened()` reports the channel as open; data then flows
+ *    through `Send()` and `EventHandler::OnData()`.
+ * 4. `EventHandler::OnClosed()` reports a disconnect; the channel accepts
+ *    the next connection while it is still listening.
+ *
+ * One channel object serves one connection at a time. Further incoming
+ * connections on the same PSM are declined while it is open.
+ *
+ * ---
+ * ### Zero-Copy Buffers
+ *
+ * - **Send:** `Send()` hands the SDU pointer to the stack, which fragments
+ *   it into PDUs directly from that memory. The buffer must stay valid and
+ *   unchanged until `EventHandler::OnSendComplete()`; only one SDU is in
+ *   flight at a time.
+ * - **Receive:** the stack reassembles SDUs into the channel's receive
+ *   buffer and `EventHandler::OnData()` gets a pointer into it. The data is
+ *   valid only during the callback.
+ *
+ * ---
+ * ### Credits
+ *
+ * With `Config::initial_credits == 0` the stack returns credits to the peer
+ * automatically as PDUs are processed. With a non-zero value the peer gets
+ * that many credits at connection time and the application returns more
+ * with `ProvideCredits()` once it has consumed the data, throttling the
+ * sender to the application's pace.
+ *
+ * ---
+ * ### Event Routing
+ *
+ * The platform layer forwards L2CAP packets through
+ * `Ble::DispatchL2capPacket()`, which calls `DispatchPacket()`; events are
+ * routed to the channel by PSM (incoming connection) or local channel ID.
+ *
+ * ---
+ * ### Raspberry Pi Pico (BTstack) Port
+ *
+ * The Pico W implementation in `libs/elec_c7222/ble/l2cap/platform/rpi_pico/`
+ * uses the BTstack `l2cap_cbm_*` API. The grader implementation forwards
+ * every stack call to `c7222_grader_l2cap_*` hooks and decodes packets with
+ * the BTstack event layout, so a simulated stack can drive it on Linux.
+ *
+ * @code
+ * struct LogSink : c7222::L2capChannel::EventHandler {
+ *   void OnData(c7222::L2capChannel& channel, const uint8_t* data, uint16_t size) const override {
+ *     Store(data, size);
+ *   }
+ * };
+ *
+ * c7222::L2capChannel channel({0x0080, 512, 0, 0});
+ * LogSink sink;
+ * channel.AddEventHandler(sink);
+ * channel.Listen();
+ * @endcode
+ */
+class L2capChannel : public NonCopyableNonMovable {
+   public:
+	/// \name Types
+	///@{
+	/// Smallest MTU allowed for LE credit-based channels.
+	static constexpr uint16_t kMinMtu = 23;
+
+	/**
+	 * @brief Channel state.
+	 */
+	enum class State : uint8_t {
+		/// Not registered with the stack.
+		kIdle,
+		/// PSM registered, waiting for a connection.
+		kListening,
+		/// Incoming connection accepted, waiting for the channel to open.
+		kOpening,
+		/// Channel open; data can flow.
+		kOpen,
+		/// Disconnect requested, waiting for the stack to close the channel.
+		kClosing
+	};
+
+	/**
+	 * @brief Channel configuration.
+	 */
+	struct Config {
+		/// @brief Protocol/Service Multiplexer to listen on (LE dynamic range 0x0080-0x00FF).
+		uint16_t psm = 0x0080;
+		/// @brief Receive MTU, i.e. largest incoming SDU (at least `kMinMtu`).
+		uint16_t mtu = 512;
+		/// @brief Credits granted at connection time (0 = automatic credit management).
+		uint16_t initial_credits = 0;
+		/// @brief Required GAP security level 0-4 (0 = no security).
+		uint8_t security_level = 0;
+	};
+
+	/**
+	 * @brief Channel event callbacks (stack context).
+	 *
+	 * Event data references are only valid during the callback.
+	 */
+	struct EventHandler {
+		/**
+		 * @brief Called when the channel opened or failed to open.
+		 * @param channel Channel the event refers to.
+		 * @param status BleError::kSuccess if the channel is open.
+		 */
+		virtual void OnOpened(L2capChannel& channel, BleError status) const {}
+		/**
+		 * @brief Called for every received SDU.
+		 * @param channel Channel the data arrived on.
+		 * @param data SDU bytes (inside the channel receive buffer).
+		 * @param size SDU size in bytes.
+		 */
+		virtual void OnData(L2capChannel& channel, const uint8_t* data, uint16_t size) const {}
+		/**
+		 * @brief Called when the SDU passed to `Send()` was handed to the controller.
+		 *
+		 * The send buffer may be reused from here on.
+		 * @param channel Channel the SDU was sent on.
+		 */
+		virtual void OnSendComplete(L2capChannel& channel) const {}
+		/**
+		 * @brief Called after `RequestCanSendNow()` once `Send()` will be accepted.
+		 * @param channel Channel that can send.
+		 */
+		virtual void OnCanSendNow(L2capChannel& channel) const {}
+		/**
+		 * @brief Called when the channel closed.
+		 * @param channel Channel that closed.
+		 */
+		virtual void OnClosed(L2capChannel& channel) const {}
+
+	   protected:
+		~EventHandler() = default;
+	};
+	///@}
+
+	/// \name Construction
+	///@{
+	/**
+	 * @brief Create an idle channel and allocate its receive buffer.
+	 */
+	explicit L2capChannel(const Config& config);
+
+	/**
+	 * @brief Close the channel and unregister the PSM.
+	 */
+	~L2capChannel();
+	///@}
+
+	/// \name Channel Control
+	///@{
+	/**
+	 * @brief Register the PSM and accept incoming connections on it.
+	 *
+	 * @return BleError::kL2capServiceAlreadyRegistered if another channel
+	 *         listens on the PSM, or the stack status
+	 */
+	BleError Listen();
+
+	/**
+	 * @brief Unregister the PSM; an open connection stays open.
+	 *
+	 * @return BleError::kL2capServiceDoesNotExist if not listening, or the
+	 *         stack status
+	 */
+	BleError StopListening();
+
+	/**
+	 * @brief Disconnect the open channel; `OnClosed()` follows.
+	 *
+	 * @return BleError::kCommandDisallowed if the channel is not open
+	 */
+	BleError Disconnect();
+	///@}
+
+	/// \name Data Transfer
+	///@{
+	/**
+	 * @brief Send one SDU without copying it.
+	 *
+	 * The stack sends from `data` directly; keep the buffer valid and
+	 * unchanged until `EventHandler::OnSendComplete()`.
+	 *
+	 * @return BleError::kCommandDisallowed if the channel is not open,
+	 *         BleError::kL2capDataLenExceedsRemoteMtu if `size` exceeds the
+	 *         peer MTU, BleError::kBtstackAclBuffersFull while the previous
+	 *         SDU is still in flight, or the stack status
+	 */
+	BleError Send(const uint8_t* data, uint16_t size);
+
+	/**
+	 * @brief True if the channel is open and no SDU is in flight.
+	 */
+	[[nodiscard]] bool CanSend() const {
+		return state_ == State::kOpen && !send_in_progress_;
+	}
+
+	/**
+	 * @brief Ask for `EventHandler::OnCanSendNow()` once `Send()` will be accepted.
+	 *
+	 * @return BleError::kCommandDisallowed if the channel is not open
+	 */
+	BleError RequestCanSendNow();
+
+	/**
+	 * @brief Return credits to the peer (manual credit mode only).
+	 *
+	 * @return BleError::kCommandDisallowed if the channel is not open or uses
+	 *         automatic credits, or the stack status
+	 */
+	BleError ProvideCredits(uint16_t credits);
+	///@}
+
+	/// \name State and Counters
+	///@{
+	/** @brief Current channel state. */
+	[[nodiscard]] State GetState() const {
+		return state_;
+	}
+	/** @brief True while the channel is open. */
+	[[nodiscard]] bool IsOpen() const {
+		return state_ == State::kOpen;
+	}
+	/** @brief Channel configuration. */
+	[[nodiscard]] const Config& GetConfig() const {
+		return config_;
+	}
+	/** @brief Stack local channel ID (0 when no connection). */
+	[[nodiscard]] uint16_t GetLocalCid() const {
+		return local_cid_;
+	}
+	/** @brief Connection the channel runs on (0 when no connection). */
+	[[nodiscard]] ConnectionHandle GetConnectionHandle() const {
+		return connection_handle_;
+	}
+	/** @brief Largest SDU the peer accepts (0 until open). */
+	[[nodiscard]] uint16_t GetRemoteMtu() const {
+		return remote_mtu_;
+	}
+	/** @brief SDUs handed to the controller. */
+	[[nodiscard]] uint32_t GetSentSduCount() const {
+		return sdus_sent_;
+	}
+	/** @brief Payload bytes handed to the controller. */
+	[[nodiscard]] uint32_t GetSentByteCount() const {
+		return bytes_sent_;
+	}
+	/** @brief SDUs received. */
+	[[nodiscard]] uint32_t GetReceivedSduCount() const {
+		return sdus_received_;
+	}
+	/** @brief Payload bytes received. */
+	[[nodiscard]] uint32_t GetReceivedByteCount() const {
+		return bytes_received_;
+	}
+	/**
+	 * @brief Reset the transfer counters.
+	 */
+	void ResetCounters();
+	///@}
+
+	/// \name Event Handler Management
+	///@{
+	/**
+	 * @brief Register an event handler (must outlive the channel).
+	 */
+	void AddEventHandler(const EventHandler& handler);
+	/**
+	 * @brief Remove an event handler.
+	 */
+	bool RemoveEventHandler(const EventHandler& handler);
+	/**
+	 * @brief Remove all event handlers.
+	 */
+	void ClearEventHandlers() {
+		handlers_.clear();
+	}
+	///@}
+
+	/// \name Stack Dispatch (Internal)
+	///@{
+	/**
+	 * @brief Route an L2CAP event or data packet to its channel.
+	 *
+	 * @param packet_type HCI packet type (event or L2CAP data)
+	 * @param channel Local channel ID for data packets
+	 * @param packet_data Packet bytes
+	 * @param packet_data_size Packet size
+	 * @return BleError::kSuccess if handled or not an LE channel packet
+	 * @note Internal use only (`Ble::DispatchL2capPacket()`).
+	 */
+	static BleError DispatchPacket(uint8_t packet_type,
+								   uint16_t channel,
+								   const uint8_t* packet_data,
+								   uint16_t packet_data_size);
+	///@}
+
+   private:
+	/**
+	 * @brief L2CAP packet fields needed for routing.
+	 */
+	struct L2capEvent {
+		enum class Type : uint8_t {
+			/// Not an LE channel packet.
+			kNone,
+			/// L2CAP_EVENT_CBM_INCOMING_CONNECTION.
+			kIncomingConnection,
+			/// L2CAP_EVENT_CBM_CHANNEL_OPENED.
+			kChannelOpened,
+			/// L2CAP_EVENT_CHANNEL_CLOSED.
+			kChannelClosed,
+			/// L2CAP_EVENT_CAN_SEND_NOW.
+			kCanSendNow,
+			/// L2CAP_EVENT_PACKET_SENT.
+			kPacketSent,
+			/// L2CAP_DATA_PACKET.
+			kData
+		};
+		Type type = Type::kNone;
+		/// @brief Local channel ID the packet refers to.
+		uint16_t local_cid = 0;
+		/// @brief PSM (incoming connection and channel opened).
+		uint16_t psm = 0;
+		/// @brief Connection handle (incoming connection and channel opened).
+		ConnectionHandle connection_handle = 0;
+		/// @brief Peer MTU (incoming connection and channel opened).
+		uint16_t remote_mtu = 0;
+		/// @brief Open status (channel opened only).
+		BleError status = BleError::kSuccess;
+		/// @brief SDU bytes (data only).
+		const uint8_t* data = nullptr;
+		/// @brief SDU size (data only).
+		uint16_t data_size = 0;
+	};
+
+	/// \name Platform Hooks
+	///@{
+	/**
+	 * @brief Decode a stack packet into an `L2capEvent` (platform-specific).
+	 */
+	static L2capEvent DecodeEvent(uint8_t packet_type,
+								  uint16_t channel,
+								  const uint8_t* packet_data,
+								  uint16_t packet_data_size);
+	/** @brief Register the PSM with the stack (platform-specific). */
+	BleError RegisterService();
+	/** @brief Unregister the PSM (platform-specific). */
+	BleError UnregisterService();
+	/** @brief Accept the pending incoming connection into `receive_buffer_` (platform-specific). */
+	BleError AcceptConnection(uint16_t local_cid);
+	/** @brief Decline an incoming connection (platform-specific). */
+	static void DeclineConnection(uint16_t local_cid);
+	/** @brief Queue an SDU for sending (platform-specific). */
+	BleError SendSdu(const uint8_t* data, uint16_t size);
+	/** @brief Ask the stack for L2CAP_EVENT_CAN_SEND_NOW (platform-specific). */
+	BleError RequestCanSendNowEvent();
+	/** @brief Return credits to the peer (platform-specific). */
+	BleError GrantCredits(uint16_t credits);
+	/** @brief Disconnect the channel (platform-specific). */
+	BleError DisconnectChannel();
+	///@}
+
+	/**
+	 * @brief Apply a decoded event to this channel and notify the handlers.
+	 */
+	void HandleEvent(const L2capEvent& event);
+
+	/**
+	 * @brief Forget the connection and return to listening or idle.
+	 */
+	void ResetConnection();
+
+	/**
+	 * @brief Find the channel listening on `psm`, or nullptr.
+	 */
+	static L2capChannel* FindByPsm(uint16_t psm);
+
+	/**
+	 * @brief Find the channel using `local_cid`, or nullptr.
+	 */
+	static L2capChannel* FindByCid(uint16_t local_cid);
+
+	/// @brief All live channels (added by the constructor, removed by the destructor).
+	static std::list<L2capChannel*> channels_;
+
+	Config config_;
+	State state_ = State::kIdle;
+	/// @brief True while the PSM is registered.
+	bool listening_ = false;
+	/// @brief True from `Send()` until L2CAP_EVENT_PACKET_SENT.
+	bool send_in_progress_ = false;
+	uint16_t local_cid_ = 0;
+	ConnectionHandle connection_handle_ = 0;
+	uint16_t remote_mtu_ = 0;
+	/// @brief SDU reassembly buffer handed to the stack (`config_.mtu` bytes).
+	std::vector<uint8_t> receive_buffer_;
+	std::list<const EventHandler*> handlers_{};
+	uint32_t sdus_sent_ = 0;
+	uint32_t bytes_sent_ = 0;
+	uint32_t sdus_received_ = 0;
+	uint32_t bytes_received_ = 0;
+};
+
+}  // namespace c7222
+
+#endif	// ELEC_C7222_BLE_L2CAP_CHANNEL_H_
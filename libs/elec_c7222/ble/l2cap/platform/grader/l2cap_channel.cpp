@@ -0,0 +1,150 @@
+#include "l2cap_channel.hpp"
+#include "ble_utils.hpp"
+
+namespace c7222 {
+
+extern "C" {
+/// Hooks implemented by the simulated stack; each returns a BTstack status (0 = success).
+/// Events and SDUs are fed back through Ble::DispatchL2capPacket() or
+/// L2capChannel::DispatchPacket() using the BTstack packet layout.
+uint8_t c7222_grader_l2cap_register_service(uint16_t psm, uint8_t security_level);
+uint8_t c7222_grader_l2cap_unregister_service(uint16_t psm);
+/// The simulated stack reassembles incoming SDUs into `receive_buffer`.
+uint8_t c7222_grader_l2cap_accept_connection(uint16_t local_cid,
+											 uint8_t* receive_buffer,
+											 uint16_t mtu,
+											 uint16_t initial_credits);
+void c7222_grader_l2cap_decline_connection(uint16_t local_cid);
+/// The simulated stack reads from `data` until it reports the packet sent.
+uint8_t c7222_grader_l2cap_send(uint16_t local_cid, const uint8_t* data, uint16_t size);
+uint8_t c7222_grader_l2cap_request_can_send_now_event(uint16_t local_cid);
+uint8_t c7222_grader_l2cap_provide_credits(uint16_t local_cid, uint16_t credits);
+uint8_t c7222_grader_l2cap_disconnect(uint16_t local_cid);
+}
+
+namespace {
+
+// BTstack packet layout used by the simulated stack
+constexpr uint8_t kHciEventPacket = 0x04;
+constexpr uint8_t kL2capDataPacket = 0x06;
+constexpr uint8_t kL2capEventChannelClosed = 0x71;
+constexpr uint8_t kL2capEventCanSendNow = 0x78;
+constexpr uint8_t kL2capEventCbmIncomingConnection = 0x7A;
+constexpr uint8_t kL2capEventCbmChannelOpened = 0x7B;
+constexpr uint8_t kL2capEventPacketSent = 0x7E;
+constexpr uint16_t kCidEventSize = 4;
+constexpr uint16_t kIncomingConnectionEventSize = 19;
+constexpr uint16_t kChannelOpenedEventSize = 23;
+// Automatic credit management marker (L2CAP_LE_AUTOMATIC_CREDITS)
+constexpr uint16_t kAutomaticCredits = 0xFFFF;
+
+uint16_t ReadLe16(const uint8_t* data) {
+	return static_cast<uint16_t>(data[0] | (static_cast<uint16_t>(data[1]) << 8));
+}
+
+BleError ToBleError(uint8_t status) {
+	return status == 0 ? BleError::kSuccess : BleError::kUnspecifiedError;
+}
+
+}  // namespace
+
+L2capChannel::L2capEvent L2capChannel::DecodeEvent(uint8_t packet_type,
+												   uint16_t channel,
+												   const uint8_t* packet_data,
+												   uint16_t packet_data_size) {
+	L2capEvent event{};
+	if(packet_data == nullptr) {
+		return event;
+	}
+	if(packet_type == kL2capDataPacket) {
+		event.type = L2capEvent::Type::kData;
+		event.local_cid = channel;
+		event.data = packet_data;
+		event.data_size = packet_data_size;
+		return event;
+	}
+	if(packet_type != kHciEventPacket || packet_data_size == 0) {
+		return event;
+	}
+	switch(packet_data[0]) {
+	case kL2capEventCbmIncomingConnection:
+		// address_type(1) address(6) handle(2) psm(2) local_cid(2) remote_cid(2) remote_mtu(2)
+		if(packet_data_size >= kIncomingConnectionEventSize) {
+			event.type = L2capEvent::Type::kIncomingConnection;
+			event.connection_handle = ReadLe16(&packet_data[9]);
+			event.psm = ReadLe16(&packet_data[11]);
+			event.local_cid = ReadLe16(&packet_data[13]);
+			event.remote_mtu = ReadLe16(&packet_data[17]);
+		}
+		break;
+	case kL2capEventCbmChannelOpened:
+		// status(1) address_type(1) address(6) handle(2) incoming(1) psm(2)
+		// local_cid(2) remote_cid(2) local_mtu(2) remote_mtu(2)
+		if(packet_data_size >= kChannelOpenedEventSize) {
+			event.type = L2capEvent::Type::kChannelOpened;
+			event.status = ToBleError(packet_data[2]);
+			event.connection_handle = ReadLe16(&packet_data[10]);
+			event.psm = ReadLe16(&packet_data[13]);
+			event.local_cid = ReadLe16(&packet_data[15]);
+			event.remote_mtu = ReadLe16(&packet_data[21]);
+		}
+		break;
+	case kL2capEventChannelClosed:
+		event.type = L2capEvent::Type::kChannelClosed;
+		break;
+	case kL2capEventCanSendNow:
+		event.type = L2capEvent::Type::kCanSendNow;
+		break;
+	case kL2capEventPacketSent:
+		event.type = L2capEvent::Type::kPacketSent;
+		break;
+	default:
+		break;
+	}
+	if(event.type == L2capEvent::Type::kChannelClosed || event.type == L2capEvent::Type::kCanSendNow ||
+	   event.type == L2capEvent::Type::kPacketSent) {
+		// local_cid(2)
+		if(packet_data_size < kCidEventSize) {
+			return L2capEvent{};
+		}
+		event.local_cid = ReadLe16(&packet_data[2]);
+	}
+	return event;
+}
+
+BleError L2capChannel::RegisterService() {
+	return ToBleError(c7222_grader_l2cap_register_service(config_.psm, config_.security_level));
+}
+
+BleError L2capChannel::UnregisterService() {
+	return ToBleError(c7222_grader_l2cap_unregister_service(config_.psm));
+}
+
+BleError L2capChannel::AcceptConnection(uint16_t local_cid) {
+	const uint16_t credits = config_.initial_credits == 0 ? kAutomaticCredits : config_.initial_credits;
+	return ToBleError(
+		c7222_grader_l2cap_accept_connection(local_cid, receive_buffer_.data(), config_.mtu, credits));
+}
+
+void L2capChannel::DeclineConnection(uint16_t local_cid) {
+	c7222_grader_l2cap_decline_connection(local_cid);
+}
+
+BleError L2capChannel::SendSdu(const uint8_t* data, uint16_t size) {
+	return ToBleError(c7222_grader_l2cap_send(local_cid_, data, size));
+}
+
+BleError L2capChannel::RequestCanSendNowEvent() {
+	return ToBleError(c7222_grader_l2cap_request_can_send_now_event(local_cid_));
+}
+
+BleError L2capChannel::GrantCredits(uint16_t credits) {
+	return ToBleError(c7222_grader_l2cap_provide_credits(local_cid_, credits));
+}
+
+BleError L2capChannel::DisconnectChannel() {
+	C7222_BLE_DEBUG_PRINT("[BLE][L2CAP] Disconnect cid=0x%04x (grader)\n", static_cast<unsigned>(local_cid_));
+	return ToBleError(c7222_grader_l2cap_disconnect(local_cid_));
+}
+
+}  // namespace c7222
@@ -0,0 +1,122 @@
+#include "l2cap_channel.hpp"
+#include "ble.hpp"
+#include "ble_utils.hpp"
+
+#include <btstack.h>
+
+namespace c7222 {
+
+namespace btstack_map {
+bool FromBtStackError(uint8_t code, BleError& out);
+}  // namespace btstack_map
+
+namespace {
+
+// All LE channel events and SDUs enter the library through Ble.
+void l2cap_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t* packet, uint16_t size) {
+	(void)Ble::GetInstance()->DispatchL2capPacket(packet_type, channel, packet, size);
+}
+
+BleError ToBleError(uint8_t status) {
+	if(status == ERROR_CODE_SUCCESS) {
+		return BleError::kSuccess;
+	}
+	BleError mapped = BleError::kUnspecifiedError;
+	(void)btstack_map::FromBtStackError(status, mapped);
+	return mapped;
+}
+
+}  // namespace
+
+L2capChannel::L2capEvent L2capChannel::DecodeEvent(uint8_t packet_type,
+												   uint16_t channel,
+												   const uint8_t* packet_data,
+												   uint16_t packet_data_size) {
+	L2capEvent event{};
+	if(packet_data == nullptr) {
+		return event;
+	}
+	if(packet_type == L2CAP_DATA_PACKET) {
+		event.type = L2capEvent::Type::kData;
+		event.local_cid = channel;
+		event.data = packet_data;
+		event.data_size = packet_data_size;
+		return event;
+	}
+	if(packet_type != HCI_EVENT_PACKET || packet_data_size == 0) {
+		return event;
+	}
+	switch(hci_event_packet_get_type(packet_data)) {
+	case L2CAP_EVENT_CBM_INCOMING_CONNECTION:
+		event.type = L2capEvent::Type::kIncomingConnection;
+		event.local_cid = l2cap_event_cbm_incoming_connection_get_local_cid(packet_data);
+		event.psm = l2cap_event_cbm_incoming_connection_get_psm(packet_data);
+		event.connection_handle = l2cap_event_cbm_incoming_connection_get_handle(packet_data);
+		event.remote_mtu = l2cap_event_cbm_incoming_connection_get_remote_mtu(packet_data);
+		break;
+	case L2CAP_EVENT_CBM_CHANNEL_OPENED:
+		event.type = L2capEvent::Type::kChannelOpened;
+		event.status = ToBleError(l2cap_event_cbm_channel_opened_get_status(packet_data));
+		event.local_cid = l2cap_event_cbm_channel_opened_get_local_cid(packet_data);
+		event.psm = l2cap_event_cbm_channel_opened_get_psm(packet_data);
+		event.connection_handle = l2cap_event_cbm_channel_opened_get_handle(packet_data);
+		event.remote_mtu = l2cap_event_cbm_channel_opened_get_remote_mtu(packet_data);
+		break;
+	case L2CAP_EVENT_CHANNEL_CLOSED:
+		event.type = L2capEvent::Type::kChannelClosed;
+		event.local_cid = l2cap_event_channel_closed_get_local_cid(packet_data);
+		break;
+	case L2CAP_EVENT_CAN_SEND_NOW:
+		event.type = L2capEvent::Type::kCanSendNow;
+		event.local_cid = l2cap_event_can_send_now_get_local_cid(packet_data);
+		break;
+	case L2CAP_EVENT_PACKET_SENT:
+		event.type = L2capEvent::Type::kPacketSent;
+		event.local_cid = l2cap_event_packet_sent_get_local_cid(packet_data);
+		break;
+	default:
+		break;
+	}
+	return event;
+}
+
+BleError L2capChannel::RegisterService() {
+	return ToBleError(l2cap_cbm_register_service(&l2cap_packet_handler,
+												 config_.psm,
+												 static_cast<gap_security_level_t>(config_.security_level)));
+}
+
+BleError L2capChannel::UnregisterService() {
+	return ToBleError(l2cap_cbm_unregister_service(config_.psm));
+}
+
+BleError L2capChannel::AcceptConnection(uint16_t local_cid) {
+	const uint16_t credits =
+		config_.initial_credits == 0 ? L2CAP_LE_AUTOMATIC_CREDITS : config_.initial_credits;
+	return ToBleError(
+		l2cap_cbm_accept_connection(local_cid, receive_buffer_.data(), config_.mtu, credits));
+}
+
+void L2capChannel::DeclineConnection(uint16_t local_cid) {
+	(void)l2cap_cbm_decline_connection(local_cid, L2CAP_CBM_CONNECTION_RESULT_NO_RESOURCES_AVAILABLE);
+}
+
+BleError L2capChannel::SendSdu(const uint8_t* data, uint16_t size) {
+	// LE credit-based channels keep the pointer and send from it until
+	// L2CAP_EVENT_PACKET_SENT.
+	return ToBleError(l2cap_send(local_cid_, data, size));
+}
+
+BleError L2capChannel::RequestCanSendNowEvent() {
+	return ToBleError(l2cap_request_can_send_now_event(local_cid_));
+}
+
+BleError L2capChannel::GrantCredits(uint16_t credits) {
+	return ToBleError(l2cap_cbm_provide_credits(local_cid_, credits));
+}
+
+BleError L2capChannel::DisconnectChannel() {
+	return ToBleError(l2cap_disconnect(local_cid_));
+}
+
+}  // namespace c7222
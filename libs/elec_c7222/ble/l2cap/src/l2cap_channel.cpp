@@ -0,0 +1,240 @@
+#include "l2cap_channel.hpp"
+
+#include <algorithm>
+
+#include "ble_utils.hpp"
+
+namespace c7222 {
+
+std::list<L2capChannel*> L2capChannel::channels_;
+
+L2capChannel::L2capChannel(const Config& config) : config_(config) {
+	config_.mtu = std::max(config_.mtu, kMinMtu);
+	receive_buffer_.resize(config_.mtu);
+	channels_.push_back(this);
+}
+
+L2capChannel::~L2capChannel() {
+	if(state_ == State::kOpen || state_ == State::kOpening) {
+		(void)DisconnectChannel();
+	}
+	if(listening_) {
+		(void)UnregisterService();
+	}
+	channels_.remove(this);
+}
+
+BleError L2capChannel::Listen() {
+	if(listening_) {
+		return BleError::kSuccess;
+	}
+	const L2capChannel* other = FindByPsm(config_.psm);
+	if(other != nullptr) {
+		return BleError::kL2capServiceAlreadyRegistered;
+	}
+	const BleError status = RegisterService();
+	if(status != BleError::kSuccess) {
+		return status;
+	}
+	listening_ = true;
+	if(state_ == State::kIdle) {
+		state_ = State::kListening;
+	}
+	C7222_BLE_DEBUG_PRINT("[BLE][L2CAP] Listening on PSM 0x%04x (mtu=%u)\n",
+		static_cast<unsigned>(config_.psm),
+		static_cast<unsigned>(config_.mtu));
+	return BleError::kSuccess;
+}
+
+BleError L2capChannel::StopListening() {
+	if(!listening_) {
+		return BleError::kL2capServiceDoesNotExist;
+	}
+	const BleError status = UnregisterService();
+	listening_ = false;
+	if(state_ == State::kListening) {
+		state_ = State::kIdle;
+	}
+	return status;
+}
+
+BleError L2capChannel::Disconnect() {
+	if(state_ != State::kOpen && state_ != State::kOpening) {
+		return BleError::kCommandDisallowed;
+	}
+	const BleError status = DisconnectChannel();
+	if(status == BleError::kSuccess) {
+		state_ = State::kClosing;
+	}
+	return status;
+}
+
+BleError L2capChannel::Send(const uint8_t* data, uint16_t size) {
+	if(state_ != State::kOpen || (data == nullptr && size != 0)) {
+		return BleError::kCommandDisallowed;
+	}
+	if(size > remote_mtu_) {
+		return BleError::kL2capDataLenExceedsRemoteMtu;
+	}
+	if(send_in_progress_) {
+		return BleError::kBtstackAclBuffersFull;
+	}
+	const BleError status = SendSdu(data, size);
+	if(status == BleError::kSuccess) {
+		send_in_progress_ = true;
+		++sdus_sent_;
+		bytes_sent_ += size;
+	}
+	return status;
+}
+
+BleError L2capChannel::RequestCanSendNow() {
+	if(state_ != State::kOpen) {
+		return BleError::kCommandDisallowed;
+	}
+	return RequestCanSendNowEvent();
+}
+
+BleError L2capChannel::ProvideCredits(uint16_t credits) {
+	if(state_ != State::kOpen || config_.initial_credits == 0) {
+		return BleError::kCommandDisallowed;
+	}
+	return GrantCredits(credits);
+}
+
+void L2capChannel::ResetCounters() {
+	sdus_sent_ = 0;
+	bytes_sent_ = 0;
+	sdus_received_ = 0;
+	bytes_received_ = 0;
+}
+
+void L2capChannel::AddEventHandler(const EventHandler& handler) {
+	handlers_.push_back(&handler);
+}
+
+bool L2capChannel::RemoveEventHandler(const EventHandler& handler) {
+	const auto it = std::find(handlers_.begin(), handlers_.end(), &handler);
+	if(it == handlers_.end()) {
+		return false;
+	}
+	handlers_.erase(it);
+	return true;
+}
+
+BleError L2capChannel::DispatchPacket(uint8_t packet_type,
+									  uint16_t channel,
+									  const uint8_t* packet_data,
+									  uint16_t packet_data_size) {
+	const L2capEvent event = DecodeEvent(packet_type, channel, packet_data, packet_data_size);
+	switch(event.type) {
+	case L2capEvent::Type::kNone:
+		return BleError::kSuccess;
+	case L2capEvent::Type::kIncomingConnection: {
+		L2capChannel* target = FindByPsm(event.psm);
+		if(target == nullptr || target->state_ != State::kListening) {
+			C7222_BLE_DEBUG_PRINT("[BLE][L2CAP] Decline PSM 0x%04x cid=0x%04x\n",
+				static_cast<unsigned>(event.psm),
+				static_cast<unsigned>(event.local_cid));
+			DeclineConnection(event.local_cid);
+			return BleError::kSuccess;
+		}
+		target->HandleEvent(event);
+		return BleError::kSuccess;
+	}
+	default: {
+		L2capChannel* target = FindByCid(event.local_cid);
+		if(target == nullptr) {
+			return BleError::kL2capLocalCidDoesNotExist;
+		}
+		target->HandleEvent(event);
+		return BleError::kSuccess;
+	}
+	}
+}
+
+void L2capChannel::HandleEvent(const L2capEvent& event) {
+	switch(event.type) {
+	case L2capEvent::Type::kIncomingConnection: {
+		const BleError status = AcceptConnection(event.local_cid);
+		if(status != BleError::kSuccess) {
+			DeclineConnection(event.local_cid);
+			return;
+		}
+		local_cid_ = event.local_cid;
+		connection_handle_ = event.connection_handle;
+		state_ = State::kOpening;
+		break;
+	}
+	case L2capEvent::Type::kChannelOpened:
+		if(event.status == BleError::kSuccess) {
+			state_ = State::kOpen;
+			remote_mtu_ = event.remote_mtu;
+			connection_handle_ = event.connection_handle;
+			send_in_progress_ = false;
+		} else {
+			ResetConnection();
+		}
+		C7222_BLE_DEBUG_PRINT("[BLE][L2CAP] Channel 0x%04x opened status=%u remote_mtu=%u\n",
+			static_cast<unsigned>(event.local_cid),
+			static_cast<unsigned>(event.status),
+			static_cast<unsigned>(event.remote_mtu));
+		for(const auto* handler: handlers_) {
+			handler->OnOpened(*this, event.status);
+		}
+		break;
+	case L2capEvent::Type::kChannelClosed:
+		ResetConnection();
+		for(const auto* handler: handlers_) {
+			handler->OnClosed(*this);
+		}
+		break;
+	case L2capEvent::Type::kCanSendNow:
+		for(const auto* handler: handlers_) {
+			handler->OnCanSendNow(*this);
+		}
+		break;
+	case L2capEvent::Type::kPacketSent:
+		send_in_progress_ = false;
+		for(const auto* handler: handlers_) {
+			handler->OnSendComplete(*this);
+		}
+		break;
+	case L2capEvent::Type::kData:
+		++sdus_received_;
+		bytes_received_ += event.data_size;
+		for(const auto* handler: handlers_) {
+			handler->OnData(*this, event.data, event.data_size);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void L2capChannel::ResetConnection() {
+	state_ = listening_ ? State::kListening : State::kIdle;
+	local_cid_ = 0;
+	connection_handle_ = 0;
+	remote_mtu_ = 0;
+	send_in_progress_ = false;
+}
+
+L2capChannel* L2capChannel::FindByPsm(uint16_t psm) {
+	const auto it = std::find_if(channels_.begin(), channels_.end(), [psm](const L2capChannel* channel) {
+		return channel->listening_ && channel->config_.psm == psm;
+	});
+	return it != channels_.end() ? *it : nullptr;
+}
+
+L2capChannel* L2capChannel::FindByCid(uint16_t local_cid) {
+	if(local_cid == 0) {
+		return nullptr;
+	}
+	const auto it = std::find_if(channels_.begin(), channels_.end(), [local_cid](const L2capChannel* channel) {
+		return channel->local_cid_ == local_cid;
+	});
+	return it != channels_.end() ? *it : nullptr;
+}
+
+}  // namespace c7222
@@ -3,6 +3,15 @@
 
 namespace c7222 {
 
+extern "C" {
+/// Monotonic time of the simulated stack.
+uint32_t c7222_grader_get_time_ms(void);
+}
+
+uint32_t GetBleTimeMs() {
+	return c7222_grader_get_time_ms();
+}
+
 Ble::Ble()
 	: gap_(Gap::GetInstance()),
 	  security_manager_(nullptr),
@@ -30,12 +39,10 @@ BleError Ble::DispatchBleHciPacket(uint8_t packet_type,
 								   uint8_t channel,
 								   const uint8_t* packet_data,
 								   uint16_t packet_data_size) {
-	(void)packet_type;
 	(void)channel;
-	(void)packet_data;
-	(void)packet_data_size;
 	C7222_BLE_DEBUG_PRINT("[BLE] Dispatch HCI packet (grader)\n");
-	return BleError::kSuccess;
+	assert(gap_ != nullptr && "Gap instance is null in Ble::DispatchBleHciPacket");
+	return gap_->DispatchBleHciPacket(packet_type, packet_data, packet_data_size);
 }
 
 void Ble::EnableHCILoggingToStdout() {
@@ -33,6 +33,10 @@ void sm_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t* packet, u
 
 } // namespace
 
+uint32_t GetBleTimeMs() {
+	return btstack_run_loop_get_time_ms();
+}
+
 struct BleContext {
 	bool l2cap_initialized = false;
 	bool sm_initialized = false;
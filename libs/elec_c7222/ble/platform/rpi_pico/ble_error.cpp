@@ -151,6 +151,10 @@ constexpr BleErrorMapEntry kBleErrorMap[] = {
 	{BleError::kAttErrorInsufficientAuthorization, ATT_ERROR_INSUFFICIENT_AUTHORIZATION},
 	{BleError::kAttErrorInvalidAttrValueLength, ATT_ERROR_INVALID_ATTRIBUTE_VALUE_LENGTH},
 	{BleError::kAttErrorInsufficientEncryption, ATT_ERROR_INSUFFICIENT_ENCRYPTION},
+	{BleError::kAttErrorInvalidOffset, ATT_ERROR_INVALID_OFFSET},
+	{BleError::kAttErrorPrepareQueueFull, ATT_ERROR_PREPARE_QUEUE_FULL},
+	{BleError::kAttErrorDatabaseOutOfSync, ATT_ERROR_DATABASE_OUT_OF_SYNC},
+	{BleError::kAttErrorValueNotAllowed, ATT_ERROR_VALUE_NOT_ALLOWED},
 
 	{BleError::kGattClientNotConnected, GATT_CLIENT_NOT_CONNECTED},
 	{BleError::kGattClientBusy, GATT_CLIENT_BUSY},
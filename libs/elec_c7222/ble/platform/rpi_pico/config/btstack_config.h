@@ -14,6 +14,12 @@
 #define ENABLE_LOG_INFO
 #define ENABLE_LOG_ERROR
 #define ENABLE_PRINTF_HEXDUMP
+// Allow ATT read/write callbacks to answer later (deferred GATT responses)
+#define ENABLE_ATT_DELAYED_RESPONSE
+// LE Data Length Extension: up to 251-octet LL packets (Gap::SetDataLength)
+#define ENABLE_LE_DATA_LENGTH_EXTENSION
+// LE credit-based L2CAP channels (L2capChannel, l2cap_cbm_* API)
+#define ENABLE_L2CAP_LE_CREDIT_BASED_FLOW_CONTROL_MODE
 
 // For the client
 #if RUNNING_AS_CLIENT
@@ -27,7 +33,11 @@
 #define HCI_OUTGOING_PRE_BUFFER_SIZE 4
 #define HCI_ACL_PAYLOAD_SIZE (255 + 4)
 #define HCI_ACL_CHUNK_SIZE_ALIGNMENT 4
-#define MAX_NR_HCI_CONNECTIONS 1
+// Simultaneous LE connections; AttributeServer::kMaxConnections uses the same value.
+#ifndef C7222_BLE_MAX_CONNECTIONS
+#define C7222_BLE_MAX_CONNECTIONS 3
+#endif
+#define MAX_NR_HCI_CONNECTIONS C7222_BLE_MAX_CONNECTIONS
 #define MAX_NR_SM_LOOKUP_ENTRIES 3
 #define MAX_NR_WHITELIST_ENTRIES 16
 #define MAX_NR_LE_DEVICE_DB_ENTRIES 16
@@ -43,8 +53,9 @@
 #define HCI_HOST_SCO_PACKET_LEN 120
 #define HCI_HOST_SCO_PACKET_NUM 3
 
-// Minimal NVM sizes to satisfy btstack_tlv build (keep bonding off to avoid writes).
-#define NVM_NUM_DEVICE_DB_ENTRIES 2
+// Bonds persisted through the TLV when SecurityManager uses BondStorage::kFlash
+// (one record of about 100 bytes each; fits a single 4 KB bank).
+#define NVM_NUM_DEVICE_DB_ENTRIES 8
 #define NVM_NUM_LINK_KEYS 2
 // Disable persistent CCC storage.
 #define NVN_NUM_GATT_SERVER_CCC 16
@@ -59,6 +70,8 @@
 // Some USB dongles take longer to respond to HCI reset
 #define HCI_RESET_RESEND_TIMEOUT_MS 1000
 #define ENABLE_SOFTWARE_AES128
+// LE Secure Connections pairing (P-256 in software via micro-ecc)
+#define ENABLE_LE_SECURE_CONNECTIONS
 #define ENABLE_MICRO_ECC_FOR_LE_SECURE_CONNECTIONS
 
 #endif
@@ -5,11 +5,18 @@
 #ifndef ELEC_C7222_BLE_SECURITY_MANAGER_H_
 #define ELEC_C7222_BLE_SECURITY_MANAGER_H_
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <deque>
 #include <iosfwd>
 #include <list>
+#include <memory>
+#include <vector>
 
 #include "ble_error.hpp"
+#include "ecc_worker.hpp"
+#include "flash_storage.hpp"
 #include "gap.hpp"
 #include "non_copyable.hpp"
 
@@ -66,6 +73,34 @@ namespace c7222 {
  * security requirements of your GATT database.
  *
  * ---
+ * ### Bond Storage
+ *
+ * By default bonds are kept in RAM and every reset forces the peer to pair
+ * again. Set `bond_storage = BondStorage::kFlash` to keep them in a
+ * `FlashStorage` region (the two sectors below the SDK's BTstack flash bank
+ * unless `bond_storage_region` says otherwise); a bonded peer then re-encrypts with
+ * its stored LTK, which skips the key exchange entirely. On the grader the
+ * region is emulated by a file (see `FlashStorage`).
+ *
+ * ---
+ * ### LE Secure Connections Key Material
+ *
+ * LE Secure Connections pairing needs a P-256 key pair and one ECDH (DH key)
+ * computation per pairing, each a few hundred milliseconds of software
+ * arithmetic on the RP2350. By default BTstack runs both on its run loop,
+ * which stalls every other connection while they run. Set
+ * `precompute_sc_keys` to move them to a low-priority task (`EccWorker`):
+ * the key pair is generated right after configuration, before the first
+ * pairing, and DH keys are computed on the task while the run loop keeps
+ * serving the stack. `sc_key_task_core` pins the task to one core where the
+ * FreeRTOS port supports it.
+ *
+ * Every pairing is timed (`PairingTiming`): how long the stack took to
+ * prompt the user, how long the user took to answer, the DH key time, and
+ * the total. The result is passed to `EventHandler::OnPairingTiming()` and
+ * kept in `GetLastPairingTiming()`.
+ *
+ * ---
  * ### Typical Usage
  *
  * @code
@@ -278,6 +313,23 @@ class SecurityManager : public NonCopyableNonMovable {
 		kLevel4 = 4,
 	};
 
+	/**
+	 * @brief Where bonding information (LTKs, IRKs, addresses) is kept.
+	 */
+	enum class BondStorage : uint8_t {
+		/**
+		 * @brief Bonds live in RAM only and are lost on reset (default).
+		 */
+		kVolatile = 0,
+		/**
+		 * @brief Bonds are persisted in a reserved flash region.
+		 *
+		 * Bonded peers re-encrypt with the stored LTK after a reset instead of
+		 * pairing again.
+		 */
+		kFlash = 1,
+	};
+
 	/**
 	 * @brief Cached security configuration parameters.
 	 */
@@ -321,8 +373,79 @@ class SecurityManager : public NonCopyableNonMovable {
 		 * @brief Role used for fixed passkey display/input.
 		 */
 		FixedPasskeyRole fixed_passkey_role = FixedPasskeyRole::kNone;
+		/**
+		 * @brief Bond storage backend.
+		 */
+		BondStorage bond_storage = BondStorage::kVolatile;
+		/**
+		 * @brief Flash region for `BondStorage::kFlash`.
+		 *
+		 * A zero `bank_size` selects GetDefaultBondStorageRegion(). The region is
+		 * opened on the first apply and kept for the lifetime of the program.
+		 */
+		FlashStorage::Config bond_storage_region{};
+		/**
+		 * @brief Generate the LE Secure Connections key pair ahead of time and
+		 * compute DH keys on a low-priority task instead of the BLE run loop.
+		 */
+		bool precompute_sc_keys = false;
+		/**
+		 * @brief Core for the key task (-1 = any core).
+		 *
+		 * Only honoured by SMP FreeRTOS builds with core affinity enabled.
+		 */
+		int8_t sc_key_task_core = -1;
 	};
 
+	/**
+	 * @brief LE Secure Connections key material counters.
+	 */
+	struct ScKeyStats {
+		/// @brief The precomputed key pair is available.
+		bool key_pair_ready = false;
+		/// @brief Time the task spent generating the key pair (ms).
+		uint32_t key_pair_ms = 0;
+		/// @brief DH keys computed on the key task.
+		uint32_t dhkeys_offloaded = 0;
+		/// @brief DH keys computed by the stack on its run loop.
+		uint32_t dhkeys_inline = 0;
+		/// @brief Duration of the last DH key computation (ms).
+		uint32_t last_dhkey_ms = 0;
+		/// @brief Longest DH key computation (ms).
+		uint32_t max_dhkey_ms = 0;
+		/// @brief Failed key pair or DH key computations.
+		uint32_t failures = 0;
+	};
+
+	/**
+	 * @brief Duration of the phases of one pairing (all in ms).
+	 */
+	struct PairingTiming {
+		/// @brief Connection that paired.
+		ConnectionHandle connection_handle = 0;
+		/// @brief High-level pairing status.
+		PairingStatus status = PairingStatus::kFailed;
+		/// @brief Pairing start to pairing complete.
+		uint32_t total_ms = 0;
+		/// @brief A user prompt (Just Works, numeric comparison, passkey) was raised.
+		bool prompted = false;
+		/// @brief Pairing start to the first user prompt.
+		uint32_t prompt_ms = 0;
+		/// @brief User prompt to the application's answer.
+		uint32_t user_ms = 0;
+		/// @brief Answer (or prompt, if unanswered) to pairing complete.
+		uint32_t finish_ms = 0;
+		/// @brief DH key computation (0 for legacy pairing).
+		uint32_t dhkey_ms = 0;
+		/// @brief The DH key was computed on the key task.
+		bool dhkey_offloaded = false;
+	};
+
+	/**
+	 * @brief Completion callback of the stack's crypto requests.
+	 */
+	using CryptoCallback = void (*)(void* context);
+
 	/**
 	 * @brief Security Manager event callback interface.
 	 *
@@ -381,6 +504,11 @@ class SecurityManager : public NonCopyableNonMovable {
 		 */
 		virtual void OnAuthorizationResult(ConnectionHandle connection_handle,
 										   AuthorizationResult result) const {}
+		/**
+		 * @brief Called after `OnPairingComplete()` with the phase timing.
+		 * @param timing Duration of each phase of the pairing.
+		 */
+		virtual void OnPairingTiming(const PairingTiming& timing) const {}
 
 	   protected:
 		~EventHandler() = default;
@@ -465,6 +593,68 @@ class SecurityManager : public NonCopyableNonMovable {
 		return applied_;
 	}
 
+	// -----------------------------------------------------------------
+	// Bond storage
+	// -----------------------------------------------------------------
+
+	/**
+	 * @brief Set the bond storage backend.
+	 */
+	BleError SetBondStorage(BondStorage storage);
+
+	/**
+	 * @brief Get the flash store holding the bonds.
+	 *
+	 * @return nullptr unless `BondStorage::kFlash` has been applied
+	 */
+	[[nodiscard]] FlashStorage* GetBondStorage() const {
+		return bond_storage_.get();
+	}
+
+	/**
+	 * @brief Forget all bonded devices (RAM and flash).
+	 */
+	BleError DeleteAllBonds();
+
+	/**
+	 * @brief Default bond region: the two sectors below `FlashStorage::GetStorageLimit()`.
+	 *
+	 * The last two sectors are the SDK's BTstack flash bank, which
+	 * `cyw43_arch_init()` opens before the bond storage replaces it.
+	 */
+	[[nodiscard]] static FlashStorage::Config GetDefaultBondStorageRegion();
+
+	// -----------------------------------------------------------------
+	// LE Secure Connections key material
+	// -----------------------------------------------------------------
+
+	/**
+	 * @brief Enable or disable the precomputed key pair and off-loop DH keys.
+	 *
+	 * The key task starts on the first apply with `enabled` set and keeps
+	 * running; disabling it only affects key pairs the stack requests later.
+	 */
+	BleError SetScKeyPrecomputation(bool enabled, int8_t core = -1);
+
+	/**
+	 * @brief Check whether the precomputed key pair is available.
+	 */
+	[[nodiscard]] bool IsScKeyPairReady() const {
+		return key_worker_ != nullptr && key_worker_->IsKeyPairReady();
+	}
+
+	/**
+	 * @brief Get the key material counters.
+	 */
+	[[nodiscard]] ScKeyStats GetScKeyStats() const;
+
+	/**
+	 * @brief Get the timing of the last completed pairing.
+	 */
+	[[nodiscard]] PairingTiming GetLastPairingTiming() const {
+		return last_pairing_timing_;
+	}
+
 	/**
 	 * @brief Validate that the current configuration can satisfy requirements.
 	 *
@@ -535,11 +725,100 @@ class SecurityManager : public NonCopyableNonMovable {
 	 */
 	BleError DispatchBleHciPacket(uint8_t packet_type, const uint8_t* packet, uint16_t size);
 
+	// -----------------------------------------------------------------
+	// Stack crypto integration (internal)
+	// -----------------------------------------------------------------
+
+	/**
+	 * @brief Serve the stack's P-256 key pair request from the key task.
+	 *
+	 * On success `callback` runs later on the BLE stack context, once
+	 * `public_key` holds the key pair's public key.
+	 *
+	 * @return kCommandDisallowed when precomputation is off; the stack then
+	 *         generates the key itself
+	 */
+	BleError RequestScKeyPair(uint8_t* public_key, CryptoCallback callback, void* context);
+
+	/**
+	 * @brief Compute a DH key on the key task.
+	 *
+	 * Only accepted when the stack uses the key pair handed out by
+	 * `RequestScKeyPair()`. `callback` runs on the BLE stack context once
+	 * `dhkey` is filled.
+	 *
+	 * @return kCommandDisallowed when the stack must compute it itself
+	 */
+	BleError RequestScDhKey(const uint8_t* peer_public_key,
+							uint8_t* dhkey,
+							CryptoCallback callback,
+							void* context);
+
+	/**
+	 * @brief Record a DH key the stack computed on its run loop.
+	 */
+	void NoteInlineDhKey(uint32_t duration_ms);
+
+	/**
+	 * @brief Run work handed over by the key task (BLE stack context).
+	 *
+	 * Completes the key pair and DH key requests whose results are ready.
+	 */
+	void ProcessStackWork();
+
    private:
 	SecurityManager() = default;
 	~SecurityManager() = default;
 
+	/**
+	 * @brief Timestamps of a pairing in progress.
+	 */
+	struct PairingTrace {
+		ConnectionHandle connection_handle = 0;
+		uint32_t started_ms = 0;
+		uint32_t prompted_ms = 0;
+		uint32_t answered_ms = 0;
+		bool prompted = false;
+		bool answered = false;
+		bool dhkey = false;
+		uint32_t dhkey_ms = 0;
+		bool dhkey_offloaded = false;
+	};
+
+	/**
+	 * @brief DH key request waiting for (or running on) the key task.
+	 */
+	struct DhKeyRequest {
+		std::array<uint8_t, EccWorker::kPublicKeySize> peer_public_key{};
+		uint8_t* dhkey = nullptr;
+		CryptoCallback callback = nullptr;
+		void* context = nullptr;
+	};
+
+	/// @brief Pairings timed at once (one per connection).
+	static constexpr size_t kMaxPairingTraces = 4;
+
 	BleError ApplyConfiguration();
+	/// @brief Open the flash store for `BondStorage::kFlash` (once).
+	BleError OpenBondStorage();
+	/// @brief Start the key task for `precompute_sc_keys` (once).
+	BleError StartScKeyWorker();
+
+	/// @brief Ask for `ProcessStackWork()` to run on the BLE stack context.
+	void RequestStackWork();
+	/// @brief Run `ProcessStackWork()` on the BLE stack context (platform-specific).
+	static void ScheduleStackWork();
+
+	/// \name Pairing Timing
+	///@{
+	PairingTrace* FindPairingTrace(ConnectionHandle con_handle, bool create);
+	void NotePairingStarted(ConnectionHandle con_handle);
+	void NoteUserPrompt(ConnectionHandle con_handle);
+	void NoteUserResponse(ConnectionHandle con_handle);
+	void NoteDhKey(uint32_t duration_ms, bool offloaded);
+	/// @brief Finish the trace of `con_handle` and dispatch `OnPairingTiming()`.
+	void FinishPairingTiming(ConnectionHandle con_handle, PairingStatus status);
+	///@}
 
 	void DispatchJustWorksRequest(ConnectionHandle con_handle) const;
 	void DispatchNumericComparisonRequest(ConnectionHandle con_handle, uint32_t number) const;
@@ -551,11 +830,30 @@ class SecurityManager : public NonCopyableNonMovable {
 	void DispatchReencryptionComplete(ConnectionHandle con_handle, uint8_t status) const;
 	void DispatchAuthorizationRequest(ConnectionHandle con_handle) const;
 	void DispatchAuthorizationResult(ConnectionHandle con_handle, AuthorizationResult result) const;
+	void DispatchPairingTiming(const PairingTiming& timing) const;
 
 	static SecurityManager* instance_;
 
 	SecurityParameters params_{};
 	std::list<const EventHandler*> handlers_{};
+	std::unique_ptr<FlashStorage> bond_storage_;
+	std::unique_ptr<EccWorker> key_worker_;
+	/// @brief Stack key pair request waiting for the key task.
+	uint8_t* pending_key_pair_ = nullptr;
+	CryptoCallback pending_key_pair_callback_ = nullptr;
+	void* pending_key_pair_context_ = nullptr;
+	/// @brief The stack uses the key task's key pair, so DH keys must go there too.
+	bool key_pair_supplied_ = false;
+	/// @brief DH key requests; the front one runs when `dhkey_running_`.
+	std::deque<DhKeyRequest> dhkey_requests_;
+	bool dhkey_running_ = false;
+	uint32_t dhkeys_offloaded_ = 0;
+	uint32_t dhkeys_inline_ = 0;
+	uint32_t last_dhkey_ms_ = 0;
+	uint32_t max_dhkey_ms_ = 0;
+	std::atomic<bool> stack_work_scheduled_{false};
+	std::vector<PairingTrace> pairing_traces_;
+	PairingTiming last_pairing_timing_{};
 	bool configured_ = false;
 	bool applied_ = false;
 };
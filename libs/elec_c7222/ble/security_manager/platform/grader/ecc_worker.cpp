@@ -0,0 +1,24 @@
+#include "ecc_worker.hpp"
+
+namespace c7222 {
+
+extern "C" {
+/**
+ * Simulated P-256 arithmetic (big-endian X || Y public keys, as BTstack).
+ * Return true on success.
+ */
+bool c7222_grader_sm_ecc_generate_key_pair(uint8_t public_key[64], uint8_t private_key[32]);
+bool c7222_grader_sm_ecc_compute_dhkey(const uint8_t peer_public_key[64],
+									   const uint8_t private_key[32],
+									   uint8_t dhkey[32]);
+}
+
+bool EccWorker::GenerateKeyPair(uint8_t* public_key, uint8_t* private_key) {
+	return c7222_grader_sm_ecc_generate_key_pair(public_key, private_key);
+}
+
+bool EccWorker::ComputeDhKey(const uint8_t* peer_public_key, const uint8_t* private_key, uint8_t* dhkey) {
+	return c7222_grader_sm_ecc_compute_dhkey(peer_public_key, private_key, dhkey);
+}
+
+}  // namespace c7222
@@ -3,6 +3,55 @@
 
 namespace c7222 {
 
+extern "C" {
+/// The harness calls SecurityManager::ProcessStackWork() on its stack context.
+void c7222_grader_sm_schedule_stack_work(void);
+/// Pairing responses forwarded to the simulated stack (as sm_just_works_confirm() etc.).
+void c7222_grader_sm_just_works_confirm(uint16_t connection_handle);
+void c7222_grader_sm_numeric_comparison_confirm(uint16_t connection_handle, bool accept);
+void c7222_grader_sm_passkey_input(uint16_t connection_handle, uint32_t passkey);
+}
+
+namespace {
+
+// BTstack SM event layout used by the simulated stack
+constexpr uint8_t kHciEventPacket = 0x04;
+constexpr uint8_t kSmEventJustWorksRequest = 0xC8;
+constexpr uint8_t kSmEventPasskeyDisplayNumber = 0xC9;
+constexpr uint8_t kSmEventPasskeyInputNumber = 0xCB;
+constexpr uint8_t kSmEventNumericComparisonRequest = 0xCC;
+constexpr uint8_t kSmEventAuthorizationRequest = 0xD0;
+constexpr uint8_t kSmEventAuthorizationResult = 0xD1;
+constexpr uint8_t kSmEventPairingStarted = 0xD4;
+constexpr uint8_t kSmEventPairingComplete = 0xD5;
+constexpr uint8_t kSmEventReencryptionComplete = 0xD7;
+// Every SM event starts with handle (2), address type (1), address (6).
+constexpr uint16_t kSmEventPayloadOffset = 11;
+
+uint16_t ReadLe16(const uint8_t* data) {
+	return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+uint32_t ReadLe32(const uint8_t* data) {
+	return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+		   (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+SecurityManager::PairingStatus ClassifyPairingStatus(uint8_t status_code) {
+	switch(status_code) {
+		case 0x00:
+			return SecurityManager::PairingStatus::kSuccess;
+		case 0x08:	// ERROR_CODE_CONNECTION_TIMEOUT
+			return SecurityManager::PairingStatus::kTimeout;
+		case 0x11:	// ERROR_CODE_UNSUPPORTED_FEATURE_OR_PARAMETER_VALUE
+			return SecurityManager::PairingStatus::kUnsupported;
+		default:
+			return SecurityManager::PairingStatus::kFailed;
+	}
+}
+
+}  // namespace
+
 bool SecurityManager::ValidateConfiguration(bool authentication_required,
 											bool authorization_required,
 											bool encryption_required) const {
@@ -51,22 +100,53 @@ bool SecurityManager::ValidateConfiguration(bool authentication_required,
 
 BleError SecurityManager::ApplyConfiguration() {
 	C7222_BLE_DEBUG_PRINT("[BLE][SM] Apply configuration (grader)\n");
+	if(params_.bond_storage == BondStorage::kFlash) {
+		const BleError err = OpenBondStorage();
+		if(err != BleError::kSuccess) {
+			return err;
+		}
+	}
+	if(params_.precompute_sc_keys) {
+		return StartScKeyWorker();
+	}
 	return BleError::kSuccess;
 }
 
-BleError SecurityManager::ConfirmJustWorks(ConnectionHandle) {
-	C7222_BLE_DEBUG_PRINT("[BLE][SM] Confirm Just Works (grader)\n");
-	return BleError::kUnsupportedFeatureOrParameterValue;
+void SecurityManager::ScheduleStackWork() {
+	c7222_grader_sm_schedule_stack_work();
 }
 
-BleError SecurityManager::ConfirmNumericComparison(ConnectionHandle, bool) {
-	C7222_BLE_DEBUG_PRINT("[BLE][SM] Confirm numeric comparison (grader)\n");
-	return BleError::kUnsupportedFeatureOrParameterValue;
+BleError SecurityManager::DeleteAllBonds() {
+	C7222_BLE_DEBUG_PRINT("[BLE][SM] Delete all bonds (grader)\n");
+	if(bond_storage_ != nullptr && !bond_storage_->Format()) {
+		return BleError::kHardwareFailure;
+	}
+	return BleError::kSuccess;
 }
 
-BleError SecurityManager::ProvidePasskey(ConnectionHandle, uint32_t) {
-	C7222_BLE_DEBUG_PRINT("[BLE][SM] Provide passkey (grader)\n");
-	return BleError::kUnsupportedFeatureOrParameterValue;
+BleError SecurityManager::ConfirmJustWorks(ConnectionHandle con_handle) {
+	C7222_BLE_DEBUG_PRINT("[BLE][SM] Confirm Just Works handle=0x%04x (grader)\n",
+		static_cast<unsigned>(con_handle));
+	NoteUserResponse(con_handle);
+	c7222_grader_sm_just_works_confirm(con_handle);
+	return BleError::kSuccess;
+}
+
+BleError SecurityManager::ConfirmNumericComparison(ConnectionHandle con_handle, bool accept) {
+	C7222_BLE_DEBUG_PRINT("[BLE][SM] Confirm numeric comparison handle=0x%04x accept=%u (grader)\n",
+		static_cast<unsigned>(con_handle),
+		static_cast<unsigned>(accept));
+	NoteUserResponse(con_handle);
+	c7222_grader_sm_numeric_comparison_confirm(con_handle, accept);
+	return BleError::kSuccess;
+}
+
+BleError SecurityManager::ProvidePasskey(ConnectionHandle con_handle, uint32_t passkey) {
+	C7222_BLE_DEBUG_PRINT("[BLE][SM] Provide passkey handle=0x%04x (grader)\n",
+		static_cast<unsigned>(con_handle));
+	NoteUserResponse(con_handle);
+	c7222_grader_sm_passkey_input(con_handle, passkey);
+	return BleError::kSuccess;
 }
 
 BleError SecurityManager::RequestPairing(ConnectionHandle) {
@@ -79,9 +159,74 @@ BleError SecurityManager::SetAuthorization(ConnectionHandle, AuthorizationResult
 	return BleError::kUnsupportedFeatureOrParameterValue;
 }
 
-BleError SecurityManager::DispatchBleHciPacket(uint8_t, const uint8_t*, uint16_t) {
-	C7222_BLE_DEBUG_PRINT("[BLE][SM] Dispatch HCI packet (grader)\n");
-	return BleError::kSuccess;
+BleError SecurityManager::DispatchBleHciPacket(uint8_t packet_type, const uint8_t* packet, uint16_t size) {
+	if(packet_type != kHciEventPacket) {
+		return BleError::kUnsupportedFeatureOrParameterValue;
+	}
+	if(packet == nullptr || size < kSmEventPayloadOffset) {
+		return BleError::kSuccess;
+	}
+	const uint8_t event = packet[0];
+	const ConnectionHandle con_handle = ReadLe16(&packet[2]);
+	C7222_BLE_DEBUG_PRINT("[BLE][SM] HCI event=0x%02x (grader)\n",
+		static_cast<unsigned>(event));
+	const uint8_t* payload = &packet[kSmEventPayloadOffset];
+	const uint16_t payload_size = static_cast<uint16_t>(size - kSmEventPayloadOffset);
+	switch(event) {
+		case kSmEventPairingStarted:
+			NotePairingStarted(con_handle);
+			return BleError::kSuccess;
+		case kSmEventJustWorksRequest:
+			NoteUserPrompt(con_handle);
+			DispatchJustWorksRequest(con_handle);
+			return BleError::kSuccess;
+		case kSmEventNumericComparisonRequest:
+			if(payload_size < 4) {
+				return BleError::kSuccess;
+			}
+			NoteUserPrompt(con_handle);
+			DispatchNumericComparisonRequest(con_handle, ReadLe32(payload));
+			return BleError::kSuccess;
+		case kSmEventPasskeyDisplayNumber:
+			if(payload_size < 4) {
+				return BleError::kSuccess;
+			}
+			NoteUserPrompt(con_handle);
+			DispatchPasskeyDisplay(con_handle, ReadLe32(payload));
+			return BleError::kSuccess;
+		case kSmEventPasskeyInputNumber:
+			NoteUserPrompt(con_handle);
+			DispatchPasskeyInput(con_handle);
+			return BleError::kSuccess;
+		case kSmEventPairingComplete: {
+			if(payload_size < 1) {
+				return BleError::kSuccess;
+			}
+			const uint8_t status_code = payload[0];
+			DispatchPairingComplete(con_handle, ClassifyPairingStatus(status_code), status_code);
+			FinishPairingTiming(con_handle, ClassifyPairingStatus(status_code));
+			return BleError::kSuccess;
+		}
+		case kSmEventReencryptionComplete:
+			if(payload_size < 1) {
+				return BleError::kSuccess;
+			}
+			DispatchReencryptionComplete(con_handle, payload[0]);
+			return BleError::kSuccess;
+		case kSmEventAuthorizationRequest:
+			DispatchAuthorizationRequest(con_handle);
+			return BleError::kSuccess;
+		case kSmEventAuthorizationResult:
+			if(payload_size < 1) {
+				return BleError::kSuccess;
+			}
+			DispatchAuthorizationResult(con_handle,
+										payload[0] != 0 ? AuthorizationResult::kGranted
+														: AuthorizationResult::kDenied);
+			return BleError::kSuccess;
+		default:
+			return BleError::kSuccess;
+	}
 }
 
 }  // namespace c7222
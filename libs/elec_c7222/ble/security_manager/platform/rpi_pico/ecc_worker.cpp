@@ -0,0 +1,55 @@
+#include "ecc_worker.hpp"
+
+#include <cstring>
+
+#include "hardware/resets.h"
+#include "hardware/structs/trng.h"
+#include "hardware/sync.h"
+#include "uECC.h"
+
+namespace c7222 {
+
+namespace {
+// Private keys come straight from the RP2350 TRNG, not from the pico_rand
+// PRNG. Each collection yields 192 bits (EHR_DATA0..5). pico_rand samples
+// the same block, so registers are only touched under its spin lock, which
+// is released while a collection is in progress.
+int FillRandom(uint8_t* dest, unsigned size) {
+	unreset_block_wait(RESETS_RESET_TRNG_BITS);
+	spin_lock_t* lock = spin_lock_instance(PICO_SPINLOCK_ID_RAND);
+	while(size > 0) {
+		const uint32_t saved_irq = spin_lock_blocking(lock);
+		trng_hw->rnd_source_enable = 1u;
+		if((trng_hw->trng_valid & 1u) != 0) {
+			for(unsigned i = 0; i < 6 && size > 0; ++i) {
+				const uint32_t word = trng_hw->ehr_data[i];
+				const unsigned chunk = size < sizeof(word) ? size : sizeof(word);
+				std::memcpy(dest, &word, chunk);
+				dest += chunk;
+				size -= chunk;
+			}
+			// Clearing EHR_VALID starts the next collection.
+			trng_hw->rng_icr = 0xFFFFFFFFu;
+		}
+		spin_unlock(lock, saved_irq);
+		tight_loop_contents();
+	}
+	return 1;
+}
+}  // namespace
+
+// Same micro-ecc build that BTstack links for ENABLE_MICRO_ECC_FOR_LE_SECURE_CONNECTIONS,
+// seeded from the RP2350 TRNG instead of the controller.
+bool EccWorker::GenerateKeyPair(uint8_t* public_key, uint8_t* private_key) {
+	uECC_set_rng(&FillRandom);
+	return uECC_make_key(public_key, private_key, uECC_secp256r1()) == 1;
+}
+
+bool EccWorker::ComputeDhKey(const uint8_t* peer_public_key, const uint8_t* private_key, uint8_t* dhkey) {
+	if(uECC_valid_public_key(peer_public_key, uECC_secp256r1()) != 1) {
+		return false;
+	}
+	return uECC_shared_secret(peer_public_key, private_key, dhkey, uECC_secp256r1()) == 1;
+}
+
+}  // namespace c7222
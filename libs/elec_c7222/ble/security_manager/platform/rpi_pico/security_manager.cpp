@@ -5,6 +5,11 @@
 #include <btstack.h>
 #include <btstack_config.h>
 
+#include "ble/le_device_db_tlv.h"
+#include "btstack_crypto.h"
+#include "btstack_tlv.h"
+#include "btstack_tlv_none.h"
+
 namespace c7222 {
 namespace {
 
@@ -73,6 +78,45 @@ uint8_t ExpectedSecurityLevel(const SecurityManager::SecurityParameters& params)
 	return auth_bits == 0 ? 0 : 1;
 }
 
+// BTstack TLV adapter over FlashStorage; the context is the store.
+int FlashTlvGetTag(void* context, uint32_t tag, uint8_t* buffer, uint32_t buffer_size) {
+	return static_cast<int>(static_cast<FlashStorage*>(context)->Get(tag, buffer, buffer_size));
+}
+
+int FlashTlvStoreTag(void* context, uint32_t tag, const uint8_t* data, uint32_t data_size) {
+	return static_cast<FlashStorage*>(context)->Store(tag, data, data_size) ? 0 : 1;
+}
+
+void FlashTlvDeleteTag(void* context, uint32_t tag) {
+	(void)static_cast<FlashStorage*>(context)->Delete(tag);
+}
+
+const btstack_tlv_t kFlashTlv = {
+	&FlashTlvGetTag,
+	&FlashTlvStoreTag,
+	&FlashTlvDeleteTag,
+};
+
+// Install a TLV backend for BTstack and the LE device DB (which reloads its entries).
+void InstallTlv(const btstack_tlv_t* tlv_impl, void* tlv_context) {
+	const btstack_tlv_t* current_impl = nullptr;
+	void* current_context = nullptr;
+	btstack_tlv_get_instance(&current_impl, &current_context);
+	if(current_impl == tlv_impl && current_context == tlv_context) {
+		return;
+	}
+	btstack_tlv_set_instance(tlv_impl, tlv_context);
+	le_device_db_tlv_configure(tlv_impl, tlv_context);
+}
+
+// Hands key task results to the BTstack run loop.
+btstack_context_callback_registration_t stack_work_callback;
+
+void stack_work_handler(void* context) {
+	(void)context;
+	SecurityManager::GetInstance()->ProcessStackWork();
+}
+
 }  // namespace
 
 bool SecurityManager::ValidateConfiguration(bool authentication_required,
@@ -163,12 +207,47 @@ BleError SecurityManager::ApplyConfiguration() {
 			break;
 	}
 
+	if(params_.bond_storage == BondStorage::kFlash) {
+		const BleError err = OpenBondStorage();
+		if(err != BleError::kSuccess) {
+			return err;
+		}
+		InstallTlv(&kFlashTlv, bond_storage_.get());
+		AttributeServer::GetInstance()->SetBondStorage(bond_storage_.get());
+	} else if(bond_storage_ != nullptr) {
+		// Back to RAM-only bonds; the flash contents stay for a later switch.
+		InstallTlv(btstack_tlv_none_init_instance(), nullptr);
+		AttributeServer::GetInstance()->SetBondStorage(nullptr);
+	}
+
+	if(params_.precompute_sc_keys) {
+		const BleError err = StartScKeyWorker();
+		if(err != BleError::kSuccess) {
+			return err;
+		}
+	}
+
+	return BleError::kSuccess;
+}
+
+void SecurityManager::ScheduleStackWork() {
+	stack_work_callback.callback = stack_work_handler;
+	stack_work_callback.context = nullptr;
+	btstack_run_loop_execute_on_main_thread(&stack_work_callback);
+}
+
+BleError SecurityManager::DeleteAllBonds() {
+	C7222_BLE_DEBUG_PRINT("[BLE][SM] Delete all bonds\n");
+	for(int index = 0; index < le_device_db_max_count(); ++index) {
+		le_device_db_remove(index);
+	}
 	return BleError::kSuccess;
 }
 
 BleError SecurityManager::ConfirmJustWorks(ConnectionHandle con_handle) {
 	C7222_BLE_DEBUG_PRINT("[BLE][SM] Confirm Just Works handle=0x%04x\n",
 		static_cast<unsigned>(con_handle));
+	NoteUserResponse(con_handle);
 	sm_just_works_confirm(con_handle);
 	return BleError::kSuccess;
 }
@@ -177,6 +256,7 @@ BleError SecurityManager::ConfirmNumericComparison(ConnectionHandle con_handle,
 	C7222_BLE_DEBUG_PRINT("[BLE][SM] Confirm numeric comparison handle=0x%04x accept=%u\n",
 		static_cast<unsigned>(con_handle),
 		static_cast<unsigned>(accept));
+	NoteUserResponse(con_handle);
 	if(accept) {
 		sm_numeric_comparison_confirm(con_handle);
 	} else {
@@ -189,6 +269,7 @@ BleError SecurityManager::ProvidePasskey(ConnectionHandle con_handle, uint32_t p
 	C7222_BLE_DEBUG_PRINT("[BLE][SM] Provide passkey handle=0x%04x passkey=%u\n",
 		static_cast<unsigned>(con_handle),
 		static_cast<unsigned>(passkey));
+	NoteUserResponse(con_handle);
 	sm_passkey_input(con_handle, passkey);
 	return BleError::kSuccess;
 }
@@ -223,25 +304,35 @@ BleError SecurityManager::DispatchBleHciPacket(uint8_t packet_type, const uint8_
 	C7222_BLE_DEBUG_PRINT("[BLE][SM] HCI event=0x%02x\n",
 		static_cast<unsigned>(event));
 	switch(event) {
+#ifdef SM_EVENT_PAIRING_STARTED
+		case SM_EVENT_PAIRING_STARTED: {
+			NotePairingStarted(sm_event_pairing_started_get_handle(packet));
+			return BleError::kSuccess;
+		}
+#endif
 		case SM_EVENT_JUST_WORKS_REQUEST: {
 			const ConnectionHandle con_handle = sm_event_just_works_request_get_handle(packet);
+			NoteUserPrompt(con_handle);
 			DispatchJustWorksRequest(con_handle);
 			return BleError::kSuccess;
 		}
 		case SM_EVENT_NUMERIC_COMPARISON_REQUEST: {
 			const ConnectionHandle con_handle = sm_event_numeric_comparison_request_get_handle(packet);
 			const uint32_t number = sm_event_numeric_comparison_request_get_passkey(packet);
+			NoteUserPrompt(con_handle);
 			DispatchNumericComparisonRequest(con_handle, number);
 			return BleError::kSuccess;
 		}
 		case SM_EVENT_PASSKEY_DISPLAY_NUMBER: {
 			const ConnectionHandle con_handle = sm_event_passkey_display_number_get_handle(packet);
 			const uint32_t passkey = sm_event_passkey_display_number_get_passkey(packet);
+			NoteUserPrompt(con_handle);
 			DispatchPasskeyDisplay(con_handle, passkey);
 			return BleError::kSuccess;
 		}
 		case SM_EVENT_PASSKEY_INPUT_NUMBER: {
 			const ConnectionHandle con_handle = sm_event_passkey_input_number_get_handle(packet);
+			NoteUserPrompt(con_handle);
 			DispatchPasskeyInput(con_handle);
 			return BleError::kSuccess;
 		}
@@ -251,11 +342,16 @@ BleError SecurityManager::DispatchBleHciPacket(uint8_t packet_type, const uint8_
 			if(auto* server = AttributeServer::GetInstance()) {
 				if(status_code != ERROR_CODE_SUCCESS) {
 					server->SetSecurityLevel(con_handle, 0);
-				} else if(server->GetSecurityLevel(con_handle) == 0) {
-					server->SetSecurityLevel(con_handle, ExpectedSecurityLevel(params_));
+				} else {
+					if(server->GetSecurityLevel(con_handle) == 0) {
+						server->SetSecurityLevel(con_handle, ExpectedSecurityLevel(params_));
+					}
+					// New bond (or re-pairing): overwrites any state of a previous peer at that index.
+					server->SetClientBond(con_handle, sm_le_device_index(con_handle), false);
 				}
 			}
 			DispatchPairingComplete(con_handle, ClassifyPairingStatus(status_code), status_code);
+			FinishPairingTiming(con_handle, ClassifyPairingStatus(status_code));
 			return BleError::kSuccess;
 		}
 		case SM_EVENT_REENCRYPTION_COMPLETE: {
@@ -264,8 +360,11 @@ BleError SecurityManager::DispatchBleHciPacket(uint8_t packet_type, const uint8_
 			if(auto* server = AttributeServer::GetInstance()) {
 				if(status != ERROR_CODE_SUCCESS) {
 					server->SetSecurityLevel(con_handle, 0);
-				} else if(server->GetSecurityLevel(con_handle) == 0) {
-					server->SetSecurityLevel(con_handle, ExpectedSecurityLevel(params_));
+				} else {
+					if(server->GetSecurityLevel(con_handle) == 0) {
+						server->SetSecurityLevel(con_handle, ExpectedSecurityLevel(params_));
+					}
+					server->SetClientBond(con_handle, sm_le_device_index(con_handle), true);
 				}
 			}
 			DispatchReencryptionComplete(con_handle, status);
@@ -293,3 +392,74 @@ BleError SecurityManager::DispatchBleHciPacket(uint8_t packet_type, const uint8_
 }
 
 }  // namespace c7222
+
+#if defined(ENABLE_LE_SECURE_CONNECTIONS)
+// BTstack's LE Secure Connections crypto entry points, redirected with
+// -Wl,--wrap (see c7222_configure_app_target). With precompute_sc_keys the key
+// pair and DH keys come from the key task; otherwise BTstack computes them on
+// its run loop, and the DH key time is still recorded for the pairing timing.
+namespace {
+
+struct InlineDhKey {
+	void (*callback)(void*) = nullptr;
+	void* context = nullptr;
+	uint32_t started_ms = 0;
+	bool busy = false;
+};
+
+InlineDhKey inline_dhkey;
+
+void InlineDhKeyDone(void* arg) {
+	auto* job = static_cast<InlineDhKey*>(arg);
+	job->busy = false;
+	c7222::SecurityManager::GetInstance()->NoteInlineDhKey(btstack_run_loop_get_time_ms() - job->started_ms);
+	job->callback(job->context);
+}
+
+}  // namespace
+
+extern "C" {
+
+void __real_btstack_crypto_ecc_p256_generate_key(btstack_crypto_ecc_p256_t* request,
+												 uint8_t* public_key,
+												 void (*btstack_crypto_done)(void* arg),
+												 void* callback_arg);
+void __real_btstack_crypto_ecc_p256_calculate_dhkey(btstack_crypto_ecc_p256_t* request,
+													const uint8_t* public_key,
+													uint8_t* dhkey,
+													void (*btstack_crypto_done)(void* arg),
+													void* callback_arg);
+
+void __wrap_btstack_crypto_ecc_p256_generate_key(btstack_crypto_ecc_p256_t* request,
+												 uint8_t* public_key,
+												 void (*btstack_crypto_done)(void* arg),
+												 void* callback_arg) {
+	auto* sm = c7222::SecurityManager::GetInstance();
+	if(sm->RequestScKeyPair(public_key, btstack_crypto_done, callback_arg) == c7222::BleError::kSuccess) {
+		return;
+	}
+	__real_btstack_crypto_ecc_p256_generate_key(request, public_key, btstack_crypto_done, callback_arg);
+}
+
+void __wrap_btstack_crypto_ecc_p256_calculate_dhkey(btstack_crypto_ecc_p256_t* request,
+													const uint8_t* public_key,
+													uint8_t* dhkey,
+													void (*btstack_crypto_done)(void* arg),
+													void* callback_arg) {
+	auto* sm = c7222::SecurityManager::GetInstance();
+	if(sm->RequestScDhKey(public_key, dhkey, btstack_crypto_done, callback_arg) == c7222::BleError::kSuccess) {
+		return;
+	}
+	if(inline_dhkey.busy) {
+		__real_btstack_crypto_ecc_p256_calculate_dhkey(request, public_key, dhkey, btstack_crypto_done, callback_arg);
+		return;
+	}
+	inline_dhkey.callback = btstack_crypto_done;
+	inline_dhkey.context = callback_arg;
+	inline_dhkey.started_ms = btstack_run_loop_get_time_ms();
+	inline_dhkey.busy = true;
+	__real_btstack_crypto_ecc_p256_calculate_dhkey(request, public_key, dhkey, &InlineDhKeyDone, &inline_dhkey);
+}
+
+}  // extern "C"
+#endif
@@ -0,0 +1,113 @@
+#include "ecc_worker.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "ble_utils.hpp"
+#include "freertos_task_notification.hpp"
+
+namespace c7222 {
+
+namespace {
+/// @brief Delay before retrying a failed key pair generation.
+constexpr uint32_t kKeyPairRetryMs = 100;
+}  // namespace
+
+EccWorker::EccWorker(Config config) : config_(std::move(config)) {}
+
+bool EccWorker::Start() {
+	if(task_ != nullptr) {
+		return true;
+	}
+	task_ = std::make_unique<FreeRtosTask>();
+	// Above idle so the value store flush cannot starve it, below everything else.
+	if(!task_->Initialize("c7222_ecc",
+						  config_.task_stack_words,
+						  FreeRtosTask::IdlePriority() + 1,
+						  [this](void*) { RunTask(); })) {
+		task_.reset();
+		return false;
+	}
+	if(config_.core >= 0 && !task_->SetCoreAffinity(1U << config_.core)) {
+		C7222_BLE_DEBUG_PRINT("[BLE] EccWorker: core affinity unsupported, running on any core\n");
+	}
+	return true;
+}
+
+bool EccWorker::RequestDhKey(const uint8_t* peer_public_key) {
+	if(task_ == nullptr || peer_public_key == nullptr || !IsKeyPairReady() ||
+	   dhkey_state_.load(std::memory_order_acquire) != DhKeyState::kIdle) {
+		return false;
+	}
+	std::copy_n(peer_public_key, kPublicKeySize, peer_public_key_.begin());
+	dhkey_state_.store(DhKeyState::kRequested, std::memory_order_release);
+	(void)FreeRtosTaskNotification::Notify(task_->GetHandle(), 1, FreeRtosTaskNotification::Action::kIncrement);
+	return true;
+}
+
+bool EccWorker::TakeDhKey(uint8_t* dhkey, bool& ok) {
+	if(dhkey_state_.load(std::memory_order_acquire) != DhKeyState::kDone) {
+		return false;
+	}
+	if(dhkey != nullptr) {
+		std::copy(dhkey_.begin(), dhkey_.end(), dhkey);
+	}
+	ok = dhkey_ok_;
+	dhkey_.fill(0);
+	dhkey_state_.store(DhKeyState::kIdle, std::memory_order_release);
+	return true;
+}
+
+EccWorker::Stats EccWorker::GetStats() const {
+	stats_lock_.Enter();
+	const Stats stats = stats_;
+	stats_lock_.Exit();
+	return stats;
+}
+
+void EccWorker::RunTask() {
+	const uint32_t key_pair_start = GetBleTimeMs();
+	while(!GenerateKeyPair(public_key_.data(), private_key_.data())) {
+		stats_lock_.Enter();
+		++stats_.failures;
+		stats_lock_.Exit();
+		FreeRtosTask::Delay(FreeRtosTask::MsToTicks(kKeyPairRetryMs));
+	}
+	stats_lock_.Enter();
+	stats_.key_pair_ms = GetBleTimeMs() - key_pair_start;
+	stats_lock_.Exit();
+	key_pair_ready_.store(true, std::memory_order_release);
+	C7222_BLE_DEBUG_PRINT("[BLE] EccWorker: key pair ready after %u ms\n",
+		static_cast<unsigned>(GetStats().key_pair_ms));
+	if(config_.on_complete) {
+		config_.on_complete();
+	}
+
+	for(;;) {
+		(void)FreeRtosTaskNotification::Take(true, FreeRtosTask::kInfinite);
+		if(dhkey_state_.load(std::memory_order_acquire) != DhKeyState::kRequested) {
+			continue;
+		}
+		const uint32_t start = GetBleTimeMs();
+		dhkey_ok_ = ComputeDhKey(peer_public_key_.data(), private_key_.data(), dhkey_.data());
+		if(!dhkey_ok_) {
+			dhkey_.fill(0);
+		}
+		const uint32_t elapsed = GetBleTimeMs() - start;
+		stats_lock_.Enter();
+		if(dhkey_ok_) {
+			++stats_.dhkeys;
+			stats_.last_dhkey_ms = elapsed;
+			stats_.max_dhkey_ms = std::max(stats_.max_dhkey_ms, elapsed);
+		} else {
+			++stats_.failures;
+		}
+		stats_lock_.Exit();
+		dhkey_state_.store(DhKeyState::kDone, std::memory_order_release);
+		if(config_.on_complete) {
+			config_.on_complete();
+		}
+	}
+}
+
+}  // namespace c7222
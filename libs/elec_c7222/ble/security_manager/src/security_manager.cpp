@@ -37,6 +37,17 @@ const char* ToString(SecurityManager::FixedPasskeyRole role) {
 	}
 }
 
+const char* ToString(SecurityManager::BondStorage storage) {
+	switch(storage) {
+		case SecurityManager::BondStorage::kVolatile:
+			return "Volatile";
+		case SecurityManager::BondStorage::kFlash:
+			return "Flash";
+		default:
+			return "Unknown";
+	}
+}
+
 bool HasAuthFlag(SecurityManager::AuthenticationRequirement auth,
 				 SecurityManager::AuthenticationRequirement flag) {
 	return static_cast<uint8_t>(auth & flag) != 0;
@@ -86,14 +97,16 @@ BleError SecurityManager::Configure(const SecurityParameters& params) {
 	params_ = params;
 	configured_ = true;
 	C7222_BLE_DEBUG_PRINT(
-		"[BLE][SM] Configure: io=%s auth=0x%02x keysize=%u..%u bondable=%u sc_only=%u gatt_level=%u\n",
+		"[BLE][SM] Configure: io=%s auth=0x%02x keysize=%u..%u bondable=%u sc_only=%u gatt_level=%u bonds=%s sc_keys=%u\n",
 		ToString(params_.io_capability),
 		static_cast<unsigned>(params_.authentication),
 		static_cast<unsigned>(params_.min_encryption_key_size),
 		static_cast<unsigned>(params_.max_encryption_key_size),
 		static_cast<unsigned>(params_.bondable),
 		static_cast<unsigned>(params_.secure_connections_only),
-		static_cast<unsigned>(params_.gatt_client_required_security_level));
+		static_cast<unsigned>(params_.gatt_client_required_security_level),
+		ToString(params_.bond_storage),
+		static_cast<unsigned>(params_.precompute_sc_keys));
 	const BleError err = ApplyConfiguration();
 	applied_ = (err == BleError::kSuccess);
 	return err;
@@ -198,6 +211,256 @@ BleError SecurityManager::ClearFixedPasskey() {
 	return err;
 }
 
+BleError SecurityManager::SetBondStorage(BondStorage storage) {
+	params_.bond_storage = storage;
+	configured_ = true;
+	C7222_BLE_DEBUG_PRINT("[BLE][SM] Set bond storage: %s\n", ToString(storage));
+	const BleError err = ApplyConfiguration();
+	applied_ = (err == BleError::kSuccess);
+	return err;
+}
+
+FlashStorage::Config SecurityManager::GetDefaultBondStorageRegion() {
+	const uint32_t sector = FlashStorage::GetSectorSize();
+	return FlashStorage::Config{FlashStorage::GetStorageLimit() - 2U * sector, sector};
+}
+
+BleError SecurityManager::OpenBondStorage() {
+	if(bond_storage_ != nullptr) {
+		return BleError::kSuccess;
+	}
+	FlashStorage::Config region = params_.bond_storage_region;
+	if(region.bank_size == 0) {
+		region = GetDefaultBondStorageRegion();
+	}
+	auto storage = std::make_unique<FlashStorage>(region);
+	if(!storage->Init()) {
+		C7222_BLE_DEBUG_PRINT("[BLE][SM] Bond storage init failed: offset=0x%08x bank=%u\n",
+			static_cast<unsigned>(region.offset),
+			static_cast<unsigned>(region.bank_size));
+		return BleError::kHardwareFailure;
+	}
+	C7222_BLE_DEBUG_PRINT("[BLE][SM] Bond storage: offset=0x%08x bank=%u entries=%u\n",
+		static_cast<unsigned>(region.offset),
+		static_cast<unsigned>(region.bank_size),
+		static_cast<unsigned>(storage->GetStats().entries));
+	bond_storage_ = std::move(storage);
+	return BleError::kSuccess;
+}
+
+BleError SecurityManager::SetScKeyPrecomputation(bool enabled, int8_t core) {
+	params_.precompute_sc_keys = enabled;
+	params_.sc_key_task_core = core;
+	configured_ = true;
+	C7222_BLE_DEBUG_PRINT("[BLE][SM] Set SC key precomputation: %u core=%d\n",
+		static_cast<unsigned>(enabled),
+		static_cast<int>(core));
+	const BleError err = ApplyConfiguration();
+	applied_ = (err == BleError::kSuccess);
+	return err;
+}
+
+BleError SecurityManager::StartScKeyWorker() {
+	if(key_worker_ != nullptr) {
+		return BleError::kSuccess;
+	}
+	EccWorker::Config config;
+	config.core = params_.sc_key_task_core;
+	config.on_complete = [this]() { RequestStackWork(); };
+	// Assigned before Start() so the task's first completion finds it.
+	key_worker_ = std::make_unique<EccWorker>(std::move(config));
+	if(!key_worker_->Start()) {
+		C7222_BLE_DEBUG_PRINT("[BLE][SM] SC key task could not be created\n");
+		key_worker_.reset();
+		return BleError::kMemoryCapacityExceeded;
+	}
+	C7222_BLE_DEBUG_PRINT("[BLE][SM] SC key task started core=%d\n",
+		static_cast<int>(params_.sc_key_task_core));
+	return BleError::kSuccess;
+}
+
+SecurityManager::ScKeyStats SecurityManager::GetScKeyStats() const {
+	ScKeyStats stats;
+	stats.dhkeys_offloaded = dhkeys_offloaded_;
+	stats.dhkeys_inline = dhkeys_inline_;
+	stats.last_dhkey_ms = last_dhkey_ms_;
+	stats.max_dhkey_ms = max_dhkey_ms_;
+	if(key_worker_ != nullptr) {
+		const EccWorker::Stats worker = key_worker_->GetStats();
+		stats.key_pair_ready = key_worker_->IsKeyPairReady();
+		stats.key_pair_ms = worker.key_pair_ms;
+		stats.failures = worker.failures;
+	}
+	return stats;
+}
+
+BleError SecurityManager::RequestScKeyPair(uint8_t* public_key, CryptoCallback callback, void* context) {
+	if(!params_.precompute_sc_keys || key_worker_ == nullptr || public_key == nullptr || callback == nullptr) {
+		return BleError::kCommandDisallowed;
+	}
+	C7222_BLE_DEBUG_PRINT("[BLE][SM] SC key pair requested ready=%u\n",
+		static_cast<unsigned>(key_worker_->IsKeyPairReady()));
+	pending_key_pair_ = public_key;
+	pending_key_pair_callback_ = callback;
+	pending_key_pair_context_ = context;
+	// Completed from the stack work, never from inside the stack's call.
+	RequestStackWork();
+	return BleError::kSuccess;
+}
+
+BleError SecurityManager::RequestScDhKey(const uint8_t* peer_public_key,
+										 uint8_t* dhkey,
+										 CryptoCallback callback,
+										 void* context) {
+	if(!key_pair_supplied_ || key_worker_ == nullptr || peer_public_key == nullptr || dhkey == nullptr ||
+	   callback == nullptr) {
+		return BleError::kCommandDisallowed;
+	}
+	DhKeyRequest request;
+	std::copy_n(peer_public_key, request.peer_public_key.size(), request.peer_public_key.begin());
+	request.dhkey = dhkey;
+	request.callback = callback;
+	request.context = context;
+	dhkey_requests_.push_back(request);
+	RequestStackWork();
+	return BleError::kSuccess;
+}
+
+void SecurityManager::NoteInlineDhKey(uint32_t duration_ms) {
+	++dhkeys_inline_;
+	NoteDhKey(duration_ms, false);
+}
+
+void SecurityManager::RequestStackWork() {
+	if(!stack_work_scheduled_.exchange(true)) {
+		ScheduleStackWork();
+	}
+}
+
+void SecurityManager::ProcessStackWork() {
+	// Clear first so completions signalled while this runs schedule another run.
+	stack_work_scheduled_.store(false);
+	if(key_worker_ == nullptr) {
+		return;
+	}
+
+	if(pending_key_pair_ != nullptr && key_worker_->IsKeyPairReady()) {
+		std::copy_n(key_worker_->GetPublicKey(), EccWorker::kPublicKeySize, pending_key_pair_);
+		const CryptoCallback callback = pending_key_pair_callback_;
+		void* context = pending_key_pair_context_;
+		pending_key_pair_ = nullptr;
+		pending_key_pair_callback_ = nullptr;
+		pending_key_pair_context_ = nullptr;
+		key_pair_supplied_ = true;
+		C7222_BLE_DEBUG_PRINT("[BLE][SM] SC key pair handed to the stack\n");
+		callback(context);
+	}
+
+	if(dhkey_running_) {
+		bool ok = false;
+		if(key_worker_->TakeDhKey(dhkey_requests_.front().dhkey, ok)) {
+			const DhKeyRequest done = dhkey_requests_.front();
+			dhkey_requests_.pop_front();
+			dhkey_running_ = false;
+			if(ok) {
+				++dhkeys_offloaded_;
+				NoteDhKey(key_worker_->GetStats().last_dhkey_ms, true);
+			}
+			// A failed DH key is all zeros; the stack's DHKey check then fails the pairing.
+			done.callback(done.context);
+		}
+	}
+
+	if(!dhkey_running_ && !dhkey_requests_.empty()) {
+		dhkey_running_ = key_worker_->RequestDhKey(dhkey_requests_.front().peer_public_key.data());
+	}
+}
+
+SecurityManager::PairingTrace* SecurityManager::FindPairingTrace(ConnectionHandle con_handle, bool create) {
+	auto it = std::find_if(pairing_traces_.begin(), pairing_traces_.end(), [con_handle](const PairingTrace& trace) {
+		return trace.connection_handle == con_handle;
+	});
+	if(it != pairing_traces_.end()) {
+		return &*it;
+	}
+	if(!create) {
+		return nullptr;
+	}
+	if(pairing_traces_.size() >= kMaxPairingTraces) {
+		pairing_traces_.erase(pairing_traces_.begin());
+	}
+	PairingTrace trace;
+	trace.connection_handle = con_handle;
+	trace.started_ms = GetBleTimeMs();
+	pairing_traces_.push_back(trace);
+	return &pairing_traces_.back();
+}
+
+void SecurityManager::NotePairingStarted(ConnectionHandle con_handle) {
+	PairingTrace* trace = FindPairingTrace(con_handle, true);
+	*trace = PairingTrace{};
+	trace->connection_handle = con_handle;
+	trace->started_ms = GetBleTimeMs();
+}
+
+void SecurityManager::NoteUserPrompt(ConnectionHandle con_handle) {
+	// Stacks without a pairing-started event begin the trace at the prompt.
+	PairingTrace* trace = FindPairingTrace(con_handle, true);
+	if(!trace->prompted) {
+		trace->prompted = true;
+		trace->prompted_ms = GetBleTimeMs();
+	}
+}
+
+void SecurityManager::NoteUserResponse(ConnectionHandle con_handle) {
+	PairingTrace* trace = FindPairingTrace(con_handle, false);
+	if(trace != nullptr && trace->prompted && !trace->answered) {
+		trace->answered = true;
+		trace->answered_ms = GetBleTimeMs();
+	}
+}
+
+void SecurityManager::NoteDhKey(uint32_t duration_ms, bool offloaded) {
+	last_dhkey_ms_ = duration_ms;
+	max_dhkey_ms_ = std::max(max_dhkey_ms_, duration_ms);
+	// The stack computes one DH key at a time; it belongs to the newest pairing still without one.
+	for(auto it = pairing_traces_.rbegin(); it != pairing_traces_.rend(); ++it) {
+		if(!it->dhkey) {
+			it->dhkey = true;
+			it->dhkey_ms = duration_ms;
+			it->dhkey_offloaded = offloaded;
+			break;
+		}
+	}
+}
+
+void SecurityManager::FinishPairingTiming(ConnectionHandle con_handle, PairingStatus status) {
+	auto it = std::find_if(pairing_traces_.begin(), pairing_traces_.end(), [con_handle](const PairingTrace& trace) {
+		return trace.connection_handle == con_handle;
+	});
+	if(it == pairing_traces_.end()) {
+		return;
+	}
+	const uint32_t now = GetBleTimeMs();
+	PairingTiming timing;
+	timing.connection_handle = con_handle;
+	timing.status = status;
+	timing.total_ms = now - it->started_ms;
+	timing.prompted = it->prompted;
+	if(it->prompted) {
+		timing.prompt_ms = it->prompted_ms - it->started_ms;
+		timing.user_ms = it->answered ? it->answered_ms - it->prompted_ms : 0;
+		timing.finish_ms = now - (it->answered ? it->answered_ms : it->prompted_ms);
+	} else {
+		timing.finish_ms = timing.total_ms;
+	}
+	timing.dhkey_ms = it->dhkey_ms;
+	timing.dhkey_offloaded = it->dhkey_offloaded;
+	pairing_traces_.erase(it);
+	last_pairing_timing_ = timing;
+	DispatchPairingTiming(timing);
+}
+
 // ValidateConfiguration is platform-specific (implemented in platform layer).
 
 void SecurityManager::AddEventHandler(const EventHandler& handler) {
@@ -313,6 +576,21 @@ void SecurityManager::DispatchAuthorizationResult(ConnectionHandle con_handle, A
 	}
 }
 
+void SecurityManager::DispatchPairingTiming(const PairingTiming& timing) const {
+	C7222_BLE_DEBUG_PRINT(
+		"[BLE][SM] Pairing timing handle=0x%04x total=%u prompt=%u user=%u finish=%u dhkey=%u offloaded=%u\n",
+		static_cast<unsigned>(timing.connection_handle),
+		static_cast<unsigned>(timing.total_ms),
+		static_cast<unsigned>(timing.prompt_ms),
+		static_cast<unsigned>(timing.user_ms),
+		static_cast<unsigned>(timing.finish_ms),
+		static_cast<unsigned>(timing.dhkey_ms),
+		static_cast<unsigned>(timing.dhkey_offloaded));
+	for(const auto* handler : handlers_) {
+		handler->OnPairingTiming(timing);
+	}
+}
+
 std::ostream& operator<<(std::ostream& os, const SecurityManager& sm) {
 	const auto params = sm.GetSecurityParameters();
 
@@ -329,6 +607,17 @@ std::ostream& operator<<(std::ostream& os, const SecurityManager& sm) {
 	   << static_cast<unsigned>(params.gatt_client_required_security_level);
 	os << ", fixed_passkey_role=" << ToString(params.fixed_passkey_role);
 	os << ", fixed_passkey=" << static_cast<unsigned long>(params.fixed_passkey);
+	os << ", bond_storage=" << ToString(params.bond_storage);
+	if(const FlashStorage* storage = sm.GetBondStorage()) {
+		const auto stats = storage->GetStats();
+		os << " (entries=" << stats.entries << ", used=" << stats.used_bytes << "/"
+		   << storage->GetConfig().bank_size << ", compactions=" << stats.compactions << ")";
+	}
+	os << ", precompute_sc_keys=" << (params.precompute_sc_keys ? "true" : "false");
+	const auto sc_keys = sm.GetScKeyStats();
+	os << " (key_pair_ready=" << (sc_keys.key_pair_ready ? "true" : "false")
+	   << ", key_pair_ms=" << sc_keys.key_pair_ms << ", dhkeys_offloaded=" << sc_keys.dhkeys_offloaded
+	   << ", dhkeys_inline=" << sc_keys.dhkeys_inline << ", max_dhkey_ms=" << sc_keys.max_dhkey_ms << ")";
 	os << " }";
 	return os;
 }
@@ -47,12 +47,24 @@ void Ble::SetAdvertisementFlags(uint8_t flags) {
 }
 
 AttributeServer* Ble::EnableAttributeServer(const void* context) {
+	return EnableAttributeServerImpl(context, nullptr);
+}
+
+AttributeServer* Ble::EnableAttributeServer(const void* context, const GattDatabaseLayout& layout) {
+	return EnableAttributeServerImpl(context, &layout);
+}
+
+AttributeServer* Ble::EnableAttributeServerImpl(const void* context, const GattDatabaseLayout* layout) {
 	if(attribute_server_ != nullptr) {
 		return attribute_server_;
 	}
 	if(attribute_server_ == nullptr) {
 		attribute_server_ = AttributeServer::GetInstance();
-		attribute_server_->Init(context);
+		if(layout != nullptr) {
+			attribute_server_->Init(context, *layout);
+		} else {
+			attribute_server_->Init(context);
+		}
 
 		const bool requires_encryption = attribute_server_->HasServicesRequiringEncryption();
 		const bool requires_authentication =
@@ -82,6 +94,13 @@ AttributeServer* Ble::EnableAttributeServer(const void* context) {
 	return attribute_server_;
 }
 
+BleError Ble::DispatchL2capPacket(uint8_t packet_type,
+								  uint16_t channel,
+								  const uint8_t* packet_data,
+								  uint16_t packet_data_size) {
+	return L2capChannel::DispatchPacket(packet_type, channel, packet_data, packet_data_size);
+}
+
 SecurityManager* Ble::EnableSecurityManager(const SecurityManager::SecurityParameters& params) {
 	if(security_manager_ == nullptr) {
 		security_manager_ = SecurityManager::GetInstance();
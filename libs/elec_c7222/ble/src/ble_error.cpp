@@ -218,6 +218,16 @@ std::ostream& operator<<(std::ostream& os, BleError error) {
 			return os << "AttErrorInvalidAttrValueLength";
 		case BleError::kAttErrorInsufficientEncryption:
 			return os << "AttErrorInsufficientEncryption";
+		case BleError::kAttErrorInvalidOffset:
+			return os << "AttErrorInvalidOffset";
+		case BleError::kAttErrorPrepareQueueFull:
+			return os << "AttErrorPrepareQueueFull";
+		case BleError::kAttErrorDatabaseOutOfSync:
+			return os << "AttErrorDatabaseOutOfSync";
+		case BleError::kAttErrorValueNotAllowed:
+			return os << "AttErrorValueNotAllowed";
+		case BleError::kAttResponsePending:
+			return os << "AttResponsePending";
 		case BleError::kGattClientNotConnected:
 			return os << "GattClientNotConnected";
 		case BleError::kGattClientBusy:
@@ -0,0 +1,306 @@
+/**
+ * @file flash_storage.hpp
+ * @brief Log-structured key-value store in a reserved flash region.
+ */
+#ifndef ELEC_C7222_DEVICES_FLASH_STORAGE_H_
+#define ELEC_C7222_DEVICES_FLASH_STORAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "non_copyable.hpp"
+
+namespace c7222 {
+
+/**
+ * @class FlashStorage
+ * @brief Power-fail safe, wear-leveled tag/value store in on-board flash.
+ *
+ * Values are identified by a 32-bit tag (the model of BTstack's TLV API) and
+ * survive resets. The region is split into two banks that are used as a log:
+ *
+ * - **Append only:** storing a value appends a record to the active bank;
+ *   the newest record of a tag wins and a zero-length record deletes it.
+ *   Nothing is erased on a normal write.
+ * - **Compaction:** when the active bank is full, the live records are copied
+ *   to the other bank, which is erased first. Its header (with an incremented
+ *   sequence number) is written last, so a reset during compaction leaves
+ *   the old bank active.
+ * - **Wear leveling:** erases only happen on compaction and alternate between
+ *   the banks, so every sector of the region wears at the same rate.
+ * - **Power-fail safety:** each record carries a CRC. A record torn by a reset
+ *   ends the log when the bank is scanned; the next store compacts first so
+ *   the damaged tail is never written again.
+ *
+ * A RAM index (one small entry per live tag) makes lookups independent of
+ * the log length.
+ *
+ * ---
+ * ### Platform Notes
+ *
+ * - **RPi Pico W:** the region is part of the program flash. Erase and
+ *   program run through `flash_safe_execute()`, which pauses the other core
+ *   and interrupts for the duration (an erase takes tens of milliseconds).
+ *   `Init()` rejects regions that overlap the program image
+ *   (`GetProgramEnd()`) or the SDK's BTstack flash bank at
+ *   `PICO_FLASH_BANK_STORAGE_OFFSET`, which `cyw43_arch_init()` opens as
+ *   BTstack's own TLV (`GetStorageLimit()`). The default regions sit right
+ *   below that bank.
+ * - **Grader:** flash is emulated by a file (`C7222_GRADER_FLASH_FILE`,
+ *   default `c7222_grader_flash.bin` in the working directory) with NOR
+ *   semantics: erase sets bytes to 0xFF and programming can only clear bits.
+ *
+ * @code{.cpp}
+ * c7222::FlashStorage storage({c7222::FlashStorage::GetStorageLimit() - 8192, 4096});
+ * storage.Init();
+ * const uint8_t value[] = {1, 2, 3};
+ * storage.Store(0x11223344, value, sizeof(value));
+ * @endcode
+ */
+class FlashStorage : public NonCopyableNonMovable {
+   public:
+	/**
+	 * @brief Location of the storage region.
+	 */
+	struct Config {
+		/// @brief Offset of the region from the start of flash (sector aligned).
+		uint32_t offset = 0;
+		/// @brief Size of one bank (multiple of the sector size); the region spans two banks.
+		uint32_t bank_size = 0;
+	};
+
+	/**
+	 * @brief Store usage statistics.
+	 */
+	struct Stats {
+		/// @brief Number of live tags.
+		size_t entries = 0;
+		/// @brief Bytes used in the active bank (header and superseded records included).
+		size_t used_bytes = 0;
+		/// @brief Bytes the live records occupy.
+		size_t live_bytes = 0;
+		/// @brief Compactions since the region was formatted (each erases one bank).
+		uint32_t compactions = 0;
+	};
+
+	/**
+	 * @brief One change of a `StoreBatch()` call.
+	 */
+	struct Entry {
+		uint32_t tag = 0;
+		/// @brief Value bytes (not needed when `size` is 0).
+		const uint8_t* data = nullptr;
+		/// @brief Value size; 0 deletes the tag.
+		size_t size = 0;
+	};
+
+	/// @brief Largest value size.
+	static constexpr size_t kMaxValueSize = 0xFFFE;
+
+	/**
+	 * @brief Create a store over a region; call `Init()` before use.
+	 */
+	explicit FlashStorage(const Config& config);
+
+	/**
+	 * @brief Scan the banks and build the index.
+	 *
+	 * Formats the region when neither bank holds a valid store.
+	 *
+	 * @return False when the region is invalid (misaligned or outside
+	 *         `GetProgramEnd()`..`GetStorageLimit()`) or could not be formatted
+	 */
+	bool Init();
+
+	/**
+	 * @brief Check whether `Init()` succeeded.
+	 */
+	[[nodiscard]] bool IsInitialized() const {
+		return initialized_;
+	}
+
+	/**
+	 * @brief Read a value.
+	 *
+	 * Copies at most `buffer_size` bytes.
+	 *
+	 * @return Size of the stored value (0 when the tag is absent)
+	 */
+	size_t Get(uint32_t tag, uint8_t* buffer, size_t buffer_size) const;
+
+	/**
+	 * @brief Check whether a tag is stored.
+	 */
+	[[nodiscard]] bool Contains(uint32_t tag) const {
+		return FindRecord(tag) != nullptr;
+	}
+
+	/**
+	 * @brief Size of a stored value (0 when the tag is absent).
+	 */
+	[[nodiscard]] size_t GetSize(uint32_t tag) const;
+
+	/**
+	 * @brief Store a value, replacing any previous value of the tag.
+	 *
+	 * Storing an identical value does not touch flash. Storing zero bytes
+	 * deletes the tag.
+	 *
+	 * @return False when the value is too large or the region is full
+	 */
+	bool Store(uint32_t tag, const uint8_t* data, size_t size);
+
+	/**
+	 * @brief Store several values with a single flash program.
+	 *
+	 * Unchanged values and deletions of absent tags are skipped. The records
+	 * are appended back to back, so a burst of changes costs one program
+	 * operation (and one flash lockout on the Pico) instead of one per value.
+	 * Falls back to one program per value when the batch does not fit in a
+	 * freshly compacted bank.
+	 *
+	 * @return False when an entry is invalid or a record could not be written
+	 */
+	bool StoreBatch(const Entry* entries, size_t count);
+
+	/**
+	 * @brief Delete a tag (no-op when absent).
+	 *
+	 * @return False when the deletion record could not be written
+	 */
+	bool Delete(uint32_t tag);
+
+	/**
+	 * @brief Copy the live records to the other bank now.
+	 */
+	bool Compact();
+
+	/**
+	 * @brief Erase both banks and start an empty store.
+	 */
+	bool Format();
+
+	/**
+	 * @brief Get the tags currently stored, in index order.
+	 */
+	[[nodiscard]] std::vector<uint32_t> GetTags() const;
+
+	/**
+	 * @brief Get usage statistics.
+	 */
+	[[nodiscard]] Stats GetStats() const;
+
+	/**
+	 * @brief Get the region configuration.
+	 */
+	[[nodiscard]] const Config& GetConfig() const {
+		return config_;
+	}
+
+	/**
+	 * @brief Erase unit of the flash (platform-specific).
+	 */
+	[[nodiscard]] static uint32_t GetSectorSize();
+
+	/**
+	 * @brief Total flash size (platform-specific).
+	 */
+	[[nodiscard]] static uint32_t GetFlashSize();
+
+	/**
+	 * @brief First sector boundary past the program image (platform-specific).
+	 *
+	 * Regions must start at or after this offset.
+	 */
+	[[nodiscard]] static uint32_t GetProgramEnd();
+
+	/**
+	 * @brief End of the flash available to regions (platform-specific).
+	 *
+	 * On the Pico W this is `PICO_FLASH_BANK_STORAGE_OFFSET`: the flash above
+	 * it belongs to the SDK's BTstack flash bank. The whole flash elsewhere.
+	 */
+	[[nodiscard]] static uint32_t GetStorageLimit();
+
+   private:
+	/// \name Log Layout
+	///@{
+	/// @brief Bank header: magic(4) sequence(4).
+	static constexpr uint32_t kHeaderSize = 8;
+	/// @brief Record header: tag(4) size(2) crc(2), followed by the value padded to 4 bytes.
+	static constexpr uint32_t kRecordHeaderSize = 8;
+	static constexpr uint32_t kMagic = 0x53463743;	 // "C7FS"
+	static constexpr uint32_t kErasedTag = 0xFFFFFFFF;
+
+	/**
+	 * @brief Index entry of one live tag.
+	 */
+	struct Record {
+		uint32_t tag = 0;
+		/// @brief Offset of the value inside the active bank.
+		uint32_t offset = 0;
+		uint16_t size = 0;
+	};
+	///@}
+
+	/// \name Log Helpers
+	///@{
+	[[nodiscard]] const Record* FindRecord(uint32_t tag) const;
+	[[nodiscard]] uint32_t BankOffset(size_t bank) const {
+		return static_cast<uint32_t>(bank) * config_.bank_size;
+	}
+	[[nodiscard]] static uint32_t RecordSize(size_t value_size) {
+		return kRecordHeaderSize + ((static_cast<uint32_t>(value_size) + 3U) & ~3U);
+	}
+	/// @brief Read a bank header; returns false when the bank holds no store.
+	bool ReadHeader(size_t bank, uint32_t& sequence) const;
+	/// @brief Rebuild the index from the active bank.
+	void ScanActiveBank();
+	/// @brief Check whether storing `size` bytes would change the stored value.
+	[[nodiscard]] bool IsChange(uint32_t tag, const uint8_t* data, size_t size) const;
+	/// @brief Encode one record into `out` (`RecordSize(size)` bytes, pre-filled with 0xFF).
+	static void EncodeRecord(uint8_t* out, uint32_t tag, const uint8_t* data, uint16_t size);
+	/// @brief Write one record at `offset` of `bank`.
+	bool WriteRecord(size_t bank, uint32_t offset, uint32_t tag, const uint8_t* data, uint16_t size);
+	/// @brief Point the index at a record whose value starts at `value_offset` (size 0 removes the tag).
+	void UpdateIndex(uint32_t tag, uint32_t value_offset, uint16_t size);
+	/// @brief Append a record to the active bank, compacting first when needed.
+	bool Append(uint32_t tag, const uint8_t* data, uint16_t size);
+	///@}
+
+	/// \name Platform Hooks
+	/// Offsets are relative to the start of the region.
+	///@{
+	/// @brief Erase `size` bytes (sector aligned).
+	bool EraseRange(uint32_t offset, uint32_t size);
+	/// @brief Program bytes; only clears bits, any alignment.
+	bool ProgramRange(uint32_t offset, const uint8_t* data, size_t size);
+	/// @brief Read bytes.
+	void ReadRange(uint32_t offset, uint8_t* out, size_t size) const;
+	///@}
+
+	/// \name State
+	///@{
+	Config config_;
+	/// @brief Live tags of the active bank.
+	std::vector<Record> index_;
+	/// @brief Reused buffer for compaction and comparisons.
+	mutable std::vector<uint8_t> scratch_;
+	/// @brief Bank holding the store (0 or 1).
+	size_t active_bank_ = 0;
+	/// @brief Sequence number of the active bank.
+	uint32_t sequence_ = 0;
+	/// @brief Next free offset in the active bank.
+	uint32_t write_offset_ = 0;
+	/// @brief Bytes occupied by live records.
+	size_t live_bytes_ = 0;
+	/// @brief True when the log ends in a damaged record; the next append compacts first.
+	bool damaged_tail_ = false;
+	bool initialized_ = false;
+	///@}
+};
+
+}  // namespace c7222
+
+#endif	// ELEC_C7222_DEVICES_FLASH_STORAGE_H_
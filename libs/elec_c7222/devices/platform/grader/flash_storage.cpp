@@ -0,0 +1,106 @@
+// Grader flash emulation backed by a file.
+#include "flash_storage.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace c7222 {
+
+namespace {
+
+constexpr uint32_t kSectorSize = 4096;
+constexpr uint32_t kFlashSize = 2U * 1024U * 1024U;
+
+const char* FlashFilePath() {
+	const char* path = std::getenv("C7222_GRADER_FLASH_FILE");
+	return path != nullptr && path[0] != '\0' ? path : "c7222_grader_flash.bin";
+}
+
+// Open for update, creating the file on first use.
+std::FILE* OpenFlashFile() {
+	std::FILE* file = std::fopen(FlashFilePath(), "r+b");
+	if(file == nullptr) {
+		file = std::fopen(FlashFilePath(), "w+b");
+	}
+	return file;
+}
+
+// Bytes past the end of the file read as erased flash.
+void ReadFlash(std::FILE* file, uint32_t address, uint8_t* out, size_t size) {
+	std::fill_n(out, size, static_cast<uint8_t>(0xFF));
+	if(std::fseek(file, static_cast<long>(address), SEEK_SET) == 0) {
+		(void)std::fread(out, 1, size, file);
+	}
+}
+
+bool WriteFlash(std::FILE* file, uint32_t address, const uint8_t* data, size_t size) {
+	// Fill any gap before `address` so the file stays a flat image.
+	if(std::fseek(file, 0, SEEK_END) != 0) {
+		return false;
+	}
+	long end = std::ftell(file);
+	while(end >= 0 && static_cast<uint32_t>(end) < address) {
+		if(std::fputc(0xFF, file) == EOF) {
+			return false;
+		}
+		++end;
+	}
+	return std::fseek(file, static_cast<long>(address), SEEK_SET) == 0 && std::fwrite(data, 1, size, file) == size;
+}
+
+}  // namespace
+
+uint32_t FlashStorage::GetSectorSize() {
+	return kSectorSize;
+}
+
+uint32_t FlashStorage::GetFlashSize() {
+	return kFlashSize;
+}
+
+// The emulated flash holds no program image and no SDK flash bank.
+uint32_t FlashStorage::GetProgramEnd() {
+	return 0;
+}
+
+uint32_t FlashStorage::GetStorageLimit() {
+	return kFlashSize;
+}
+
+bool FlashStorage::EraseRange(uint32_t offset, uint32_t size) {
+	std::FILE* file = OpenFlashFile();
+	if(file == nullptr) {
+		return false;
+	}
+	const std::vector<uint8_t> erased(size, 0xFF);
+	const bool ok = WriteFlash(file, config_.offset + offset, erased.data(), erased.size());
+	return std::fclose(file) == 0 && ok;
+}
+
+bool FlashStorage::ProgramRange(uint32_t offset, const uint8_t* data, size_t size) {
+	std::FILE* file = OpenFlashFile();
+	if(file == nullptr) {
+		return false;
+	}
+	// NOR semantics: programming can only clear bits.
+	std::vector<uint8_t> cells(size);
+	ReadFlash(file, config_.offset + offset, cells.data(), size);
+	for(size_t i = 0; i < size; ++i) {
+		cells[i] &= data[i];
+	}
+	const bool ok = WriteFlash(file, config_.offset + offset, cells.data(), size);
+	return std::fclose(file) == 0 && ok;
+}
+
+void FlashStorage::ReadRange(uint32_t offset, uint8_t* out, size_t size) const {
+	std::FILE* file = std::fopen(FlashFilePath(), "rb");
+	if(file == nullptr) {
+		std::fill_n(out, size, static_cast<uint8_t>(0xFF));
+		return;
+	}
+	ReadFlash(file, config_.offset + offset, out, size);
+	std::fclose(file);
+}
+
+}  // namespace c7222
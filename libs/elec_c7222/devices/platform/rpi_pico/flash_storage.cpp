@@ -0,0 +1,101 @@
+#include "flash_storage.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "hardware/flash.h"
+#include "hardware/regs/addressmap.h"
+#include "pico/flash.h"
+
+// pico_btstack's flash bank (btstack_flash_bank.c), which cyw43_arch_init()
+// installs as BTstack's TLV. Same defaults as the SDK; board or build
+// overrides apply to both.
+#ifndef PICO_FLASH_BANK_TOTAL_SIZE
+#define PICO_FLASH_BANK_TOTAL_SIZE (FLASH_SECTOR_SIZE * 2u)
+#endif
+#ifndef PICO_FLASH_BANK_STORAGE_OFFSET
+#define PICO_FLASH_BANK_STORAGE_OFFSET (PICO_FLASH_SIZE_BYTES - PICO_FLASH_BANK_TOTAL_SIZE)
+#endif
+
+// End of the program image in flash (linker script symbol).
+extern "C" char __flash_binary_end;
+
+namespace c7222 {
+
+namespace {
+
+constexpr uint32_t kFlashSafeTimeoutMs = 1000;
+
+struct EraseRequest {
+	uint32_t flash_offset;
+	uint32_t size;
+};
+
+struct ProgramRequest {
+	uint32_t flash_offset;
+	const uint8_t* data;
+	size_t size;
+};
+
+void EraseCallback(void* param) {
+	const auto* request = static_cast<const EraseRequest*>(param);
+	flash_range_erase(request->flash_offset, request->size);
+}
+
+// Programming is page based; bytes outside the range are written as 0xFF,
+// which leaves their flash contents unchanged. All pages are programmed in
+// one lockout.
+void ProgramCallback(void* param) {
+	const auto* request = static_cast<const ProgramRequest*>(param);
+	uint8_t page[FLASH_PAGE_SIZE];
+	uint32_t flash_offset = request->flash_offset;
+	const uint8_t* data = request->data;
+	size_t size = request->size;
+	while(size > 0) {
+		const uint32_t page_start = flash_offset & ~(FLASH_PAGE_SIZE - 1U);
+		const uint32_t in_page = flash_offset - page_start;
+		const size_t chunk = std::min<size_t>(size, FLASH_PAGE_SIZE - in_page);
+		std::memset(page, 0xFF, sizeof(page));
+		std::memcpy(page + in_page, data, chunk);
+		flash_range_program(page_start, page, FLASH_PAGE_SIZE);
+		flash_offset += static_cast<uint32_t>(chunk);
+		data += chunk;
+		size -= chunk;
+	}
+}
+
+}  // namespace
+
+uint32_t FlashStorage::GetSectorSize() {
+	return FLASH_SECTOR_SIZE;
+}
+
+uint32_t FlashStorage::GetFlashSize() {
+	return PICO_FLASH_SIZE_BYTES;
+}
+
+uint32_t FlashStorage::GetProgramEnd() {
+	const auto end = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&__flash_binary_end) - XIP_BASE);
+	return (end + FLASH_SECTOR_SIZE - 1U) & ~(FLASH_SECTOR_SIZE - 1U);
+}
+
+uint32_t FlashStorage::GetStorageLimit() {
+	return PICO_FLASH_BANK_STORAGE_OFFSET;
+}
+
+bool FlashStorage::EraseRange(uint32_t offset, uint32_t size) {
+	EraseRequest request{config_.offset + offset, size};
+	return flash_safe_execute(EraseCallback, &request, kFlashSafeTimeoutMs) == PICO_OK;
+}
+
+bool FlashStorage::ProgramRange(uint32_t offset, const uint8_t* data, size_t size) {
+	ProgramRequest request{config_.offset + offset, data, size};
+	return flash_safe_execute(ProgramCallback, &request, kFlashSafeTimeoutMs) == PICO_OK;
+}
+
+void FlashStorage::ReadRange(uint32_t offset, uint8_t* out, size_t size) const {
+	const auto* flash = reinterpret_cast<const uint8_t*>(XIP_BASE + config_.offset + offset);
+	std::memcpy(out, flash, size);
+}
+
+}  // namespace c7222
@@ -39,6 +39,8 @@ static void cyw43_arch_init_timer_callback(TimerHandle_t timer) {
 		cyw43_init_timer = nullptr;
 	}
 }
+// Replace the SDK's flash-bank TLV so bonds stay in RAM by default.
+// SecurityManager installs its own flash store for BondStorage::kFlash.
 void DisableBtstackPersistenceStorage() {
 	static bool persistence_disabled = false;
 	if(persistence_disabled) {
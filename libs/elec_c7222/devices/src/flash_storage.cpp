@@ -0,0 +1,345 @@
+#include "flash_storage.hpp"
+
+#include <algorithm>
+
+namespace c7222 {
+
+namespace {
+
+// CRC-16/CCITT-FALSE
+uint16_t Crc16(uint16_t crc, const uint8_t* data, size_t size) {
+	for(size_t i = 0; i < size; ++i) {
+		crc = static_cast<uint16_t>(crc ^ (static_cast<uint16_t>(data[i]) << 8));
+		for(int bit = 0; bit < 8; ++bit) {
+			crc = (crc & 0x8000) != 0 ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+		}
+	}
+	return crc;
+}
+
+void StoreLe16(uint8_t* out, uint16_t value) {
+	out[0] = static_cast<uint8_t>(value & 0xFF);
+	out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void StoreLe32(uint8_t* out, uint32_t value) {
+	StoreLe16(out, static_cast<uint16_t>(value & 0xFFFF));
+	StoreLe16(out + 2, static_cast<uint16_t>(value >> 16));
+}
+
+uint16_t ReadLe16(const uint8_t* data) {
+	return static_cast<uint16_t>(data[0] | (static_cast<uint16_t>(data[1]) << 8));
+}
+
+uint32_t ReadLe32(const uint8_t* data) {
+	return static_cast<uint32_t>(ReadLe16(data)) | (static_cast<uint32_t>(ReadLe16(data + 2)) << 16);
+}
+
+}  // namespace
+
+FlashStorage::FlashStorage(const Config& config) : config_(config) {}
+
+bool FlashStorage::Init() {
+	initialized_ = false;
+	const uint32_t sector = GetSectorSize();
+	const uint32_t limit = std::min(GetStorageLimit(), GetFlashSize());
+	if(config_.bank_size == 0 || config_.bank_size % sector != 0 || config_.offset % sector != 0 ||
+	   config_.offset < GetProgramEnd() || config_.offset > limit ||
+	   limit - config_.offset < 2U * config_.bank_size) {
+		return false;
+	}
+
+	uint32_t sequences[2] = {0, 0};
+	const bool valid[2] = {ReadHeader(0, sequences[0]), ReadHeader(1, sequences[1])};
+	if(!valid[0] && !valid[1]) {
+		return Format();
+	}
+	if(valid[0] && valid[1]) {
+		// Newest bank wins; the other one is the source of an earlier compaction.
+		active_bank_ = static_cast<int32_t>(sequences[1] - sequences[0]) > 0 ? 1 : 0;
+	} else {
+		active_bank_ = valid[0] ? 0 : 1;
+	}
+	sequence_ = sequences[active_bank_];
+	ScanActiveBank();
+	initialized_ = true;
+	return true;
+}
+
+size_t FlashStorage::Get(uint32_t tag, uint8_t* buffer, size_t buffer_size) const {
+	const Record* record = FindRecord(tag);
+	if(record == nullptr) {
+		return 0;
+	}
+	if(buffer != nullptr && buffer_size != 0) {
+		ReadRange(BankOffset(active_bank_) + record->offset, buffer, std::min<size_t>(buffer_size, record->size));
+	}
+	return record->size;
+}
+
+size_t FlashStorage::GetSize(uint32_t tag) const {
+	const Record* record = FindRecord(tag);
+	return record != nullptr ? record->size : 0;
+}
+
+bool FlashStorage::Store(uint32_t tag, const uint8_t* data, size_t size) {
+	if(size == 0) {
+		return Delete(tag);
+	}
+	if(!initialized_ || tag == kErasedTag || data == nullptr || size > kMaxValueSize) {
+		return false;
+	}
+	if(!IsChange(tag, data, size)) {
+		return true;
+	}
+	return Append(tag, data, static_cast<uint16_t>(size));
+}
+
+bool FlashStorage::StoreBatch(const Entry* entries, size_t count) {
+	if(!initialized_) {
+		return false;
+	}
+	std::vector<const Entry*> changes;
+	changes.reserve(count);
+	uint32_t needed = 0;
+	for(size_t i = 0; i < count; ++i) {
+		const Entry& entry = entries[i];
+		if(entry.tag == kErasedTag || entry.size > kMaxValueSize || (entry.size != 0 && entry.data == nullptr)) {
+			return false;
+		}
+		if(IsChange(entry.tag, entry.data, entry.size)) {
+			changes.push_back(&entry);
+			needed += RecordSize(entry.size);
+		}
+	}
+	if(changes.empty()) {
+		return true;
+	}
+
+	if(damaged_tail_ || needed > config_.bank_size - write_offset_) {
+		if(!Compact()) {
+			return false;
+		}
+	}
+	if(needed > config_.bank_size - write_offset_) {
+		bool ok = true;
+		for(const Entry* entry: changes) {
+			ok = Append(entry->tag, entry->data, static_cast<uint16_t>(entry->size)) && ok;
+		}
+		return ok;
+	}
+
+	std::vector<uint8_t> records(needed, 0xFF);
+	uint32_t offset = 0;
+	for(const Entry* entry: changes) {
+		EncodeRecord(records.data() + offset, entry->tag, entry->data, static_cast<uint16_t>(entry->size));
+		offset += RecordSize(entry->size);
+	}
+	if(!ProgramRange(BankOffset(active_bank_) + write_offset_, records.data(), records.size())) {
+		damaged_tail_ = true;
+		return false;
+	}
+	for(const Entry* entry: changes) {
+		UpdateIndex(entry->tag, write_offset_ + kRecordHeaderSize, static_cast<uint16_t>(entry->size));
+		write_offset_ += RecordSize(entry->size);
+	}
+	return true;
+}
+
+bool FlashStorage::Delete(uint32_t tag) {
+	if(!initialized_) {
+		return false;
+	}
+	if(FindRecord(tag) == nullptr) {
+		return true;
+	}
+	return Append(tag, nullptr, 0);
+}
+
+bool FlashStorage::Compact() {
+	if(!initialized_) {
+		return false;
+	}
+	const size_t target = 1 - active_bank_;
+	if(!EraseRange(BankOffset(target), config_.bank_size)) {
+		return false;
+	}
+	std::vector<Record> compacted;
+	compacted.reserve(index_.size());
+	uint32_t offset = kHeaderSize;
+	for(const auto& record: index_) {
+		scratch_.resize(record.size);
+		ReadRange(BankOffset(active_bank_) + record.offset, scratch_.data(), record.size);
+		if(!WriteRecord(target, offset, record.tag, scratch_.data(), record.size)) {
+			return false;
+		}
+		compacted.push_back(Record{record.tag, offset + kRecordHeaderSize, record.size});
+		offset += RecordSize(record.size);
+	}
+	// The header goes last: until it is written the old bank stays active.
+	uint8_t header[kHeaderSize];
+	StoreLe32(header, kMagic);
+	StoreLe32(header + 4, sequence_ + 1);
+	if(!ProgramRange(BankOffset(target), header, sizeof(header))) {
+		return false;
+	}
+	active_bank_ = target;
+	++sequence_;
+	write_offset_ = offset;
+	index_ = std::move(compacted);
+	damaged_tail_ = false;
+	return true;
+}
+
+bool FlashStorage::Format() {
+	index_.clear();
+	live_bytes_ = 0;
+	damaged_tail_ = false;
+	if(!EraseRange(0, 2U * config_.bank_size)) {
+		initialized_ = false;
+		return false;
+	}
+	uint8_t header[kHeaderSize];
+	StoreLe32(header, kMagic);
+	StoreLe32(header + 4, 1);
+	if(!ProgramRange(0, header, sizeof(header))) {
+		initialized_ = false;
+		return false;
+	}
+	active_bank_ = 0;
+	sequence_ = 1;
+	write_offset_ = kHeaderSize;
+	initialized_ = true;
+	return true;
+}
+
+std::vector<uint32_t> FlashStorage::GetTags() const {
+	std::vector<uint32_t> tags;
+	tags.reserve(index_.size());
+	for(const auto& record: index_) {
+		tags.push_back(record.tag);
+	}
+	return tags;
+}
+
+FlashStorage::Stats FlashStorage::GetStats() const {
+	Stats stats;
+	stats.entries = index_.size();
+	stats.used_bytes = write_offset_;
+	stats.live_bytes = live_bytes_;
+	stats.compactions = sequence_ > 0 ? sequence_ - 1 : 0;
+	return stats;
+}
+
+const FlashStorage::Record* FlashStorage::FindRecord(uint32_t tag) const {
+	const auto it = std::find_if(index_.begin(), index_.end(), [tag](const Record& record) {
+		return record.tag == tag;
+	});
+	return it != index_.end() ? &*it : nullptr;
+}
+
+bool FlashStorage::ReadHeader(size_t bank, uint32_t& sequence) const {
+	uint8_t header[kHeaderSize];
+	ReadRange(BankOffset(bank), header, sizeof(header));
+	sequence = ReadLe32(header + 4);
+	return ReadLe32(header) == kMagic;
+}
+
+void FlashStorage::ScanActiveBank() {
+	index_.clear();
+	live_bytes_ = 0;
+	damaged_tail_ = false;
+	uint32_t offset = kHeaderSize;
+	while(offset + kRecordHeaderSize <= config_.bank_size) {
+		uint8_t header[kRecordHeaderSize];
+		ReadRange(BankOffset(active_bank_) + offset, header, sizeof(header));
+		const uint32_t tag = ReadLe32(header);
+		if(tag == kErasedTag) {
+			// End of the log, unless a torn write left the rest of the header programmed.
+			damaged_tail_ = std::any_of(header + 4, header + sizeof(header), [](uint8_t byte) {
+				return byte != 0xFF;
+			});
+			break;
+		}
+		const uint16_t size = ReadLe16(header + 4);
+		if(RecordSize(size) > config_.bank_size - offset) {
+			damaged_tail_ = true;
+			break;
+		}
+		scratch_.resize(size);
+		ReadRange(BankOffset(active_bank_) + offset + kRecordHeaderSize, scratch_.data(), size);
+		const uint16_t crc = Crc16(Crc16(0xFFFF, header, 6), scratch_.data(), size);
+		if(crc != ReadLe16(header + 6)) {
+			damaged_tail_ = true;
+			break;
+		}
+
+		UpdateIndex(tag, offset + kRecordHeaderSize, size);
+		offset += RecordSize(size);
+	}
+	write_offset_ = offset;
+}
+
+bool FlashStorage::IsChange(uint32_t tag, const uint8_t* data, size_t size) const {
+	const Record* record = FindRecord(tag);
+	if(record == nullptr || size == 0) {
+		return (record != nullptr) != (size != 0);
+	}
+	if(record->size != size) {
+		return true;
+	}
+	scratch_.resize(size);
+	ReadRange(BankOffset(active_bank_) + record->offset, scratch_.data(), size);
+	return !std::equal(scratch_.begin(), scratch_.end(), data);
+}
+
+void FlashStorage::EncodeRecord(uint8_t* out, uint32_t tag, const uint8_t* data, uint16_t size) {
+	StoreLe32(out, tag);
+	StoreLe16(out + 4, size);
+	if(size != 0) {
+		std::copy_n(data, size, out + kRecordHeaderSize);
+	}
+	StoreLe16(out + 6, Crc16(Crc16(0xFFFF, out, 6), out + kRecordHeaderSize, size));
+}
+
+bool FlashStorage::WriteRecord(size_t bank, uint32_t offset, uint32_t tag, const uint8_t* data, uint16_t size) {
+	std::vector<uint8_t> record(RecordSize(size), 0xFF);
+	EncodeRecord(record.data(), tag, data, size);
+	return ProgramRange(BankOffset(bank) + offset, record.data(), record.size());
+}
+
+void FlashStorage::UpdateIndex(uint32_t tag, uint32_t value_offset, uint16_t size) {
+	auto it = std::find_if(index_.begin(), index_.end(), [tag](const Record& record) {
+		return record.tag == tag;
+	});
+	if(it != index_.end()) {
+		live_bytes_ -= RecordSize(it->size);
+		index_.erase(it);
+	}
+	if(size != 0) {
+		index_.push_back(Record{tag, value_offset, size});
+		live_bytes_ += RecordSize(size);
+	}
+}
+
+bool FlashStorage::Append(uint32_t tag, const uint8_t* data, uint16_t size) {
+	const uint32_t needed = RecordSize(size);
+	if(damaged_tail_ || needed > config_.bank_size - write_offset_) {
+		if(!Compact()) {
+			return false;
+		}
+		if(needed > config_.bank_size - write_offset_) {
+			return false;
+		}
+	}
+	if(!WriteRecord(active_bank_, write_offset_, tag, data, size)) {
+		// Whatever part reached flash must not be overwritten.
+		damaged_tail_ = true;
+		return false;
+	}
+	UpdateIndex(tag, write_offset_ + kRecordHeaderSize, size);
+	write_offset_ += needed;
+	return true;
+}
+
+}  // namespace c7222
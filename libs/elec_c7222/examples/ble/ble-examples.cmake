@@ -4,4 +4,5 @@ include(${ELEC_C7222_BLE_EXAMPLES_DIR}/gap/ble-gap-example.cmake)
 include(${ELEC_C7222_BLE_EXAMPLES_DIR}/gatt-server/ble-gatt-server-example.cmake)
 include(${ELEC_C7222_BLE_EXAMPLES_DIR}/security-manager/ble-security-manager-example.cmake)
 include(${ELEC_C7222_BLE_EXAMPLES_DIR}/custom-service-rw/ble-custom-service-rw-example.cmake)
-include(${ELEC_C7222_BLE_EXAMPLES_DIR}/custom-service-notify/ble-custom-service-notify-example.cmake)
\ No newline at end of file
+include(${ELEC_C7222_BLE_EXAMPLES_DIR}/custom-service-notify/ble-custom-service-notify-example.cmake)
+include(${ELEC_C7222_BLE_EXAMPLES_DIR}/l2cap-channel/ble-l2cap-channel-example.cmake)
\ No newline at end of file
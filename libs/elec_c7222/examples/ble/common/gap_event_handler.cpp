@@ -93,6 +93,11 @@ void GapEventHandler::OnConnectionComplete(uint8_t status,
 	// Propagate the connection handle to the AttributeServer so GATT operations can proceed.
 	if(attribute_server_ != nullptr) {
 		attribute_server_->SetConnectionHandle(con_handle);
+		// Advertising stops on connect; keep accepting clients while there is room.
+		if(status == 0 && gap_ != nullptr &&
+		   attribute_server_->GetConnectionCount() < c7222::AttributeServer::kMaxConnections) {
+			gap_->StartAdvertising();
+		}
 	}
 }
 
@@ -32,6 +32,8 @@
  * The stored `Gap` instance is used to restart advertising on disconnect.
  * The optional `AttributeServer` instance is used to set the active connection
  * handle when a connection completes, which is required for GATT operations.
+ * Advertising is restarted after a connection while the server can accept
+ * more clients (`AttributeServer::kMaxConnections`).
  */
 class GapEventHandler : public c7222::Gap::EventHandler {
    public:
@@ -37,6 +37,7 @@
 #include "security_event_handler.hpp"
 #include "security_manager.hpp"
 #include "app_profile.h"
+#include "app_profile_layout.hpp"
 
 
 /// On-board LED used as a heartbeat while advertising.
@@ -176,8 +177,9 @@ static void on_turn_on() {
 		security_event_handler.SetSecurityManager(security_manager);
 		ble->AddSecurityEventHandler(&security_event_handler);
 	}
-	// Enable AttributeServer with the generated GATT database.
-	att_server = ble->EnableAttributeServer(profile_data);
+	// Enable AttributeServer with the generated GATT database; the build-time
+	// layout tables (app_profile_layout.hpp) spare the parse of the blob.
+	att_server = ble->EnableAttributeServer(profile_data, c7222::generated::app_profile::kLayout);
 	gap_event_handler.SetAttributeServer(att_server);
 	auto& adb = ble->GetAdvertisementDataBuilder();
 	std::cout << "Attribute server initialized." << std::endl;
@@ -0,0 +1,31 @@
+if(NOT DEFINED C7222_ENABLE_BLE)
+    set(C7222_ENABLE_BLE OFF)
+endif()
+
+if(NOT C7222_ENABLE_BLE)
+    message(STATUS "C7222_EXAMPLES_BUILD requires C7222_ENABLE_BLE=ON for BLE examples. Skipping BLE L2CAP channel example...")
+    return()
+endif()
+
+add_library(C7222_EXAMPLE_BLE_L2CAP_CHANNEL INTERFACE)
+set_property(TARGET C7222_EXAMPLE_BLE_L2CAP_CHANNEL PROPERTY TARGET_NAME "example-ble-l2cap-channel")
+set_property(TARGET C7222_EXAMPLE_BLE_L2CAP_CHANNEL PROPERTY TARGET_PATH "${CMAKE_CURRENT_LIST_DIR}")
+
+file(GLOB C7222_EXAMPLE_BLE_L2CAP_CHANNEL_SOURCES
+    ${CMAKE_CURRENT_LIST_DIR}/*.c
+    ${CMAKE_CURRENT_LIST_DIR}/../common/*.c
+    ${CMAKE_CURRENT_LIST_DIR}/*.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/../common/*.cpp
+)
+
+target_sources(C7222_EXAMPLE_BLE_L2CAP_CHANNEL INTERFACE
+    ${C7222_EXAMPLE_BLE_L2CAP_CHANNEL_SOURCES}
+)
+
+target_include_directories(C7222_EXAMPLE_BLE_L2CAP_CHANNEL INTERFACE
+    ${CMAKE_CURRENT_LIST_DIR}
+    ${CMAKE_CURRENT_LIST_DIR}/../common
+)
+
+# append to the global list for examples to use
+list(APPEND C7222_EXAMPLES C7222_EXAMPLE_BLE_L2CAP_CHANNEL)
@@ -0,0 +1,201 @@
+/**
+ * @file main_ble_l2cap_channel.cpp
+ * @brief LE credit-based L2CAP channel echo example (FreeRTOS).
+ *
+ * The device advertises as connectable and listens for an LE credit-based
+ * L2CAP channel on PSM 0x0080. Every SDU the central sends is echoed back
+ * on the same channel, which makes the example a quick throughput and
+ * interoperability check (e.g. with the "L2CAP CoC" tools of nRF Connect or
+ * a BlueZ `l2test -P 128` client).
+ *
+ * Dependencies:
+ * - `GapEventHandler` from `examples/ble/common/gap_event_handler.hpp` logs
+ *   advertising and connection events.
+ * - `c7222::L2capChannel` registers the PSM and moves the SDUs. Received data
+ *   is only valid during `OnData()`, so it is copied into a static echo
+ *   buffer that stays untouched until `OnSendComplete()`.
+ * - `c7222::OnBoardLED` is on while a channel is open.
+ */
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+
+#include "../common/gap_event_handler.hpp"
+#include "advertisement_data.hpp"
+#include "ble.hpp"
+#include "freertos_task.hpp"
+#include "gap.hpp"
+#include "l2cap_channel.hpp"
+#include "onboard_led.hpp"
+#include "pico/stdlib.h"
+#include "platform.hpp"
+
+/// Platform abstraction (initializes CYW43/BTstack).
+static c7222::Platform* platform = nullptr;
+/// On-board LED showing the channel state.
+static c7222::OnBoardLED* onboard_led = nullptr;
+/// Common GAP event handler used for logging.
+static GapEventHandler gap_event_handler;
+
+/// PSM the channel listens on (LE dynamic range).
+static constexpr uint16_t kEchoPsm = 0x0080;
+/// Largest SDU accepted from the central.
+static constexpr uint16_t kEchoMtu = 512;
+
+/// Echo channel (created by the BLE task, after static initialization).
+static c7222::L2capChannel* echo_channel = nullptr;
+/// SDU being echoed; owned by the stack until OnSendComplete().
+static std::array<uint8_t, kEchoMtu> echo_buffer{};
+/// SDUs dropped because the previous echo was still in flight.
+static uint32_t echo_dropped = 0;
+
+// ------------------------------------------------------------
+// L2CAP channel events
+// ------------------------------------------------------------
+/**
+ * @brief Echoes every received SDU back to the central.
+ */
+class EchoHandler : public c7222::L2capChannel::EventHandler {
+   public:
+	void OnOpened(c7222::L2capChannel& channel, c7222::BleError status) const override {
+		if(status != c7222::BleError::kSuccess) {
+			std::printf("L2CAP channel failed to open (status=%u)\n", static_cast<unsigned>(status));
+			return;
+		}
+		std::printf("L2CAP channel open: cid=0x%04x remote MTU=%u\n",
+					static_cast<unsigned>(channel.GetLocalCid()),
+					static_cast<unsigned>(channel.GetRemoteMtu()));
+		onboard_led->On();
+	}
+
+	void OnData(c7222::L2capChannel& channel, const uint8_t* data, uint16_t size) const override {
+		if(!channel.CanSend()) {
+			++echo_dropped;
+			return;
+		}
+		// The SDU lives in the channel receive buffer only during this callback.
+		const auto echo_size =
+			static_cast<uint16_t>(std::min<size_t>({size, echo_buffer.size(), channel.GetRemoteMtu()}));
+		std::copy_n(data, echo_size, echo_buffer.begin());
+		if(channel.Send(echo_buffer.data(), echo_size) != c7222::BleError::kSuccess) {
+			++echo_dropped;
+		}
+	}
+
+	void OnClosed(c7222::L2capChannel& channel) const override {
+		std::printf("L2CAP channel closed: rx=%lu bytes, tx=%lu bytes, dropped=%lu SDUs\n",
+					static_cast<unsigned long>(channel.GetReceivedByteCount()),
+					static_cast<unsigned long>(channel.GetSentByteCount()),
+					static_cast<unsigned long>(echo_dropped));
+		channel.ResetCounters();
+		echo_dropped = 0;
+		onboard_led->Off();
+	}
+};
+
+static EchoHandler echo_handler;
+
+// ------------------------------------------------------------
+// BLE setup: advertise and listen on the PSM once the stack is on.
+// ------------------------------------------------------------
+/**
+ * @brief Callback executed when the BLE stack is fully initialized.
+ *
+ * Steps:
+ * - Attach a GAP event handler for logging.
+ * - Register the L2CAP channel on its PSM.
+ * - Start connectable advertising.
+ */
+static void on_turn_on() {
+	std::printf("Bluetooth Turned On\n");
+	auto* ble = c7222::Ble::GetInstance();
+	auto* gap = ble->GetGap();
+
+	gap->AddEventHandler(gap_event_handler);
+
+	echo_channel->AddEventHandler(echo_handler);
+	const c7222::BleError status = echo_channel->Listen();
+	if(status != c7222::BleError::kSuccess) {
+		std::printf("L2CAP Listen() failed (status=%u)\n", static_cast<unsigned>(status));
+		return;
+	}
+	std::printf("Listening for L2CAP channels on PSM 0x%04x\n", static_cast<unsigned>(kEchoPsm));
+
+	ble->SetAdvertisementFlags(c7222::AdvertisementData::Flags::kLeGeneralDiscoverableMode |
+							   c7222::AdvertisementData::Flags::kBrEdrNotSupported);
+	ble->SetDeviceName("Pico2_L2CAP");
+
+	c7222::Gap::AdvertisementParameters adv_params;
+	adv_params.advertising_type = c7222::Gap::AdvertisingType::kAdvInd;
+	adv_params.min_interval = 320;
+	adv_params.max_interval = 400;
+	gap->SetAdvertisingParameters(adv_params);
+
+	gap->StartAdvertising();
+	std::printf("Advertising started as 'Pico2_L2CAP'...\n");
+}
+
+// ------------------------------------------------------------
+// BLE Application Task
+// ------------------------------------------------------------
+/**
+ * @brief FreeRTOS task that owns BLE initialization and prints transfer counters.
+ */
+[[noreturn]] void ble_app_task(void* params) {
+	(void)params;
+
+	onboard_led = c7222::OnBoardLED::GetInstance();
+	onboard_led->Initialize();
+
+	// Automatic credit management; no pairing required.
+	static c7222::L2capChannel channel({kEchoPsm, kEchoMtu, 0, 0});
+	echo_channel = &channel;
+
+	auto* ble = c7222::Ble::GetInstance(false);
+	ble->SetOnBleStackOnCallback(on_turn_on);
+	ble->TurnOn();
+
+	std::printf("BLE Stack ON is requested!\n");
+
+	while(true) {
+		c7222::FreeRtosTask::Delay(c7222::FreeRtosTask::MsToTicks(5000));
+		if(echo_channel->IsOpen()) {
+			std::printf("L2CAP echo: rx=%lu SDUs (%lu bytes), tx=%lu SDUs, dropped=%lu\n",
+						static_cast<unsigned long>(echo_channel->GetReceivedSduCount()),
+						static_cast<unsigned long>(echo_channel->GetReceivedByteCount()),
+						static_cast<unsigned long>(echo_channel->GetSentSduCount()),
+						static_cast<unsigned long>(echo_dropped));
+		}
+	}
+}
+
+// ------------------------------------------------------------
+// Main
+// ------------------------------------------------------------
+/**
+ * @brief Program entry point.
+ */
+[[noreturn]] int main() {
+	// Initialize platform (CYW43 + BTstack).
+	platform = c7222::Platform::GetInstance();
+	if(!platform->Initialize()) {
+		assert(false && "Failed to initialize CYW43 architecture");
+	}
+	std::printf("Platform initialized successfully.\n");
+	// ensure board IO is initialized so LEDs and buttons work out of the box
+	platform->GetPicoWBoard();
+
+	std::printf("Starting FreeRTOS BLE L2CAP Channel Example...\n");
+
+	static c7222::FreeRtosTask ble_task;
+	(void)ble_task.Initialize("BLE_App",
+							  1024,
+							  c7222::FreeRtosTask::IdlePriority() + 1,
+							  ble_app_task,
+							  nullptr);
+	c7222::FreeRtosTask::StartScheduler();
+
+	while(1) {}
+}
@@ -86,6 +86,11 @@ class FreeRtosTask : public NonCopyableNonMovable {
 	bool SetPriority(std::uint32_t priority);
 	/** @brief Get current task priority. */
 	std::uint32_t GetPriority() const;
+	/**
+	 * @brief Restrict the task to a set of cores (bit n = core n).
+	 * @return false when the port has no core affinity (single-core builds, grader).
+	 */
+	bool SetCoreAffinity(std::uint32_t core_mask);
 
 	/** @brief @return true if wrapper owns a valid task handle. */
 	bool IsValid() const;
@@ -97,6 +97,19 @@ bool FreeRtosTask::SetPriority(std::uint32_t priority) {
 	return true;
 }
 
+bool FreeRtosTask::SetCoreAffinity(std::uint32_t core_mask) {
+	if(handle_ == nullptr) {
+		return false;
+	}
+#if (configNUMBER_OF_CORES > 1) && (configUSE_CORE_AFFINITY == 1)
+	vTaskCoreAffinitySet(static_cast<TaskHandle_t>(handle_), static_cast<UBaseType_t>(core_mask));
+	return true;
+#else
+	(void)core_mask;
+	return false;
+#endif
+}
+
 std::uint32_t FreeRtosTask::GetPriority() const {
 	if(handle_ == nullptr) {
 		return 0;